@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Shared library with the C interface of the engine
+# (sudoku_c.h). Only the sudoku_* functions are exported;
+# the C++ classes stay internal, so C++ consumers link the
+# static library from core.pro instead.
+#
+#-------------------------------------------------
+
+TEMPLATE = lib
+TARGET = sudokuc
+
+CONFIG -= qt
+CONFIG += c++11 thread shared
+DEFINES += SUDOKU_BUILD
+VERSION = 1.0.0
+
+unix: QMAKE_CXXFLAGS += -fvisibility=hidden
+
+# shm_open for the solve ring lives in librt on older glibc
+linux: LIBS += -lrt
+
+include(../sources.pri)
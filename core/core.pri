@@ -0,0 +1,22 @@
+# Include this file from a project that links the core library:
+#     include(path/to/core/core.pri)
+
+INCLUDEPATH += $$PWD/include
+DEPENDPATH += $$PWD/include
+
+SUDOKU_CORE_OUT = $$shadowed($$PWD)
+win32 {
+    CONFIG(debug, debug|release): SUDOKU_CORE_OUT = $$SUDOKU_CORE_OUT/debug
+    else: SUDOKU_CORE_OUT = $$SUDOKU_CORE_OUT/release
+}
+
+LIBS += -L$$SUDOKU_CORE_OUT -lsudokucore
+
+# shm_open for the solve ring lives in librt on older glibc
+linux: LIBS += -lrt
+
+# The C++ classes are only available from the static library
+DEFINES += SUDOKU_STATIC
+CONFIG += thread
+win32-msvc*: PRE_TARGETDEPS += $$SUDOKU_CORE_OUT/sudokucore.lib
+else: PRE_TARGETDEPS += $$SUDOKU_CORE_OUT/libsudokucore.a
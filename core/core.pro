@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Qt-free sudoku engine: solver, rater, generator and
+# low-clue search, plus a stable C interface (sudoku_c.h).
+#
+# Always built as a static library, which the app and the
+# tools link through core.pri. Run qmake with
+# CONFIG+=sudoku_shared to also build capi/, a shared library
+# that exports only the C interface.
+#
+#-------------------------------------------------
+
+TEMPLATE = lib
+TARGET = sudokucore
+
+CONFIG -= qt
+CONFIG += c++11 thread staticlib
+DEFINES += SUDOKU_STATIC
+
+include(sources.pri)
@@ -0,0 +1,136 @@
+﻿/**
+ * @file bitboard.h
+ * @brief 81-bit cell set shared by the search engines
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * @brief 统计64位整数中1的个数
+ */
+inline int popCount64(uint64_t v)
+{
+#ifdef _MSC_VER
+    return int(__popcnt64(v));
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+/**
+ * @brief 返回最低位1的位置，v不能为0
+ */
+inline int lowestBit64(uint64_t v)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return int(index);
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+/**
+ * @brief 81个格子的集合
+ * @details 第i位表示第i个格子(i = r * 9 + c)，lo保存0~63，hi保存64~80
+ */
+struct Bitboard
+{
+    uint64_t lo;
+    uint64_t hi;
+
+    Bitboard(uint64_t _lo = 0, uint64_t _hi = 0) : lo(_lo), hi(_hi) { }
+
+    // 只包含一个格子的集合
+    static Bitboard cell(int i)
+    {
+        return i < 64 ? Bitboard(uint64_t(1) << i, 0) : Bitboard(0, uint64_t(1) << (i - 64));
+    }
+
+    // 全部81个格子
+    static Bitboard all()
+    {
+        return Bitboard(~uint64_t(0), (uint64_t(1) << 17) - 1);
+    }
+
+    bool test(int i) const
+    {
+        return i < 64 ? (lo >> i) & 1 : (hi >> (i - 64)) & 1;
+    }
+
+    void set(int i)
+    {
+        if (i < 64)
+            lo |= uint64_t(1) << i;
+        else
+            hi |= uint64_t(1) << (i - 64);
+    }
+
+    void reset(int i)
+    {
+        if (i < 64)
+            lo &= ~(uint64_t(1) << i);
+        else
+            hi &= ~(uint64_t(1) << (i - 64));
+    }
+
+    int count() const
+    {
+        return popCount64(lo) + popCount64(hi);
+    }
+
+    bool empty() const
+    {
+        return (lo | hi) == 0;
+    }
+
+    // 返回编号最小的格子，集合不能为空
+    int first() const
+    {
+        return lo ? lowestBit64(lo) : 64 + lowestBit64(hi);
+    }
+
+    // 删除并返回编号最小的格子，用于遍历集合
+    int pop()
+    {
+        int i = first();
+        if (lo)
+            lo &= lo - 1;
+        else
+            hi &= hi - 1;
+        return i;
+    }
+
+    bool intersects(const Bitboard &o) const
+    {
+        return ((lo & o.lo) | (hi & o.hi)) != 0;
+    }
+
+    // 是否为o的子集
+    bool subsetOf(const Bitboard &o) const
+    {
+        return ((lo & ~o.lo) | (hi & ~o.hi)) == 0;
+    }
+
+    Bitboard operator&(const Bitboard &o) const { return Bitboard(lo & o.lo, hi & o.hi); }
+    Bitboard operator|(const Bitboard &o) const { return Bitboard(lo | o.lo, hi | o.hi); }
+    Bitboard operator^(const Bitboard &o) const { return Bitboard(lo ^ o.lo, hi ^ o.hi); }
+    Bitboard operator~() const { return Bitboard(~lo, ~hi) & all(); }
+
+    Bitboard &operator&=(const Bitboard &o) { lo &= o.lo; hi &= o.hi; return *this; }
+    Bitboard &operator|=(const Bitboard &o) { lo |= o.lo; hi |= o.hi; return *this; }
+    Bitboard &operator^=(const Bitboard &o) { lo ^= o.lo; hi ^= o.hi; return *this; }
+
+    bool operator==(const Bitboard &o) const { return lo == o.lo && hi == o.hi; }
+    bool operator!=(const Bitboard &o) const { return !(*this == o); }
+};
+
+#endif // BITBOARD_H
@@ -0,0 +1,59 @@
+﻿/**
+ * @file canonical.h
+ * @brief Canonical (minlex) form of sudoku puzzles
+ */
+
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The Canonicalizer class 计算谜题的最小字典序等价形式
+ * @details 等价变换包括转置、行列在带内的置换、带和栈的置换，以及数字的重新编号，
+ * 两道谜题等价当且仅当它们的标准形式相同。
+ * 标准形式按行逐步确定：先枚举转置和全部1296种列置换，与每个可能的首行组合，
+ * 只保留首行（按出现顺序重新编号后）最小的组合，再在这些组合上确定第二行，依此类推。
+ * 空格记为0，所以标准形式总是尽量把空格排在前面
+ */
+class Canonicalizer
+{
+public:
+    Canonicalizer();
+
+    /**
+     * @brief 计算标准形式
+     * @param puzzle 按行排列的81个数字，0表示空格
+     * @param canonical 输出的标准形式
+     */
+    void canonicalize(const uint8_t *puzzle, uint8_t *canonical);
+
+private:
+    /**
+     * @brief 一个尚未被淘汰的变换
+     */
+    struct Candidate
+    {
+        uint8_t grid;      // 0为原谜题，1为转置后的谜题
+        uint16_t columns;  // 列置换的编号
+        uint16_t usedRows; // 已经用过的行
+        uint8_t band;      // 当前所在的带
+        uint8_t next;      // 下一个编号
+        uint8_t label[10]; // 数字到新编号的映射，0表示尚未编号
+    };
+
+    /**
+     * @brief 按候选变换写出某一行，返回写出后的编号状态
+     * @return 与best比较的结果，小于0表示更小
+     */
+    int writeRow(const Candidate &from, int row, uint8_t *out, Candidate &to, const uint8_t *best) const;
+
+    uint8_t m_grids[2][81]; // 原谜题和转置后的谜题
+
+    std::vector<Candidate> m_current;
+
+    std::vector<Candidate> m_next;
+};
+
+#endif // CANONICAL_H
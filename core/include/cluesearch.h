@@ -0,0 +1,179 @@
+﻿/**
+ * @file cluesearch.h
+ * @brief Exhaustive search for low-clue puzzles inside a solution grid
+ */
+
+#ifndef CLUESEARCH_H
+#define CLUESEARCH_H
+
+#include "bitboard.h"
+#include "sudokusolver.h"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The ClueSearch class 在给定终盘中搜索线索数不超过k的全部极小谜题
+ * @details 终盘的任意一个谜题必须命中该终盘的所有不可避免集（unavoidable set），
+ * 因此搜索被转化为不可避免集上的命中集搜索：
+ * 1. 对每个2~4个数字的组合，清空这些数字所在的格子并枚举其他填法，
+ *    与原盘不同的格子构成一个不可避免集，最后只保留极小的集合
+ * 2. 每次选择可选格子最少的未命中集合进行分支，已经尝试过的格子标记为禁用，
+ *    保证每个线索集合只被访问一次；不相交的未命中集合个数作为下界剪枝。
+ *    每个节点只把未被命中的集合传给子节点，越深需要扫描的集合越少
+ * 3. 所有集合都被命中后用SudokuSolver检验唯一解，不唯一时由第二个解得到新的不可避免集继续搜索，
+ *    唯一并且去掉任意一个线索都不再唯一时才输出
+ *
+ * 搜索树按广度优先展开，直到得到至少MIN_TASKS个固定编号的任务，由多个线程并行处理。
+ * 每完成一个任务就把它的结果写入输出并在检查点文件中记录，中断后可以从检查点继续。
+ * 极小谜题（去掉任意一个线索都不再唯一）每个恰好输出一次；不极小的谜题不输出，
+ * 它们都是某个极小谜题加上若干线索。
+ */
+class ClueSearch
+{
+    // 搜索任务，即展开后搜索树的一个叶子节点
+    struct Task
+    {
+        Bitboard clues; // 已选的线索
+        Bitboard dead;  // 禁止再选的格子
+        int count;      // 线索数
+    };
+
+    // 每个线程私有的数据
+    struct Worker
+    {
+        std::vector<Bitboard> sets;                // 不可避免集，搜索中发现的新集合只加入自己的副本
+        std::vector<std::vector<Bitboard>> levels; // 任务中每一层未被已选线索命中的集合
+        SudokuSolver solver;                       // 检验唯一解
+        std::string buffer;                        // 当前任务的输出
+        long long found;                           // 当前任务找到的谜题数
+    };
+
+public:
+    /**
+     * @brief 展开搜索树得到的最少任务数，线程之间能够均衡，检查点的粒度也足够细
+     */
+    static const size_t MIN_TASKS = 65536;
+
+    /**
+     * @brief 构造函数
+     * @param grid 终盘，按行排列的81个数字
+     */
+    explicit ClueSearch(const std::vector<int> &grid);
+
+    /**
+     * @brief 终盘是否合法
+     */
+    bool isValid() const;
+
+    /**
+     * @brief 返回终盘的极小不可避免集，按大小排序
+     */
+    const std::vector<Bitboard> &unavoidableSets() const;
+
+    /**
+     * @brief 搜索线索数不超过maxClues的全部极小谜题
+     * @param maxClues 线索数上限
+     * @param threads 线程数，小于1时使用全部核心
+     * @param output 输出文件，每行一个谜题，空格用'.'表示；"-"表示标准输出
+     * @param checkpoint 检查点文件，为空表示不记录；文件存在时从上次中断处继续
+     * @return 本次运行找到的谜题数，出错时返回-1
+     */
+    long long run(int maxClues, int threads, const std::string &output, const std::string &checkpoint);
+
+    /**
+     * @brief 请求停止搜索，可以在信号处理函数中调用
+     * @details 正在进行的任务会被放弃，不会记入检查点
+     */
+    void stop();
+
+    /**
+     * @brief 返回最近一次出错的原因
+     */
+    std::string errorString() const;
+
+private:
+    /**
+     * @brief 枚举重新填写blank中的格子得到的终盘
+     * @param blank 需要重新填写的格子
+     * @param limit 找到limit个解后停止
+     * @param diffs 与原盘不同的解所对应的不同格子
+     * @return 找到的解的个数，包括原盘本身
+     */
+    int enumerate(const Bitboard &blank, int limit, std::vector<Bitboard> &diffs) const;
+
+    int enumerate(int *values, unsigned *units, int *blanks, int nBlank,
+                  int limit, int found, std::vector<Bitboard> &diffs) const;
+
+    /**
+     * @brief 查找所有极小不可避免集
+     */
+    void findUnavoidableSets();
+
+    /**
+     * @brief 选择下一个要命中的集合
+     * @param avail 返回该集合中可选的格子
+     * @return 0表示需要剪枝，1表示得到了分支集合，2表示所有集合都已命中
+     */
+    int pick(const std::vector<Bitboard> &sets, const Task &node, Bitboard &avail) const;
+
+    /**
+     * @brief 按广度优先展开搜索树，直到得到至少MIN_TASKS个任务
+     */
+    void split();
+
+    /**
+     * @param depth 节点在任务中的层数，worker.levels[depth]是未被node.clues命中的集合
+     */
+    void search(Worker &worker, const Task &node, int depth);
+
+    /**
+     * @brief 检验唯一解的线索集合是否是极小的，是则以文本形式写入worker的缓冲区
+     */
+    void accept(Worker &worker, const uint8_t *puzzle, const Bitboard &clues);
+
+    void work();
+
+    /**
+     * @brief 读取检查点，返回已提交的输出长度
+     */
+    bool loadCheckpoint(const std::string &path, long long &offset);
+
+    /**
+     * @brief 提交一个已完成的任务
+     */
+    void commit(int task, Worker &worker);
+
+    int m_grid[81]; // 终盘
+
+    bool m_valid;
+
+    int m_maxClues;
+
+    std::vector<Bitboard> m_sets;
+
+    std::vector<Task> m_tasks;
+
+    std::vector<char> m_done; // 已完成的任务
+
+    std::atomic<int> m_next; // 下一个待处理的任务
+
+    std::atomic<bool> m_stopped;
+
+    std::mutex m_mutex; // 保护输出和检查点
+
+    std::FILE *m_output;
+
+    std::FILE *m_checkpoint;
+
+    long long m_offset; // 已写入输出的字节数
+
+    long long m_found;
+
+    std::string m_error;
+};
+
+#endif // CLUESEARCH_H
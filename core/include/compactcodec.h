@@ -0,0 +1,60 @@
+﻿/**
+ * @file compactcodec.h
+ * @brief Compact variable-length puzzle encoding
+ *
+ * A record is one little-endian bit stream:
+ *
+ *     81 bits   clue bitmap, bit i set when cell i holds a clue
+ *     ...       one code per clue, in cell order
+ *
+ * The code of a clue is the index of its digit among the digits still allowed
+ * in that cell by the clues before it (in its row, column and box), written
+ * with just enough bits for the number of allowed digits: 0 bits when only one
+ * digit is possible, at most 4. The stream is padded to a whole byte, so a
+ * typical 25-clue puzzle takes about 20 bytes. Records are self-delimiting and
+ * can be concatenated; a compact file is COMPACT_MAGIC, the one-byte
+ * COMPACT_VERSION and the records.
+ */
+
+#ifndef COMPACTCODEC_H
+#define COMPACTCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+const char COMPACT_MAGIC[8] = { 'S', 'D', 'K', 'C', 'M', 'P', 'T', 0 };
+
+const uint8_t COMPACT_VERSION = 1;
+
+/**
+ * @brief The CompactCodec class 紧凑编码的编码和解码
+ * @details 解码时每个线索的候选集合由已解出的线索决定，位宽和第n个候选数都查表得到，
+ * 除了检查错误外没有分支
+ */
+class CompactCodec
+{
+public:
+    /**
+     * @brief 一条记录的最大字节数：81位位图加81个4位编码
+     */
+    static const size_t MAX_SIZE = (81 + 81 * 4 + 7) / 8;
+
+    /**
+     * @brief 编码一道谜题
+     * @param puzzle 按行排列的81个数字，0表示空格
+     * @param out 输出缓冲区，至少MAX_SIZE字节
+     * @return 写出的字节数；线索之间有冲突时无法编码，返回0
+     */
+    static size_t encode(const uint8_t *puzzle, uint8_t *out);
+
+    /**
+     * @brief 解码一道谜题
+     * @param in 输入的记录
+     * @param available 可以读取的字节数
+     * @param puzzle 输出的谜题
+     * @return 读取的字节数；数据不完整或无效时返回0
+     */
+    static size_t decode(const uint8_t *in, size_t available, uint8_t *puzzle);
+};
+
+#endif // COMPACTCODEC_H
@@ -0,0 +1,80 @@
+﻿/**
+ * @file feasibility.h
+ * @brief Incremental check whether a partially filled board can still be solved
+ *
+ * The checker is called after every move of a player. It keeps two pieces of
+ * state from the previous call so that most checks do no search at all:
+ *
+ *   - a witness, the last solution found; while every filled cell agrees with
+ *     it the board is solvable and the check is a single pass over 81 cells;
+ *   - the propagated root state of the solver for the last board it searched;
+ *     when the new board only adds digits to that board, the new digits are
+ *     placed and propagated on top of it instead of starting from the clues.
+ *
+ * Erasing or overwriting a digit cannot be undone in the propagated state, so
+ * the root is rebuilt from the board in that case. Loading another puzzle
+ * needs no special call: its clues disagree with the old witness and the old
+ * root, so both are replaced by the next check.
+ */
+
+#ifndef FEASIBILITY_H
+#define FEASIBILITY_H
+
+#include "sudokusolver.h"
+
+#include <cstdint>
+
+/**
+ * @brief 检查的结果
+ */
+enum Feasibility
+{
+    FEASIBLE,   // 至少有一个解
+    INFEASIBLE, // 无解，包括盘面上有冲突
+    UNDECIDED   // 预算用完或被取消
+};
+
+/**
+ * @brief The FeasibilityChecker class 判断盘面是否还有解，复用上一次检查的解和传播状态
+ * @details 不能被多个线程同时使用
+ */
+class FeasibilityChecker
+{
+public:
+    FeasibilityChecker();
+
+    /**
+     * @brief 检查盘面
+     * @param board 按行排列的81个数字，0表示空格
+     * @param budget 搜索的预算，只在需要搜索时使用
+     */
+    Feasibility check(const uint8_t *board, const SolveBudget &budget = SolveBudget());
+
+    /**
+     * @brief 上一次检查访问的搜索节点数，没有搜索时为0
+     */
+    unsigned long long nodes() const;
+
+private:
+    /**
+     * @brief 让求解器的第0层状态对应board，只增加数字时增量传播
+     * @return 是否没有出现矛盾
+     */
+    bool sync(const uint8_t *board);
+
+    SudokuSolver m_solver;
+
+    uint8_t m_board[81]; // 求解器第0层状态对应的盘面
+
+    bool m_loaded; // m_board是否有效
+
+    bool m_consistent; // 第0层状态是否没有矛盾
+
+    uint8_t m_witness[81]; // 最近找到的一个解
+
+    bool m_hasWitness;
+
+    unsigned long long m_nodes;
+};
+
+#endif // FEASIBILITY_H
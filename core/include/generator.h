@@ -0,0 +1,48 @@
+﻿/**
+ * @file generator.h
+ * @brief Random puzzle generator
+ */
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstdint>
+#include <random>
+
+/**
+ * @brief The Generator class 生成随机的唯一解谜题
+ * @details 先用随机顺序的回溯法填出一个终盘，再按随机顺序尝试删除线索，
+ * 删除后仍然只有唯一解就保留删除，直到线索数降到指定的下限或者无法再删除
+ */
+class Generator
+{
+public:
+    explicit Generator(uint32_t seed);
+
+    /**
+     * @brief 生成一个随机终盘
+     * @param grid 输出，按行排列的81个数字
+     */
+    void fillGrid(uint8_t *grid);
+
+    /**
+     * @brief 生成一个唯一解谜题
+     * @param puzzle 输出的谜面，0表示空格
+     * @param solution 输出的答案
+     * @param minClues 线索数下限，线索越多谜题通常越简单；为0时删到不能再删为止
+     * @return 谜面的线索数
+     */
+    int generate(uint8_t *puzzle, uint8_t *solution, int minClues = 0);
+
+    /**
+     * @brief 统计谜题的解的个数，最多数到limit
+     */
+    static int countSolutions(const uint8_t *puzzle, int limit);
+
+private:
+    bool fill(uint8_t *grid, unsigned *units, int cell);
+
+    std::mt19937 m_rng;
+};
+
+#endif // GENERATOR_H
@@ -0,0 +1,176 @@
+﻿/**
+ * @file packedcorpus.h
+ * @brief Packed binary puzzle corpus with O(1) random access
+ *
+ * File layout (little-endian):
+ *
+ *     header   96 bytes, see CorpusHeader
+ *     records  count fixed-size records, grouped by difficulty
+ *
+ * Each record is the puzzle packed at 4 bits per cell (41 bytes), followed by
+ * the optional fields selected in the header flags: the solution (41 bytes),
+ * the score in tenths (2 bytes) and the clue count (1 byte). The header keeps
+ * the first record and the number of records of every difficulty, so picking
+ * a random puzzle of a given difficulty is a single index computation.
+ */
+
+#ifndef PACKEDCORPUS_H
+#define PACKEDCORPUS_H
+
+#include "rater.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief 记录中包含的可选字段
+ */
+enum CorpusField
+{
+    CORPUS_SOLUTION = 1, // 答案
+    CORPUS_SCORE = 2,    // 分数
+    CORPUS_CLUES = 4     // 线索数
+};
+
+/**
+ * @brief 文件头，按小端序存放
+ */
+struct CorpusHeader
+{
+    char magic[8];                          // "SDKCORP\0"
+    uint32_t version;                       // 格式版本
+    uint32_t fields;                        // CorpusField的组合
+    uint32_t recordSize;                    // 每条记录的字节数
+    uint32_t levels;                        // 难度个数
+    uint64_t count;                         // 记录总数
+    uint64_t levelStart[DIFFICULTY_COUNT];  // 每个难度的第一条记录
+    uint64_t levelCount[DIFFICULTY_COUNT];  // 每个难度的记录数
+};
+
+/**
+ * @brief 解码后的一条记录
+ */
+struct CorpusRecord
+{
+    uint8_t puzzle[81];
+    uint8_t solution[81]; // 没有答案字段时全为0
+    double score;         // 没有分数字段时为0
+    int clues;
+};
+
+/**
+ * @brief The PackedCorpus class 打包格式的编码和解码
+ */
+class PackedCorpus
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    static const size_t HEADER_SIZE = 96;
+
+    /**
+     * @brief 按字段计算记录的大小
+     */
+    static uint32_t recordSize(uint32_t fields);
+
+    /**
+     * @brief 把81格压缩为41字节，偶数格在低4位
+     */
+    static void pack(const uint8_t *cells, uint8_t *packed);
+
+    static void unpack(const uint8_t *packed, uint8_t *cells);
+};
+
+/**
+ * @brief The CorpusWriter class 流式写出打包的谜题库
+ * @details 记录先按难度写入各自的临时文件，关闭时写出文件头并依次拼接，
+ * 内存占用与谜题数无关
+ */
+class CorpusWriter
+{
+public:
+    CorpusWriter();
+
+    ~CorpusWriter();
+
+    /**
+     * @brief 创建文件
+     * @param fields 要保存的可选字段
+     */
+    bool open(const std::string &path, uint32_t fields);
+
+    /**
+     * @brief 写入一道谜题
+     * @param solution 答案，可以为nullptr
+     */
+    bool add(const uint8_t *puzzle, const uint8_t *solution, double score);
+
+    /**
+     * @brief 写出文件头并拼接各难度的记录
+     */
+    bool close();
+
+    const std::string &errorString() const;
+
+private:
+    std::string tempPath(int level) const;
+
+    void discard();
+
+    std::string m_path;
+
+    uint32_t m_fields;
+
+    FILE *m_temp[DIFFICULTY_COUNT];
+
+    uint64_t m_count[DIFFICULTY_COUNT];
+
+    std::string m_error;
+};
+
+/**
+ * @brief The CorpusView class 在已映射到内存的谜题库上随机访问
+ * @details 不拷贝也不解析整个文件，只校验文件头，每次访问解码一条记录
+ */
+class CorpusView
+{
+public:
+    CorpusView();
+
+    /**
+     * @brief 绑定到一段内存，通常是mmap得到的文件内容
+     * @return 文件头和大小是否有效
+     */
+    bool attach(const uint8_t *data, size_t size);
+
+    void detach();
+
+    bool isValid() const;
+
+    uint32_t fields() const;
+
+    uint64_t count() const;
+
+    /**
+     * @brief 某个难度的记录数
+     */
+    uint64_t count(Difficulty level) const;
+
+    /**
+     * @brief 读取第index条记录
+     */
+    void record(uint64_t index, CorpusRecord &out) const;
+
+    /**
+     * @brief 读取某个难度的第index条记录
+     */
+    void record(Difficulty level, uint64_t index, CorpusRecord &out) const;
+
+private:
+    const uint8_t *m_data;
+
+    CorpusHeader m_header;
+};
+
+#endif // PACKEDCORPUS_H
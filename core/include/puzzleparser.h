@@ -0,0 +1,131 @@
+﻿/**
+ * @file puzzleparser.h
+ * @brief Streaming puzzle parser for the common sudoku text formats
+ *
+ * The format is detected line by line, so files may mix layouts:
+ *
+ *     81-cell lines      "4.....8.5.3.........." with '.' or '0' blanks;
+ *                        anything after the 81st cell and a blank is ignored
+ *     spaced 9x9 grids   "9 5 0 7 0 0 0 0 0" (resources/1.txt)
+ *     SDK grids          nine lines of nine cells, "#" metadata lines
+ *     SS grids           "..6|...|..3" rows and "---+---+---" separators
+ *
+ * Puzzles are written straight into the caller's buffer, 81 cells each, with
+ * no intermediate strings. PuzzleReader adds the input side: regular files
+ * are memory-mapped, pipes are read in chunks, and compact files (see
+ * compactcodec.h) are recognized by their magic.
+ */
+
+#ifndef PUZZLEPARSER_H
+#define PUZZLEPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The PuzzleParser class 逐行解析文本谜题
+ */
+class PuzzleParser
+{
+public:
+    PuzzleParser();
+
+    /**
+     * @brief 丢弃未完成的9x9谜题和统计
+     */
+    void reset();
+
+    /**
+     * @brief 解析一行，不含换行符
+     * @return 得到完整的谜题时写入puzzle并返回true
+     */
+    bool feedLine(const char *line, size_t length, uint8_t *puzzle);
+
+    /**
+     * @brief 解析一段文本中的行，最多写出capacity道谜题
+     * @param final 为true时末尾没有换行符的部分也作为一行处理，否则留给调用者与后续数据拼接
+     * @param out 输出缓冲区，每道谜题81字节
+     * @param consumed 已处理的字节数
+     * @return 写出的谜题数
+     */
+    size_t parse(const char *data, size_t size, bool final, uint8_t *out, size_t capacity, size_t &consumed);
+
+    /**
+     * @brief 无法识别而跳过的行数，包括末尾未完成的9x9谜题
+     */
+    size_t skipped() const;
+
+private:
+    uint8_t m_grid[81];
+
+    int m_rows; // 已累积的9x9谜题行数
+
+    size_t m_skipped;
+};
+
+/**
+ * @brief The PuzzleReader class 从文件或标准输入读取谜题
+ * @details 普通文件整体映射到内存，管道和Windows下分块读取；文本和紧凑格式都写出81格的谜题
+ */
+class PuzzleReader
+{
+public:
+    PuzzleReader();
+
+    ~PuzzleReader();
+
+    /**
+     * @brief 打开文件，"-"表示标准输入
+     */
+    bool open(const std::string &path);
+
+    void close();
+
+    /**
+     * @brief 读取至多capacity道谜题到out，每道81字节
+     * @return 读取的谜题数，到达末尾时返回0
+     */
+    size_t read(uint8_t *out, size_t capacity);
+
+    /**
+     * @brief 是否为紧凑格式
+     */
+    bool isCompact() const;
+
+    /**
+     * @brief 跳过的行数；紧凑格式末尾无法解码的数据计为一项
+     */
+    size_t skipped() const;
+
+    const std::string &errorString() const;
+
+private:
+    bool refill();
+
+    FILE *m_file;
+
+    bool m_mapped;
+
+    const char *m_data; // 映射的文件或m_buffer
+
+    size_t m_size;
+
+    size_t m_pos;
+
+    bool m_eof;
+
+    bool m_compact;
+
+    size_t m_invalid;
+
+    std::vector<char> m_buffer;
+
+    PuzzleParser m_parser;
+
+    std::string m_error;
+};
+
+#endif // PUZZLEPARSER_H
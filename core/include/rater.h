@@ -0,0 +1,250 @@
+﻿/**
+ * @file rater.h
+ * @brief Human-style difficulty rating of sudoku puzzles
+ */
+
+#ifndef RATER_H
+#define RATER_H
+
+#include "bitboard.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 解题技巧，按难度从低到高排列
+ */
+enum Technique
+{
+    HIDDEN_SINGLE,
+    NAKED_SINGLE,
+    POINTING,
+    CLAIMING,
+    NAKED_PAIR,
+    X_WING,
+    HIDDEN_PAIR,
+    NAKED_TRIPLE,
+    SWORDFISH,
+    HIDDEN_TRIPLE,
+    XY_WING,
+    XYZ_WING,
+    NAKED_QUAD,
+    JELLYFISH,
+    HIDDEN_QUAD,
+    X_CHAIN,
+    XY_CHAIN,
+    TRIAL_AND_ERROR, // 以上技巧都无法继续，只能试错
+    TECHNIQUE_COUNT
+};
+
+/**
+ * @brief 难度等级，由评分划分
+ */
+enum Difficulty
+{
+    EASY,   // 只需要唯一数
+    MEDIUM, // 区块、数对和X-Wing
+    HARD,   // 三链数、剑鱼和XY-Wing等
+    EXPERT, // 四链数、水母、链和试错
+    DIFFICULTY_COUNT
+};
+
+/**
+ * @brief 一步推理的结果
+ */
+struct Deduction
+{
+    Technique technique;
+    int cell;                      // 可以确定的格子，只删除候选数时为-1
+    int digit;                     // 该格子的值
+    std::vector<int> pattern;      // 构成该技巧的格子，用于提示
+    std::vector<int> eliminations; // 被删除的候选数，编码为cell * 9 + digit - 1
+};
+
+/**
+ * @brief 查找推理的结果
+ */
+enum DeductionResult
+{
+    DEDUCTION_FOUND,         // 找到了一步推理
+    DEDUCTION_STUCK,         // 所有技巧都无法推进，只能试错
+    DEDUCTION_CONTRADICTION, // 盘面已经出现矛盾，无解
+    DEDUCTION_SOLVED         // 所有格子都已填好
+};
+
+/**
+ * @brief 评分结果
+ */
+struct Rating
+{
+    bool valid;        // 谜面是否没有矛盾
+    bool solved;       // 是否只用逻辑技巧就能解出
+    Technique hardest; // 用到的最难的技巧
+    double score;      // 最难技巧的分数
+    int steps;         // 推理步数
+};
+
+/**
+ * @brief The Rater class 模拟人的解题过程为谜题评分
+ * @details 每一步都从最简单的技巧开始尝试，找到能推进的技巧就应用，然后重新开始，
+ * 谜题的分数是整个过程中用到的最难技巧的分数。
+ * 所有技巧共享同一份候选数状态：每格一个9位的候选数掩码，以及每个数字一个81位的位置集合，
+ * 填数和删除候选数时增量维护，技巧之间不需要重新计算。
+ */
+class Rater
+{
+public:
+    Rater();
+
+    /**
+     * @brief 加载谜题
+     * @param puzzle 按行排列的81个数字，0表示空格
+     * @return 谜面是否没有直接冲突
+     */
+    bool load(const uint8_t *puzzle);
+
+    /**
+     * @brief 加载盘面和别处维护好的候选数，不再从数字推导候选数
+     * @param values 按行排列的81个数字，允许出现冲突
+     * @param candidates 每个空格的候选数掩码，已填的格子被忽略
+     */
+    void load(const uint8_t *values, const uint16_t *candidates);
+
+    /**
+     * @brief 修改一个格子的值，0表示清空
+     * @details 用于跟随玩家的操作维护候选数：只重新计算该格子和它的20个相关格子，
+     * 允许出现冲突。这些格子上由技巧删除的候选数会被恢复
+     */
+    void setValue(int cell, int digit);
+
+    /**
+     * @brief 查找下一步推理，不修改当前状态
+     * @param deduction 找到的推理，只在返回DEDUCTION_FOUND时有效
+     */
+    DeductionResult findDeduction(Deduction &deduction) const;
+
+    /**
+     * @brief 应用一步推理
+     */
+    void apply(const Deduction &deduction);
+
+    /**
+     * @brief 从当前状态开始一直推理到结束，给出评分
+     */
+    Rating rate();
+
+    /**
+     * @brief 当前状态是否已经出现矛盾
+     */
+    bool isBroken() const;
+
+    /**
+     * @brief 是否有单元中出现了重复的数字
+     */
+    bool hasConflicts() const;
+
+    /**
+     * @brief 是否所有格子都已填好
+     */
+    bool isFilled() const;
+
+    /**
+     * @brief 返回格子的值，0表示未填
+     */
+    int value(int cell) const;
+
+    /**
+     * @brief 返回格子的候选数掩码，第i位表示数字i+1
+     */
+    int candidates(int cell) const;
+
+    /**
+     * @brief 为一批谜题评分
+     * @param puzzles 连续存放的谜题，每个81字节
+     * @param count 谜题个数
+     * @param ratings 评分结果，长度为count
+     * @param threads 线程数，小于1时使用全部核心
+     */
+    static void rateBatch(const uint8_t *puzzles, size_t count, Rating *ratings, int threads);
+
+    /**
+     * @brief 返回技巧的名称
+     */
+    static const char *techniqueName(Technique technique);
+
+    /**
+     * @brief 返回技巧的分数
+     */
+    static double techniqueScore(Technique technique);
+
+    /**
+     * @brief 根据分数划分难度
+     */
+    static Difficulty difficultyOf(double score);
+
+    /**
+     * @brief 返回难度的名称
+     */
+    static const char *difficultyName(Difficulty difficulty);
+
+private:
+    void place(int cell, int digit);
+
+    bool eliminate(int cell, int digit);
+
+    /**
+     * @brief 根据所在单元已填的数字重新计算格子的候选数
+     */
+    void refresh(int cell);
+
+    /**
+     * @brief 把targets中数字digit的候选数加入删除列表
+     */
+    void addEliminations(Deduction &deduction, Bitboard targets, int digit) const;
+
+    /**
+     * @brief 是否有未填的格子没有候选数，或者某个单元中有数字无处可填
+     */
+    bool hasContradiction() const;
+
+    bool findHiddenSingle(Deduction &deduction) const;
+
+    bool findNakedSingle(Deduction &deduction) const;
+
+    bool findPointing(Deduction &deduction) const;
+
+    bool findClaiming(Deduction &deduction) const;
+
+    bool findNakedSubset(Deduction &deduction, int size) const;
+
+    bool findHiddenSubset(Deduction &deduction, int size) const;
+
+    bool findFish(Deduction &deduction, int size) const;
+
+    bool findXYWing(Deduction &deduction) const;
+
+    bool findXYZWing(Deduction &deduction) const;
+
+    bool findXChain(Deduction &deduction) const;
+
+    bool findXYChain(Deduction &deduction) const;
+
+    int m_value[81]; // 每格的值
+
+    uint16_t m_cand[81]; // 每格的候选数，已填的格子为0
+
+    Bitboard m_pos[9]; // 每个数字可以填入的格子
+
+    uint16_t m_placed[27]; // 每个单元已经填入的数字
+
+    uint8_t m_count[27][9]; // 每个单元中每个数字出现的次数
+
+    int m_conflicts; // 重复出现的次数之和
+
+    int m_remaining; // 未填的格子数
+
+    bool m_broken; // 是否出现矛盾
+};
+
+#endif // RATER_H
@@ -0,0 +1,100 @@
+﻿/**
+ * @file repair.h
+ * @brief Smallest set of player entries to erase so that a board becomes solvable
+ *
+ * A board that has no solution contains unsatisfiable cores: sets of player
+ * entries that cannot all stay, whatever happens to the other entries. The
+ * smallest repair is a minimum hitting set of all cores, found without
+ * enumerating subsets by the implicit hitting set loop:
+ *
+ *   1. take a minimum hitting set H of the cores found so far (empty at first);
+ *   2. if the board without the entries in H is solvable, H is the answer;
+ *   3. otherwise shrink the remaining entries to a minimal core, add it and
+ *      go back to 1.
+ *
+ * Cores are shrunk by insertion: entries are added one at a time to the
+ * entries already known to be in the core until the board becomes unsolvable,
+ * and the last one added joins the core. Each round only ever adds digits, so
+ * the FeasibilityChecker places them on top of the previous propagated state
+ * and most steps are decided by its last solution without any search.
+ */
+
+#ifndef REPAIR_H
+#define REPAIR_H
+
+#include "bitboard.h"
+#include "feasibility.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 修复的结果
+ */
+enum RepairResult
+{
+    REPAIR_FOUND,      // 找到了要删除的格子，盘面本来有解时为空集
+    REPAIR_UNSOLVABLE, // 只有谜面也无解，删除填入的数字没有用
+    REPAIR_STOPPED     // 预算用完或被取消
+};
+
+/**
+ * @brief The RepairSearch class 找出最少要删除的玩家填入的数字
+ * @details 不能被多个线程同时使用
+ */
+class RepairSearch
+{
+public:
+    RepairSearch();
+
+    /**
+     * @brief 搜索最小的删除集合
+     * @param clues 谜面，按行排列的81个数字
+     * @param entries 玩家填入的数字，谜面格子和空格为0
+     * @param removal 输出要删除的格子
+     * @param budget 每次判断是否有解的预算
+     */
+    RepairResult run(const uint8_t *clues, const uint8_t *entries, Bitboard &removal,
+                     const SolveBudget &budget = SolveBudget());
+
+    /**
+     * @brief 上一次搜索找到的极小冲突集合
+     */
+    const std::vector<Bitboard> &cores() const;
+
+    /**
+     * @brief 上一次搜索判断是否有解的次数
+     */
+    int checks() const;
+
+private:
+    /**
+     * @brief 谜面加上cells中的玩家数字是否有解
+     */
+    Feasibility check(const Bitboard &cells);
+
+    /**
+     * @brief 把无解的集合cells缩小为极小冲突集合
+     * @return 是否没有用完预算
+     */
+    bool shrink(Bitboard cells, Bitboard &core);
+
+    /**
+     * @brief 在chosen的基础上搜索命中所有冲突集合的最小集合
+     */
+    void hit(const Bitboard &chosen, int size, Bitboard &best, int &bestSize) const;
+
+    FeasibilityChecker m_checker;
+
+    SolveBudget m_budget;
+
+    uint8_t m_clues[81];
+
+    uint8_t m_entries[81];
+
+    std::vector<Bitboard> m_cores;
+
+    int m_checks;
+};
+
+#endif // REPAIR_H
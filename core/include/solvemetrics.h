@@ -0,0 +1,160 @@
+﻿/**
+ * @file solvemetrics.h
+ * @brief Latency histograms of solver operations with per-thread recording
+ *
+ * LatencyHistogram is a log-linear (HDR-style) histogram of nanosecond
+ * values: values below 16 have a bucket each, and every power of two above
+ * that is split into 16 buckets, so a reported percentile is at most 1/16
+ * above the true value over the whole 64-bit range.
+ *
+ * SolveMetrics keeps one set of histograms per recording thread. A thread
+ * only ever writes its own shard, so recording is a few plain stores with no
+ * lock and no contended cache line; readers merge the shards on demand. The
+ * merged view can be exported as Prometheus text (summaries with quantile
+ * labels) or as JSON.
+ */
+
+#ifndef SOLVEMETRICS_H
+#define SOLVEMETRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class SudokuSolver;
+
+/**
+ * @brief 统计的操作；PROPAGATE和SEARCH是求解内部的两个阶段
+ */
+enum SolveMetric
+{
+    METRIC_SOLVE,      // 求一个解
+    METRIC_UNIQUENESS, // 数解的个数，检验唯一解
+    METRIC_RATE,
+    METRIC_GENERATE,
+    METRIC_PROPAGATE, // 填数、唯一余数和隐性唯一数
+    METRIC_SEARCH,    // 选择分支格子、复制状态等其余时间
+    METRIC_COUNT
+};
+
+/**
+ * @brief The LatencyHistogram class 对数线性分桶的延迟直方图，单位纳秒
+ * @details record只能由一个线程调用；其他线程可以同时读取或用add合并，
+ * 读到的计数可能比正在写入的少一个
+ */
+class LatencyHistogram
+{
+public:
+    static const int SUB_BITS = 4; // 每个2的幂区间分2^SUB_BITS个桶
+
+    static const int BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+    LatencyHistogram();
+
+    void record(uint64_t nanos);
+
+    /**
+     * @brief 把other的计数累加进来，可以和other的record同时进行
+     */
+    void add(const LatencyHistogram &other);
+
+    void reset();
+
+    uint64_t count() const;
+
+    uint64_t sum() const;
+
+    uint64_t max() const;
+
+    double mean() const;
+
+    /**
+     * @brief 百分位数，返回所在桶的上界，不超过最大值
+     * @param fraction 0到1之间
+     */
+    uint64_t percentile(double fraction) const;
+
+    static int bucketOf(uint64_t nanos);
+
+    static uint64_t bucketLimit(int bucket);
+
+private:
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    std::atomic<uint64_t> m_buckets[BUCKETS];
+
+    std::atomic<uint64_t> m_count;
+
+    std::atomic<uint64_t> m_sum;
+
+    std::atomic<uint64_t> m_max;
+};
+
+/**
+ * @brief The SolveMetrics class 按线程分片记录各操作的延迟
+ * @details 每个线程第一次记录时分配自己的分片并无锁地挂到链表上，之后只写自己的分片；
+ * 分片在对象析构时才释放。线程退出后分片留给之后复用同一线程号的线程
+ */
+class SolveMetrics
+{
+public:
+    SolveMetrics();
+
+    ~SolveMetrics();
+
+    /**
+     * @brief 记录当前线程的一次操作
+     */
+    void record(SolveMetric metric, uint64_t nanos);
+
+    /**
+     * @brief 记录一次求解，求解器开启了阶段计时时同时记录传播和搜索的时间
+     * @param metric METRIC_SOLVE或METRIC_UNIQUENESS
+     * @param nanos 整个求解的时间
+     */
+    void recordSolve(SolveMetric metric, uint64_t nanos, const SudokuSolver &solver);
+
+    /**
+     * @brief 合并所有线程的分片
+     * @param out 先被清空
+     */
+    void snapshot(SolveMetric metric, LatencyHistogram &out) const;
+
+    /**
+     * @brief 清空所有分片，可以和record同时进行，但同时记录的值可能部分丢失
+     */
+    void reset();
+
+    static const char *metricName(SolveMetric metric);
+
+    /**
+     * @brief Prometheus文本格式，每个操作一个summary
+     * @param prefix 指标名的前缀，如"sudoku"
+     */
+    std::string toPrometheus(const std::string &prefix = "sudoku") const;
+
+    /**
+     * @brief JSON对象，每个操作的次数、平均值和百分位数，单位微秒
+     */
+    std::string toJson() const;
+
+    /**
+     * @brief 写入文件，扩展名为.json时写JSON，否则写Prometheus文本
+     */
+    bool writeFile(const std::string &path) const;
+
+private:
+    struct Shard;
+
+    SolveMetrics(const SolveMetrics &) = delete;
+    SolveMetrics &operator=(const SolveMetrics &) = delete;
+
+    Shard *localShard();
+
+    std::atomic<Shard *> m_shards;
+
+    uint64_t m_id; // 进程内唯一的编号，线程用它识别缓存的分片属于哪个对象
+};
+
+#endif // SOLVEMETRICS_H
@@ -0,0 +1,174 @@
+﻿/**
+ * @file solvering.h
+ * @brief Shared-memory ring of puzzle/solution slots for co-located processes
+ *
+ * A solver daemon creates the ring as a POSIX shared-memory object; producer
+ * processes attach to it and exchange puzzles without sockets or
+ * serialization. Every slot carries its own sequence number, which moves
+ * through the states of ticket t:
+ *
+ *     t        free, the producer holding ticket t may write the puzzle
+ *     t + 1    submitted, waiting for a solver thread
+ *     t + 2    done, the solution is in the slot
+ *     t + N    released, free for ticket t + N (N = slot count)
+ *
+ * Producers write the puzzle straight into the slot and read the solution
+ * from it. Idle solver threads sleep on a futex doorbell that producers only
+ * ring when somebody is asleep; producers waiting for a result or a free slot
+ * sleep on the slot's sequence. A ticket is only taken when its slot is free,
+ * and slots are served in ticket order, so a producer that dies while holding
+ * a slot would stall the ring. Each slot therefore records the pid of its
+ * holder, and reclaim() hands the slots of exited producers back: a slot that
+ * was never submitted is submitted empty, a finished one is released. Producers
+ * must share the daemon's pid namespace for this to work.
+ *
+ * Linux only; elsewhere create() and attach() fail.
+ */
+
+#ifndef SOLVERING_H
+#define SOLVERING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief 环中的一个槽位，占三个缓存行
+ */
+struct RingSlot
+{
+    std::atomic<uint32_t> sequence; // 状态，见文件说明
+    std::atomic<uint32_t> waiters;  // 在sequence上睡眠的进程数
+    int32_t limit;                  // 生产者填写：最多数到几个解，0表示空槽位，不求解
+    int32_t result;                 // 求解结果：解的个数，-1表示输入无效
+    uint64_t nodes;                 // 搜索节点数
+    std::atomic<int32_t> owner;     // 持有槽位的生产者进程号，0表示无人持有，-1表示正在收回
+    uint8_t puzzle[81];             // 生产者写入的谜题，0表示空格
+    uint8_t solution[81];           // 求解后的答案，无解时全为0
+    uint8_t reserved[2];
+};
+
+/**
+ * @brief 共享内存开头的控制块，各个计数器在不同的缓存行上
+ */
+struct RingHeader
+{
+    char magic[8]; // "SDKRING\0"
+    uint32_t version;
+    uint32_t slotCount;
+    alignas(64) std::atomic<uint32_t> head;     // 生产者的下一个票号
+    alignas(64) std::atomic<uint32_t> tail;     // 求解线程的下一个票号
+    alignas(64) std::atomic<uint32_t> doorbell; // 每次提交加一
+    std::atomic<uint32_t> sleepers;             // 在doorbell上睡眠的求解线程数
+};
+
+/**
+ * @brief The SolveRing class 映射共享内存中的槽位环
+ * @details 守护进程调用create并用next/complete处理槽位；
+ * 生产者调用attach，按acquire、写谜题、submit、wait、读答案、release的顺序使用槽位。
+ * 一个生产者可以同时持有多个槽位；有多个求解线程时，槽位不一定按票号顺序完成
+ */
+class SolveRing
+{
+public:
+    static const uint32_t VERSION = 2;
+
+    SolveRing();
+
+    /**
+     * @brief 解除映射；创建者同时删除共享内存对象
+     */
+    ~SolveRing();
+
+    /**
+     * @brief 创建共享内存对象，已有的同名对象被替换
+     * @param name 以'/'开头的名字
+     * @param slots 槽位数，2的幂且不小于4
+     */
+    bool create(const std::string &name, uint32_t slots);
+
+    /**
+     * @brief 映射守护进程已创建的环
+     */
+    bool attach(const std::string &name);
+
+    void detach();
+
+    uint32_t slotCount() const;
+
+    const std::string &errorString() const;
+
+    /**
+     * @brief 领取下一个票号和对应的槽位
+     * @return 环满时返回nullptr
+     */
+    RingSlot *tryAcquire(uint32_t &ticket);
+
+    /**
+     * @brief 领取槽位，环满时等待
+     * @details 只能在不持有其他槽位时调用；持有槽位的生产者应当用tryAcquire，
+     * 失败时先归还自己已完成的槽位，否则多个生产者会互相等待
+     */
+    RingSlot *acquire(uint32_t &ticket);
+
+    /**
+     * @brief 谜题和limit写好后交给守护进程
+     */
+    void submit(RingSlot *slot, uint32_t ticket);
+
+    /**
+     * @brief 等待槽位求解完成
+     * @param timeoutMs 毫秒，负数表示一直等待
+     * @return 超时返回false
+     */
+    bool wait(RingSlot *slot, uint32_t ticket, int timeoutMs = -1);
+
+    /**
+     * @brief 读完答案后归还槽位
+     */
+    void release(RingSlot *slot, uint32_t ticket);
+
+    /**
+     * @brief 取出下一个已提交的槽位，没有时睡眠
+     * @param stop 为true且被wakeSolvers唤醒时返回nullptr
+     */
+    RingSlot *next(uint32_t &ticket, const std::atomic<bool> &stop);
+
+    /**
+     * @brief 写好答案后通知生产者
+     */
+    void complete(RingSlot *slot, uint32_t ticket);
+
+    /**
+     * @brief 唤醒所有睡眠的求解线程，用于停止守护进程
+     */
+    void wakeSolvers();
+
+    /**
+     * @brief 收回持有者进程已经退出的槽位
+     * @details 未提交的槽位作为空槽位提交，已完成的槽位直接归还。
+     * 守护进程定期调用；多个进程同时调用也是安全的
+     * @return 本次收回的槽位数
+     */
+    uint32_t reclaim();
+
+private:
+    bool map(int fd, size_t size);
+
+    RingHeader *m_header;
+
+    RingSlot *m_slots;
+
+    size_t m_size;
+
+    std::string m_name;
+
+    bool m_owner;
+
+    int32_t m_pid; // 本进程的进程号，领取槽位时写入
+
+    std::string m_error;
+};
+
+#endif // SOLVERING_H
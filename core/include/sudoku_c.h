@@ -0,0 +1,83 @@
+﻿/**
+ * @file sudoku_c.h
+ * @brief Stable C interface of the sudoku core library
+ */
+
+#ifndef SUDOKU_C_H
+#define SUDOKU_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 静态库定义SUDOKU_STATIC；构建动态库时定义SUDOKU_BUILD以导出符号
+ */
+#if defined(SUDOKU_STATIC)
+#  define SUDOKU_API
+#elif defined(_WIN32)
+#  if defined(SUDOKU_BUILD)
+#    define SUDOKU_API __declspec(dllexport)
+#  else
+#    define SUDOKU_API __declspec(dllimport)
+#  endif
+#else
+#  define SUDOKU_API __attribute__((visibility("default")))
+#endif
+
+/* 接口版本，只在不兼容的修改时增加 */
+#define SUDOKU_ABI_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 单个谜题的求解结果 */
+enum sudoku_status
+{
+    SUDOKU_SOLVED = 1,      /* 找到了解 */
+    SUDOKU_NO_SOLUTION = 0, /* 无解 */
+    SUDOKU_INVALID = -1     /* 数字超出0-9的范围 */
+};
+
+/**
+ * @brief 返回库的版本字符串，例如"1.0.0"
+ */
+SUDOKU_API const char *sudoku_version(void);
+
+/**
+ * @brief 返回库的接口版本，调用方可以与SUDOKU_ABI_VERSION比较
+ */
+SUDOKU_API int sudoku_abi_version(void);
+
+/**
+ * @brief 求解一个谜题
+ * @param puzzle 按行排列的81个数字，0表示空格
+ * @param solution 调用方提供的81字节缓冲区，无解时填0
+ * @return sudoku_status
+ */
+SUDOKU_API int sudoku_solve(const uint8_t *puzzle, uint8_t *solution);
+
+/**
+ * @brief 统计谜题的解的个数
+ * @param limit 最多数到limit，检验唯一解时传入2
+ * @return 解的个数；输入无效时为SUDOKU_INVALID
+ */
+SUDOKU_API int sudoku_count(const uint8_t *puzzle, int limit);
+
+/**
+ * @brief 批量求解
+ * @param puzzles 连续存放的谜题，每个81字节
+ * @param count 谜题个数
+ * @param solutions 调用方提供的缓冲区，长度为count * 81，无解的谜题填0
+ * @param status 每个谜题的sudoku_status，长度为count，可以为NULL
+ * @param threads 线程数，小于1时使用全部核心，为1时在调用线程中完成
+ * @return 成功求解的谜题数
+ */
+SUDOKU_API size_t sudoku_solve_batch(const uint8_t *puzzles, size_t count, uint8_t *solutions,
+                                     int *status, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SUDOKU_C_H */
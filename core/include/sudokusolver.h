@@ -0,0 +1,194 @@
+﻿/**
+ * @file sudokusolver.h
+ * @brief Main class for generate and solve sudoku
+ * @author Joe chen <joechenrh@gmail.com>
+ */
+
+#ifndef SUDOKUSOLVER_H
+#define SUDOKUSOLVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief 求解的预算：节点数、时间和外部的取消标志，任意一项用完即停止
+ */
+struct SolveBudget
+{
+    unsigned long long maxNodes = 0;                     // 0表示不限
+    long long maxMillis = 0;                             // 0表示不限
+    const std::atomic<bool> *cancel = nullptr;           // 其他线程置为true时停止
+    std::atomic<unsigned long long> *progress = nullptr; // 求解中定期写入已访问的节点数
+};
+
+/**
+ * @brief 求解停止的原因
+ */
+enum SolveStop
+{
+    STOP_NONE,      // 正常结束
+    STOP_CANCELLED, // 被取消
+    STOP_NODES,     // 节点数用完
+    STOP_TIME       // 时间用完
+};
+
+/**
+ * @brief The SudokuSolver class 回溯法求解数独
+ * @details 每格一个9位的候选数掩码，填数时从20个相关格子中删除该数字，
+ * 再反复应用唯一余数和隐性唯一数，直到无法推进时选择候选数最少的格子分支。
+ * 每一层搜索的状态都保存在对象内部的固定数组里，求解过程中不分配内存，
+ * 同一个对象可以反复使用，但不能被多个线程同时使用。
+ * 设置了预算时每访问256个节点检查一次，用完后放弃搜索。
+ * 第0层状态在搜索中保持不变，可以用prepare和assign逐步填数、增量传播，
+ * 再用resume从这个状态开始搜索，不必每次从谜面重新传播
+ */
+class SudokuSolver
+{
+public:
+    SudokuSolver();
+
+    /**
+     * @brief 求解谜题
+     * @param puzzle 按行排列的81个数字，0表示空格
+     * @param solution 输出找到的第一个解，可以为nullptr
+     * @param limit 找到limit个解后停止，检验唯一解时传入2
+     * @return 找到的解的个数，最多为limit；谜面有冲突或数字超出范围时为0
+     */
+    int solve(const uint8_t *puzzle, uint8_t *solution = nullptr, int limit = 1);
+
+    /**
+     * @brief 求解谜题并输出找到的每一个解
+     * @param solutions 长度为81 * limit，按找到的顺序依次写入
+     * @return 同solve
+     */
+    int solveAll(const uint8_t *puzzle, uint8_t *solutions, int limit);
+
+    /**
+     * @brief 只填入谜面并传播，保留结果作为之后assign和resume的起点
+     * @return 是否没有出现矛盾
+     */
+    bool prepare(const uint8_t *puzzle);
+
+    /**
+     * @brief 在保留的状态上再填一个数并传播，只能增加数字，删除数字需要重新prepare
+     * @return 是否没有出现矛盾；出现矛盾后状态作废，之后的assign和resume都失败
+     */
+    bool assign(int cell, int digit);
+
+    /**
+     * @brief 从保留的状态开始搜索，该状态不变，可以继续assign
+     * @return 同solve
+     */
+    int resume(uint8_t *solution = nullptr, int limit = 1);
+
+    /**
+     * @brief 上一次求解访问的搜索节点数
+     */
+    unsigned long long nodes() const;
+
+    /**
+     * @brief 之后每次求解使用的预算，默认不限
+     */
+    void setBudget(const SolveBudget &budget);
+
+    /**
+     * @brief 上一次求解停止的原因；不是STOP_NONE时返回的解的个数不完整
+     */
+    SolveStop stopReason() const;
+
+    /**
+     * @brief 开启后每次求解分别统计传播的时间，每个搜索节点多两次读时钟
+     */
+    void setPhaseTiming(bool enabled);
+
+    bool phaseTiming() const;
+
+    /**
+     * @brief 上一次求解中填数和传播所用的纳秒数，其余是选择分支和复制状态的时间；
+     * 未开启阶段计时时为0
+     */
+    unsigned long long propagateNanos() const;
+
+private:
+    /**
+     * @brief 一层搜索的状态
+     */
+    struct State
+    {
+        uint16_t cand[81]; // 未填格子的候选数，已填的格子为0
+        uint8_t value[81]; // 每格的值
+        int remaining;     // 未填的格子数
+    };
+
+    /**
+     * @brief 清零计数并按预算设置截止时间
+     */
+    void resetCounters();
+
+    /**
+     * @brief 在第0层状态中填入谜面并传播
+     * @return 是否没有出现矛盾
+     */
+    bool load(const uint8_t *puzzle);
+
+    /**
+     * @brief 第0层状态没有矛盾时从它开始搜索
+     * @return 找到的解的个数
+     */
+    int finish(uint8_t *solution, int limit);
+
+    /**
+     * @brief 在格子中填入数字并从相关格子中删除该数字，新出现的唯一余数加入队列
+     * @return 是否没有出现矛盾
+     */
+    bool place(State &state, int cell, int digit);
+
+    /**
+     * @brief 处理队列中的唯一余数，并查找隐性唯一数，直到无法推进
+     * @return 是否没有出现矛盾
+     */
+    bool propagate(State &state);
+
+    /**
+     * @brief 在next中填数并传播，开启阶段计时时累计所用的时间
+     */
+    bool advance(State &next, int cell, int digit);
+
+    /**
+     * @brief 检查预算，用完时设置m_stop
+     */
+    void checkBudget();
+
+    void search(int depth);
+
+    State m_stack[82]; // 每层搜索一个状态，最多填81次
+
+    int m_queue[81]; // 待填入的唯一余数
+
+    int m_queued;
+
+    uint8_t *m_solution;
+
+    int m_limit; // 解的个数上限
+
+    int m_num; // 已找到的解的个数
+
+    bool m_all; // 是否写出每一个解，否则只写第一个
+
+    unsigned long long m_nodes;
+
+    bool m_timing;
+
+    SolveBudget m_budget;
+
+    SolveStop m_stop;
+
+    std::chrono::steady_clock::time_point m_deadline;
+
+    unsigned long long m_propagateNanos;
+
+    bool m_consistent; // 第0层状态是否没有矛盾
+};
+
+#endif // SUDOKUSOLVER_H
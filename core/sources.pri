@@ -0,0 +1,35 @@
+# Sources of the core library, shared by the static library (core.pro)
+# and the C-interface shared library (capi/capi.pro)
+
+INCLUDEPATH += $$PWD/include
+
+SOURCES += \
+    $$PWD/src/sudokusolver.cpp \
+    $$PWD/src/sudoku_c.cpp \
+    $$PWD/src/cluesearch.cpp \
+    $$PWD/src/rater.cpp \
+    $$PWD/src/generator.cpp \
+    $$PWD/src/canonical.cpp \
+    $$PWD/src/packedcorpus.cpp \
+    $$PWD/src/compactcodec.cpp \
+    $$PWD/src/puzzleparser.cpp \
+    $$PWD/src/solvering.cpp \
+    $$PWD/src/solvemetrics.cpp \
+    $$PWD/src/feasibility.cpp \
+    $$PWD/src/repair.cpp
+
+HEADERS += \
+    $$PWD/include/sudoku_c.h \
+    $$PWD/include/sudokusolver.h \
+    $$PWD/include/bitboard.h \
+    $$PWD/include/cluesearch.h \
+    $$PWD/include/rater.h \
+    $$PWD/include/generator.h \
+    $$PWD/include/canonical.h \
+    $$PWD/include/packedcorpus.h \
+    $$PWD/include/compactcodec.h \
+    $$PWD/include/puzzleparser.h \
+    $$PWD/include/solvering.h \
+    $$PWD/include/solvemetrics.h \
+    $$PWD/include/feasibility.h \
+    $$PWD/include/repair.h
@@ -0,0 +1,162 @@
+﻿#include "canonical.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief 全部1296种列置换：栈的6种顺序乘以每个栈内的6种顺序
+ */
+struct ColumnPermutations
+{
+    uint8_t perms[1296][9]; // 第j列取自原来的第perms[j]列
+
+    ColumnPermutations()
+    {
+        static const uint8_t orders[6][3] = {
+            { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 }
+        };
+        int n = 0;
+        for (int s = 0; s < 6; s++)
+        {
+            for (int a = 0; a < 6; a++)
+            {
+                for (int b = 0; b < 6; b++)
+                {
+                    for (int c = 0; c < 6; c++)
+                    {
+                        const int inner[3] = { a, b, c };
+                        for (int k = 0; k < 3; k++)
+                        {
+                            int stack = orders[s][k];
+                            for (int j = 0; j < 3; j++)
+                            {
+                                perms[n][k * 3 + j] = uint8_t(stack * 3 + orders[inner[k]][j]);
+                            }
+                        }
+                        ++n;
+                    }
+                }
+            }
+        }
+    }
+};
+
+const ColumnPermutations P;
+
+}
+
+Canonicalizer::Canonicalizer()
+{
+}
+
+int Canonicalizer::writeRow(const Candidate &from, int row, uint8_t *out, Candidate &to, const uint8_t *best) const
+{
+    const uint8_t *cells = m_grids[from.grid] + row * 9;
+    const uint8_t *perm = P.perms[from.columns];
+    to = from;
+
+    int cmp = best ? 0 : -1;
+    for (int j = 0; j < 9; j++)
+    {
+        int v = cells[perm[j]];
+        if (v)
+        {
+            if (!to.label[v])
+            {
+                to.label[v] = to.next++;
+            }
+            v = to.label[v];
+        }
+        out[j] = uint8_t(v);
+
+        // 已经比当前最好的行大，这个变换可以淘汰
+        if (cmp == 0)
+        {
+            if (v < best[j])
+            {
+                cmp = -1;
+            }
+            else if (v > best[j])
+            {
+                return 1;
+            }
+        }
+    }
+    to.usedRows = uint16_t(from.usedRows | (1 << row));
+    to.band = uint8_t(row / 3);
+    return cmp;
+}
+
+void Canonicalizer::canonicalize(const uint8_t *puzzle, uint8_t *canonical)
+{
+    int clues = 0;
+    for (int i = 0; i < 81; i++)
+    {
+        m_grids[0][i] = puzzle[i];
+        m_grids[1][i] = puzzle[i % 9 * 9 + i / 9];
+        clues += puzzle[i] != 0;
+    }
+    std::memset(canonical, 0, 81);
+
+    m_current.clear();
+    for (int g = 0; g < 2; g++)
+    {
+        for (int p = 0; p < 1296; p++)
+        {
+            Candidate candidate;
+            std::memset(&candidate, 0, sizeof(candidate));
+            candidate.grid = uint8_t(g);
+            candidate.columns = uint16_t(p);
+            candidate.next = 1;
+            m_current.push_back(candidate);
+        }
+    }
+
+    int written = 0;
+    for (int k = 0; k < 9 && written < clues; k++)
+    {
+        uint8_t best[9];
+        bool hasBest = false;
+        m_next.clear();
+
+        for (const Candidate &candidate : m_current)
+        {
+            // 每个带的第一行可以是任意未用过的带中的任意一行，之后只能选同一个带中剩下的行
+            for (int row = 0; row < 9; row++)
+            {
+                if (candidate.usedRows & (1 << row))
+                {
+                    continue;
+                }
+                if (k % 3 == 0 ? (candidate.usedRows >> (row / 3 * 3)) & 7 : row / 3 != candidate.band)
+                {
+                    continue;
+                }
+
+                uint8_t out[9];
+                Candidate next;
+                int cmp = writeRow(candidate, row, out, next, hasBest ? best : nullptr);
+                if (cmp < 0)
+                {
+                    std::memcpy(best, out, 9);
+                    hasBest = true;
+                    m_next.clear();
+                }
+                if (cmp <= 0)
+                {
+                    m_next.push_back(next);
+                }
+            }
+        }
+
+        std::memcpy(canonical + k * 9, best, 9);
+        for (int j = 0; j < 9; j++)
+        {
+            written += best[j] != 0;
+        }
+        std::swap(m_current, m_next);
+    }
+    // 所有线索都已写出时，剩下的行全是空格，不需要继续区分
+}
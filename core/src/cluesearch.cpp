@@ -0,0 +1,625 @@
+﻿#include "cluesearch.h"
+
+#include "sudokusolver.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static inline int boxOf(int i)
+{
+    return i / 27 * 3 + i % 9 / 3;
+}
+
+// 把文件截断到size字节，用于丢弃上次中断时未提交的输出
+static bool truncateFile(const std::string &path, long long size)
+{
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool ok = _chsize_s(fd, size) == 0;
+    _close(fd);
+    return ok;
+#else
+    return truncate(path.c_str(), off_t(size)) == 0;
+#endif
+}
+
+ClueSearch::ClueSearch(const std::vector<int> &grid)
+    : m_valid(grid.size() == 81), m_maxClues(0), m_next(0), m_stopped(false),
+      m_output(nullptr), m_checkpoint(nullptr), m_offset(0), m_found(0)
+{
+    unsigned units[27] = { 0 };
+    for (int i = 0; i < 81 && m_valid; i++)
+    {
+        m_grid[i] = grid[i];
+        if (grid[i] < 1 || grid[i] > 9)
+        {
+            m_valid = false;
+            break;
+        }
+        unsigned bit = 1u << (grid[i] - 1);
+        units[i / 9] |= bit;
+        units[9 + i % 9] |= bit;
+        units[18 + boxOf(i)] |= bit;
+    }
+    for (int u = 0; u < 27 && m_valid; u++)
+    {
+        m_valid = units[u] == 0x1ff;
+    }
+
+    if (m_valid)
+    {
+        findUnavoidableSets();
+    }
+}
+
+bool ClueSearch::isValid() const
+{
+    return m_valid;
+}
+
+const std::vector<Bitboard> &ClueSearch::unavoidableSets() const
+{
+    return m_sets;
+}
+
+void ClueSearch::stop()
+{
+    m_stopped = true;
+}
+
+std::string ClueSearch::errorString() const
+{
+    return m_error;
+}
+
+int ClueSearch::enumerate(const Bitboard &blank, int limit, std::vector<Bitboard> &diffs) const
+{
+    int values[81];
+    int blanks[81];
+    int nBlank = 0;
+    unsigned units[27] = { 0 };
+
+    for (int i = 0; i < 81; i++)
+    {
+        if (blank.test(i))
+        {
+            values[i] = 0;
+            blanks[nBlank++] = i;
+        }
+        else
+        {
+            values[i] = m_grid[i];
+            unsigned bit = 1u << (m_grid[i] - 1);
+            units[i / 9] |= bit;
+            units[9 + i % 9] |= bit;
+            units[18 + boxOf(i)] |= bit;
+        }
+    }
+    return enumerate(values, units, blanks, nBlank, limit, 0, diffs);
+}
+
+int ClueSearch::enumerate(int *values, unsigned *units, int *blanks, int nBlank,
+                          int limit, int found, std::vector<Bitboard> &diffs) const
+{
+    if (nBlank == 0)
+    {
+        Bitboard diff;
+        for (int i = 0; i < 81; i++)
+        {
+            if (values[i] != m_grid[i])
+            {
+                diff.set(i);
+            }
+        }
+        if (!diff.empty())
+        {
+            diffs.push_back(diff);
+        }
+        return found + 1;
+    }
+
+    // 选择候选数最少的格子
+    int best = 0;
+    int bestCount = 10;
+    unsigned bestMask = 0;
+    for (int k = 0; k < nBlank; k++)
+    {
+        int i = blanks[k];
+        unsigned mask = ~(units[i / 9] | units[9 + i % 9] | units[18 + boxOf(i)]) & 0x1ff;
+        int count = popCount64(mask);
+        if (count < bestCount)
+        {
+            best = k;
+            bestCount = count;
+            bestMask = mask;
+            if (count <= 1)
+            {
+                break;
+            }
+        }
+    }
+    if (bestCount == 0)
+    {
+        return found;
+    }
+
+    int cell = blanks[best];
+    std::swap(blanks[best], blanks[nBlank - 1]);
+    unsigned *row = units + cell / 9;
+    unsigned *col = units + 9 + cell % 9;
+    unsigned *box = units + 18 + boxOf(cell);
+    while (bestMask && found < limit)
+    {
+        unsigned bit = bestMask & (0u - bestMask);
+        bestMask ^= bit;
+        values[cell] = lowestBit64(bit) + 1;
+        *row |= bit;
+        *col |= bit;
+        *box |= bit;
+        found = enumerate(values, units, blanks, nBlank - 1, limit, found, diffs);
+        *row ^= bit;
+        *col ^= bit;
+        *box ^= bit;
+    }
+    values[cell] = 0;
+    std::swap(blanks[best], blanks[nBlank - 1]);
+    return found;
+}
+
+void ClueSearch::findUnavoidableSets()
+{
+    std::vector<Bitboard> found;
+    for (unsigned digits = 0; digits < 0x200; digits++)
+    {
+        int count = popCount64(digits);
+        if (count < 2 || count > 4)
+        {
+            continue;
+        }
+
+        Bitboard blank;
+        for (int i = 0; i < 81; i++)
+        {
+            if (digits & (1u << (m_grid[i] - 1)))
+            {
+                blank.set(i);
+            }
+        }
+        // 4个数字时填法可能很多，只取前若干个
+        enumerate(blank, 256, found);
+    }
+
+    // 按大小排序，去掉包含其他集合的集合
+    std::sort(found.begin(), found.end(), [](const Bitboard &a, const Bitboard &b) {
+        return a.count() < b.count();
+    });
+    m_sets.clear();
+    for (const Bitboard &set : found)
+    {
+        bool minimal = true;
+        for (const Bitboard &kept : m_sets)
+        {
+            if (kept.subsetOf(set))
+            {
+                minimal = false;
+                break;
+            }
+        }
+        if (minimal)
+        {
+            m_sets.push_back(set);
+        }
+    }
+}
+
+int ClueSearch::pick(const std::vector<Bitboard> &sets, const Task &node, Bitboard &avail) const
+{
+    Bitboard open = ~node.dead;
+    Bitboard used;
+    int bound = 0; // 互不相交的未命中集合个数，每个至少还需要一个线索
+    int bestCount = 82;
+
+    for (const Bitboard &set : sets)
+    {
+        if (set.intersects(node.clues))
+        {
+            continue;
+        }
+        Bitboard cells = set & open;
+        int count = cells.count();
+        if (count == 0)
+        {
+            return 0;
+        }
+        if (count < bestCount)
+        {
+            bestCount = count;
+            avail = cells;
+        }
+        if (!cells.intersects(used))
+        {
+            ++bound;
+            used |= cells;
+        }
+    }
+
+    if (bestCount == 82)
+    {
+        return 2;
+    }
+    return node.count + bound > m_maxClues ? 0 : 1;
+}
+
+void ClueSearch::split()
+{
+    // 每次展开队首的节点，子节点按分支顺序排到队尾，任务的编号只由终盘和线索数上限决定
+    std::deque<Task> queue;
+    queue.push_back(Task { Bitboard(), Bitboard(), 0 });
+    m_tasks.clear();
+    while (!queue.empty() && queue.size() + m_tasks.size() < MIN_TASKS)
+    {
+        Task node = queue.front();
+        queue.pop_front();
+        Bitboard avail;
+        int res = pick(m_sets, node, avail);
+        if (res == 0)
+        {
+            continue;
+        }
+        if (res == 2)
+        {
+            m_tasks.push_back(node);
+            continue;
+        }
+
+        Bitboard dead = node.dead;
+        while (!avail.empty())
+        {
+            int cell = avail.pop();
+            queue.push_back(Task { node.clues | Bitboard::cell(cell), dead, node.count + 1 });
+            dead.set(cell);
+        }
+    }
+    m_tasks.insert(m_tasks.end(), queue.begin(), queue.end());
+}
+
+void ClueSearch::search(Worker &worker, const Task &node, int depth)
+{
+    if (m_stopped)
+    {
+        return;
+    }
+
+    const std::vector<Bitboard> &sets = worker.levels[depth];
+    Bitboard avail;
+    int res = pick(sets, node, avail);
+    if (res == 0)
+    {
+        return;
+    }
+
+    if (res == 2)
+    {
+        uint8_t puzzle[81] = { 0 };
+        for (Bitboard cells = node.clues; !cells.empty();)
+        {
+            int i = cells.pop();
+            puzzle[i] = uint8_t(m_grid[i]);
+        }
+        uint8_t solutions[2 * 81];
+        if (worker.solver.solveAll(puzzle, solutions, 2) == 1)
+        {
+            accept(worker, puzzle, node.clues);
+            return;
+        }
+
+        // 解不唯一，和终盘不同的那个解与终盘不同的格子构成新的不可避免集，且与已选线索不相交，
+        // 因此这条路径上每一层都没有命中它
+        const uint8_t *other = std::equal(solutions, solutions + 81, m_grid) ? solutions + 81 : solutions;
+        Bitboard diff;
+        for (int i = 0; i < 81; i++)
+        {
+            if (other[i] != m_grid[i])
+            {
+                diff.set(i);
+            }
+        }
+        worker.sets.push_back(diff);
+        for (int level = 0; level <= depth; level++)
+        {
+            worker.levels[level].push_back(diff);
+        }
+        search(worker, node, depth);
+        return;
+    }
+
+    Bitboard dead = node.dead;
+    while (!avail.empty() && !m_stopped)
+    {
+        int cell = avail.pop();
+        std::vector<Bitboard> &next = worker.levels[depth + 1];
+        next.clear();
+        for (const Bitboard &set : worker.levels[depth])
+        {
+            if (!set.test(cell))
+            {
+                next.push_back(set);
+            }
+        }
+        Task child = { node.clues | Bitboard::cell(cell), dead, node.count + 1 };
+        search(worker, child, depth + 1);
+        dead.set(cell);
+    }
+}
+
+void ClueSearch::accept(Worker &worker, const uint8_t *puzzle, const Bitboard &clues)
+{
+    // 去掉某个线索后仍然唯一时，这个谜题是另一个更小谜题的超集，由那个谜题代表
+    uint8_t reduced[81];
+    std::memcpy(reduced, puzzle, 81);
+    for (Bitboard cells = clues; !cells.empty();)
+    {
+        int i = cells.pop();
+        reduced[i] = 0;
+        bool unique = worker.solver.solve(reduced, nullptr, 2) == 1;
+        reduced[i] = puzzle[i];
+        if (unique)
+        {
+            return;
+        }
+    }
+
+    char line[83];
+    for (int i = 0; i < 81; i++)
+    {
+        line[i] = puzzle[i] ? char('0' + puzzle[i]) : '.';
+    }
+    line[81] = '\n';
+    line[82] = '\0';
+    worker.buffer += line;
+    ++worker.found;
+}
+
+void ClueSearch::work()
+{
+    Worker worker;
+    worker.sets = m_sets;
+    worker.levels.resize(82);
+
+    for (;;)
+    {
+        int task = m_next++;
+        if (task >= int(m_tasks.size()) || m_stopped)
+        {
+            break;
+        }
+        if (m_done[task])
+        {
+            continue;
+        }
+
+        worker.buffer.clear();
+        worker.found = 0;
+        const Task &root = m_tasks[task];
+        worker.levels[0].clear();
+        for (const Bitboard &set : worker.sets)
+        {
+            if (!set.intersects(root.clues))
+            {
+                worker.levels[0].push_back(set);
+            }
+        }
+        search(worker, root, 0);
+        if (m_stopped)
+        {
+            break;
+        }
+        commit(task, worker);
+    }
+}
+
+void ClueSearch::commit(int task, Worker &worker)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 先写结果再写检查点，中断时检查点之后多出的输出会在恢复时被截掉
+    if (!worker.buffer.empty())
+    {
+        std::fwrite(worker.buffer.data(), 1, worker.buffer.size(), m_output);
+        m_offset += (long long)worker.buffer.size();
+    }
+    std::fflush(m_output);
+
+    if (m_checkpoint)
+    {
+        std::fprintf(m_checkpoint, "done %d %lld\n", task, m_offset);
+        std::fflush(m_checkpoint);
+    }
+    m_found += worker.found;
+}
+
+bool ClueSearch::loadCheckpoint(const std::string &path, long long &offset)
+{
+    std::FILE *file = std::fopen(path.c_str(), "r");
+    if (!file)
+    {
+        m_error = "cannot open checkpoint " + path;
+        return false;
+    }
+
+    char gridText[82];
+    for (int i = 0; i < 81; i++)
+    {
+        gridText[i] = char('0' + m_grid[i]);
+    }
+    gridText[81] = '\0';
+
+    char header[128];
+    char expected[128];
+    std::snprintf(expected, sizeof(expected), "cluesearch %s %d %d\n",
+                  gridText, m_maxClues, int(m_tasks.size()));
+    if (!std::fgets(header, sizeof(header), file) || std::strcmp(header, expected) != 0)
+    {
+        std::fclose(file);
+        m_error = "checkpoint does not match this grid and clue limit";
+        return false;
+    }
+
+    // 只接受完整的行，最后一行可能在写入时被中断
+    std::vector<std::pair<int, long long>> records;
+    char line[64];
+    offset = 0;
+    while (std::fgets(line, sizeof(line), file))
+    {
+        int task;
+        long long end;
+        if (!std::strchr(line, '\n') || std::sscanf(line, "done %d %lld", &task, &end) != 2 ||
+            task < 0 || task >= int(m_tasks.size()))
+        {
+            break;
+        }
+        m_done[task] = 1;
+        offset = std::max(offset, end);
+        records.push_back(std::make_pair(task, end));
+    }
+    std::fclose(file);
+
+    // 重写检查点，去掉可能残缺的最后一行
+    file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        m_error = "cannot write checkpoint " + path;
+        return false;
+    }
+    std::fputs(expected, file);
+    for (const auto &record : records)
+    {
+        std::fprintf(file, "done %d %lld\n", record.first, record.second);
+    }
+    std::fclose(file);
+    return true;
+}
+
+long long ClueSearch::run(int maxClues, int threads, const std::string &output, const std::string &checkpoint)
+{
+    if (!m_valid)
+    {
+        m_error = "invalid solution grid";
+        return -1;
+    }
+    if (!checkpoint.empty() && output == "-")
+    {
+        m_error = "checkpoint requires an output file";
+        return -1;
+    }
+
+    m_maxClues = maxClues;
+    m_stopped = false;
+    m_found = 0;
+    m_offset = 0;
+
+    split();
+    m_done.assign(m_tasks.size(), 0);
+
+    bool resume = false;
+    if (!checkpoint.empty())
+    {
+        std::FILE *file = std::fopen(checkpoint.c_str(), "r");
+        if (file)
+        {
+            std::fclose(file);
+            if (!loadCheckpoint(checkpoint, m_offset))
+            {
+                return -1;
+            }
+            resume = true;
+        }
+    }
+
+    if (output == "-")
+    {
+        m_output = stdout;
+    }
+    else if (resume)
+    {
+        if (!truncateFile(output, m_offset) && m_offset > 0)
+        {
+            m_error = "cannot resume output " + output;
+            return -1;
+        }
+        m_output = std::fopen(output.c_str(), "ab");
+    }
+    else
+    {
+        m_output = std::fopen(output.c_str(), "wb");
+    }
+    if (!m_output)
+    {
+        m_error = "cannot open output " + output;
+        return -1;
+    }
+
+    if (!checkpoint.empty())
+    {
+        m_checkpoint = std::fopen(checkpoint.c_str(), resume ? "a" : "w");
+        if (!m_checkpoint)
+        {
+            m_error = "cannot write checkpoint " + checkpoint;
+            if (m_output != stdout)
+            {
+                std::fclose(m_output);
+            }
+            return -1;
+        }
+        if (!resume)
+        {
+            std::fprintf(m_checkpoint, "cluesearch ");
+            for (int i = 0; i < 81; i++)
+            {
+                std::fputc('0' + m_grid[i], m_checkpoint);
+            }
+            std::fprintf(m_checkpoint, " %d %d\n", m_maxClues, int(m_tasks.size()));
+            std::fflush(m_checkpoint);
+        }
+    }
+
+    if (threads < 1)
+    {
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+    m_next = 0;
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++)
+    {
+        pool.push_back(std::thread(&ClueSearch::work, this));
+    }
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+
+    if (m_output != stdout)
+    {
+        std::fclose(m_output);
+    }
+    m_output = nullptr;
+    if (m_checkpoint)
+    {
+        std::fclose(m_checkpoint);
+        m_checkpoint = nullptr;
+    }
+    return m_found;
+}
@@ -0,0 +1,169 @@
+﻿#include "compactcodec.h"
+
+#include "bitboard.h"
+
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief 解码用的查找表
+ */
+struct CodecTables
+{
+    uint8_t count[512];     // 掩码中的候选数个数
+    uint8_t select[512][9]; // 掩码中第n个候选数（从0开始的数字）
+    uint8_t width[10];      // n个候选数时编码的位数
+    uint8_t box[81];
+
+    CodecTables()
+    {
+        for (int mask = 0; mask < 512; mask++)
+        {
+            int n = 0;
+            for (int d = 0; d < 9; d++)
+            {
+                select[mask][d] = 0;
+            }
+            for (int d = 0; d < 9; d++)
+            {
+                if (mask & (1 << d))
+                {
+                    select[mask][n++] = uint8_t(d);
+                }
+            }
+            count[mask] = uint8_t(n);
+        }
+        for (int n = 0; n < 10; n++)
+        {
+            int w = 0;
+            while ((1 << w) < n)
+            {
+                ++w;
+            }
+            width[n] = uint8_t(w);
+        }
+        for (int i = 0; i < 81; i++)
+        {
+            box[i] = uint8_t(i / 27 * 3 + i % 9 / 3);
+        }
+    }
+};
+
+const CodecTables C;
+
+}
+
+size_t CompactCodec::encode(const uint8_t *puzzle, uint8_t *out)
+{
+    std::memset(out, 0, MAX_SIZE);
+
+    size_t bit = 0;
+    auto write = [&](unsigned value, int width) {
+        for (int k = 0; k < width; k++, bit++)
+        {
+            out[bit >> 3] |= uint8_t(((value >> k) & 1) << (bit & 7));
+        }
+    };
+
+    for (int i = 0; i < 81; i++)
+    {
+        write(puzzle[i] != 0, 1);
+    }
+
+    unsigned rows[9] = { 0 };
+    unsigned cols[9] = { 0 };
+    unsigned boxes[9] = { 0 };
+    for (int i = 0; i < 81; i++)
+    {
+        int digit = puzzle[i];
+        if (digit == 0)
+        {
+            continue;
+        }
+        if (digit > 9)
+        {
+            return 0;
+        }
+        int r = i / 9;
+        int c = i % 9;
+        int b = C.box[i];
+        unsigned allowed = ~(rows[r] | cols[c] | boxes[b]) & 0x1ff;
+        unsigned mask = 1u << (digit - 1);
+        if (!(allowed & mask))
+        {
+            return 0;
+        }
+        // 编码为该数字在候选数中的序号
+        write(C.count[allowed & (mask - 1)], C.width[C.count[allowed]]);
+        rows[r] |= mask;
+        cols[c] |= mask;
+        boxes[b] |= mask;
+    }
+    return (bit + 7) / 8;
+}
+
+size_t CompactCodec::decode(const uint8_t *in, size_t available, uint8_t *puzzle)
+{
+    if (available < 11)
+    {
+        return 0;
+    }
+
+    Bitboard clues;
+    clues.lo = 0;
+    for (int k = 0; k < 8; k++)
+    {
+        clues.lo |= uint64_t(in[k]) << (k * 8);
+    }
+    clues.hi = in[8] | (in[9] << 8) | ((in[10] & 1) << 16);
+
+    // 位图之后的编码从第10字节的第1位开始
+    uint64_t acc = in[10] >> 1;
+    int bits = 7;
+    size_t next = 11;
+
+    std::memset(puzzle, 0, 81);
+    unsigned rows[9] = { 0 };
+    unsigned cols[9] = { 0 };
+    unsigned boxes[9] = { 0 };
+
+    while (!clues.empty())
+    {
+        int i = clues.pop();
+
+        // 每个编码最多4位，不足时一次补满累加器
+        if (bits < 4)
+        {
+            while (bits <= 56 && next < available)
+            {
+                acc |= uint64_t(in[next++]) << bits;
+                bits += 8;
+            }
+        }
+
+        int r = i / 9;
+        int c = i % 9;
+        int b = C.box[i];
+        unsigned allowed = ~(rows[r] | cols[c] | boxes[b]) & 0x1ff;
+        int n = C.count[allowed];
+        int width = C.width[n];
+        unsigned index = unsigned(acc) & ((1u << width) - 1);
+        if (width > bits || index >= unsigned(n))
+        {
+            return 0;
+        }
+        acc >>= width;
+        bits -= width;
+
+        int digit = C.select[allowed][index];
+        unsigned mask = 1u << digit;
+        puzzle[i] = uint8_t(digit + 1);
+        rows[r] |= mask;
+        cols[c] |= mask;
+        boxes[b] |= mask;
+    }
+
+    // 剩余不足一个字节的位是填充
+    return next - size_t(bits / 8);
+}
@@ -0,0 +1,78 @@
+﻿#include "feasibility.h"
+
+#include <cstring>
+
+FeasibilityChecker::FeasibilityChecker()
+    : m_loaded(false)
+    , m_consistent(false)
+    , m_hasWitness(false)
+    , m_nodes(0)
+{
+}
+
+Feasibility FeasibilityChecker::check(const uint8_t *board, const SolveBudget &budget)
+{
+    m_nodes = 0;
+
+    // 已填的数字都和之前的解一致，这个解仍然是当前盘面的解
+    if (m_hasWitness)
+    {
+        int i = 0;
+        while (i < 81 && (board[i] == 0 || board[i] == m_witness[i]))
+        {
+            ++i;
+        }
+        if (i == 81)
+        {
+            return FEASIBLE;
+        }
+    }
+
+    if (!sync(board))
+    {
+        return INFEASIBLE;
+    }
+
+    m_solver.setBudget(budget);
+    int found = m_solver.resume(m_witness, 1);
+    m_nodes = m_solver.nodes();
+    if (found > 0)
+    {
+        m_hasWitness = true;
+        return FEASIBLE;
+    }
+    return m_solver.stopReason() == STOP_NONE ? INFEASIBLE : UNDECIDED;
+}
+
+unsigned long long FeasibilityChecker::nodes() const
+{
+    return m_nodes;
+}
+
+bool FeasibilityChecker::sync(const uint8_t *board)
+{
+    bool grown = m_loaded;
+    for (int i = 0; grown && i < 81; i++)
+    {
+        grown = m_board[i] == 0 || m_board[i] == board[i];
+    }
+
+    if (!grown)
+    {
+        m_consistent = m_solver.prepare(board);
+    }
+    else
+    {
+        // 无解的盘面再填数仍然无解
+        for (int i = 0; m_consistent && i < 81; i++)
+        {
+            if (m_board[i] == 0 && board[i] != 0)
+            {
+                m_consistent = m_solver.assign(i, board[i]);
+            }
+        }
+    }
+    std::memcpy(m_board, board, 81);
+    m_loaded = true;
+    return m_consistent;
+}
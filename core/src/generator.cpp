@@ -0,0 +1,94 @@
+﻿#include "generator.h"
+
+#include "sudokusolver.h"
+
+#include <algorithm>
+
+Generator::Generator(uint32_t seed)
+    : m_rng(seed)
+{
+}
+
+bool Generator::fill(uint8_t *grid, unsigned *units, int cell)
+{
+    if (cell == 81)
+    {
+        return true;
+    }
+
+    int r = cell / 9;
+    int c = cell % 9;
+    int b = r / 3 * 3 + c / 3;
+    unsigned free = ~(units[r] | units[9 + c] | units[18 + b]) & 0x1ff;
+
+    int digits[9];
+    int count = 0;
+    for (int d = 0; d < 9; d++)
+    {
+        if (free & (1u << d))
+        {
+            digits[count++] = d;
+        }
+    }
+    std::shuffle(digits, digits + count, m_rng);
+
+    for (int i = 0; i < count; i++)
+    {
+        unsigned bit = 1u << digits[i];
+        units[r] |= bit;
+        units[9 + c] |= bit;
+        units[18 + b] |= bit;
+        grid[cell] = uint8_t(digits[i] + 1);
+        if (fill(grid, units, cell + 1))
+        {
+            return true;
+        }
+        units[r] ^= bit;
+        units[9 + c] ^= bit;
+        units[18 + b] ^= bit;
+    }
+    grid[cell] = 0;
+    return false;
+}
+
+void Generator::fillGrid(uint8_t *grid)
+{
+    unsigned units[27] = { 0 };
+    fill(grid, units, 0);
+}
+
+int Generator::generate(uint8_t *puzzle, uint8_t *solution, int minClues)
+{
+    fillGrid(solution);
+    std::copy(solution, solution + 81, puzzle);
+
+    int order[81];
+    for (int i = 0; i < 81; i++)
+    {
+        order[i] = i;
+    }
+    std::shuffle(order, order + 81, m_rng);
+
+    int clues = 81;
+    for (int k = 0; k < 81 && clues > minClues; k++)
+    {
+        int cell = order[k];
+        uint8_t kept = puzzle[cell];
+        puzzle[cell] = 0;
+        if (countSolutions(puzzle, 2) == 1)
+        {
+            --clues;
+        }
+        else
+        {
+            puzzle[cell] = kept;
+        }
+    }
+    return clues;
+}
+
+int Generator::countSolutions(const uint8_t *puzzle, int limit)
+{
+    SudokuSolver solver;
+    return solver.solve(puzzle, nullptr, limit);
+}
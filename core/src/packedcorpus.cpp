@@ -0,0 +1,354 @@
+﻿#include "packedcorpus.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const char MAGIC[8] = { 'S', 'D', 'K', 'C', 'O', 'R', 'P', 0 };
+
+void putLE(uint8_t *p, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        p[i] = uint8_t(value >> (i * 8));
+    }
+}
+
+uint64_t getLE(const uint8_t *p, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        value |= uint64_t(p[i]) << (i * 8);
+    }
+    return value;
+}
+
+void encodeHeader(const CorpusHeader &header, uint8_t *p)
+{
+    std::memcpy(p, header.magic, 8);
+    putLE(p + 8, header.version, 4);
+    putLE(p + 12, header.fields, 4);
+    putLE(p + 16, header.recordSize, 4);
+    putLE(p + 20, header.levels, 4);
+    putLE(p + 24, header.count, 8);
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
+    {
+        putLE(p + 32 + i * 8, header.levelStart[i], 8);
+        putLE(p + 64 + i * 8, header.levelCount[i], 8);
+    }
+}
+
+void decodeHeader(const uint8_t *p, CorpusHeader &header)
+{
+    std::memcpy(header.magic, p, 8);
+    header.version = uint32_t(getLE(p + 8, 4));
+    header.fields = uint32_t(getLE(p + 12, 4));
+    header.recordSize = uint32_t(getLE(p + 16, 4));
+    header.levels = uint32_t(getLE(p + 20, 4));
+    header.count = getLE(p + 24, 8);
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
+    {
+        header.levelStart[i] = getLE(p + 32 + i * 8, 8);
+        header.levelCount[i] = getLE(p + 64 + i * 8, 8);
+    }
+}
+
+}
+
+uint32_t PackedCorpus::recordSize(uint32_t fields)
+{
+    uint32_t size = 41;
+    if (fields & CORPUS_SOLUTION)
+    {
+        size += 41;
+    }
+    if (fields & CORPUS_SCORE)
+    {
+        size += 2;
+    }
+    if (fields & CORPUS_CLUES)
+    {
+        size += 1;
+    }
+    return size;
+}
+
+void PackedCorpus::pack(const uint8_t *cells, uint8_t *packed)
+{
+    for (int i = 0; i < 40; i++)
+    {
+        packed[i] = uint8_t(cells[i * 2] | (cells[i * 2 + 1] << 4));
+    }
+    packed[40] = cells[80];
+}
+
+void PackedCorpus::unpack(const uint8_t *packed, uint8_t *cells)
+{
+    for (int i = 0; i < 40; i++)
+    {
+        cells[i * 2] = packed[i] & 0xf;
+        cells[i * 2 + 1] = packed[i] >> 4;
+    }
+    cells[80] = packed[40] & 0xf;
+}
+
+CorpusWriter::CorpusWriter()
+    : m_fields(0)
+{
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
+    {
+        m_temp[i] = nullptr;
+        m_count[i] = 0;
+    }
+}
+
+CorpusWriter::~CorpusWriter()
+{
+    discard();
+}
+
+bool CorpusWriter::open(const std::string &path, uint32_t fields)
+{
+    discard();
+    m_path = path;
+    m_fields = fields;
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
+    {
+        m_count[i] = 0;
+        m_temp[i] = std::fopen(tempPath(i).c_str(), "w+b");
+        if (!m_temp[i])
+        {
+            m_error = "cannot create " + tempPath(i);
+            discard();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CorpusWriter::add(const uint8_t *puzzle, const uint8_t *solution, double score)
+{
+    uint8_t record[41 + 41 + 2 + 1];
+    uint8_t *p = record;
+
+    PackedCorpus::pack(puzzle, p);
+    p += 41;
+    if (m_fields & CORPUS_SOLUTION)
+    {
+        if (solution)
+        {
+            PackedCorpus::pack(solution, p);
+        }
+        else
+        {
+            std::memset(p, 0, 41);
+        }
+        p += 41;
+    }
+    if (m_fields & CORPUS_SCORE)
+    {
+        putLE(p, uint64_t(score * 10 + 0.5), 2);
+        p += 2;
+    }
+    if (m_fields & CORPUS_CLUES)
+    {
+        int clues = 0;
+        for (int i = 0; i < 81; i++)
+        {
+            clues += puzzle[i] != 0;
+        }
+        *p++ = uint8_t(clues);
+    }
+
+    int level = Rater::difficultyOf(score);
+    if (std::fwrite(record, 1, size_t(p - record), m_temp[level]) != size_t(p - record))
+    {
+        m_error = "cannot write " + tempPath(level);
+        return false;
+    }
+    ++m_count[level];
+    return true;
+}
+
+bool CorpusWriter::close()
+{
+    CorpusHeader header;
+    std::memcpy(header.magic, MAGIC, 8);
+    header.version = PackedCorpus::VERSION;
+    header.fields = m_fields;
+    header.recordSize = PackedCorpus::recordSize(m_fields);
+    header.levels = DIFFICULTY_COUNT;
+    header.count = 0;
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
+    {
+        header.levelStart[i] = header.count;
+        header.levelCount[i] = m_count[i];
+        header.count += m_count[i];
+    }
+
+    FILE *output = std::fopen(m_path.c_str(), "wb");
+    if (!output)
+    {
+        m_error = "cannot create " + m_path;
+        discard();
+        return false;
+    }
+
+    uint8_t bytes[PackedCorpus::HEADER_SIZE];
+    encodeHeader(header, bytes);
+    bool ok = std::fwrite(bytes, 1, sizeof(bytes), output) == sizeof(bytes);
+
+    std::vector<char> buffer(1 << 20);
+    for (int i = 0; i < DIFFICULTY_COUNT && ok; i++)
+    {
+        std::rewind(m_temp[i]);
+        size_t got;
+        while (ok && (got = std::fread(buffer.data(), 1, buffer.size(), m_temp[i])) > 0)
+        {
+            ok = std::fwrite(buffer.data(), 1, got, output) == got;
+        }
+    }
+    ok = std::fclose(output) == 0 && ok;
+    if (!ok)
+    {
+        m_error = "cannot write " + m_path;
+    }
+    discard();
+    return ok;
+}
+
+const std::string &CorpusWriter::errorString() const
+{
+    return m_error;
+}
+
+std::string CorpusWriter::tempPath(int level) const
+{
+    return m_path + ".level" + char('0' + level) + ".tmp";
+}
+
+void CorpusWriter::discard()
+{
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
+    {
+        if (m_temp[i])
+        {
+            std::fclose(m_temp[i]);
+            std::remove(tempPath(i).c_str());
+            m_temp[i] = nullptr;
+        }
+    }
+}
+
+CorpusView::CorpusView()
+    : m_data(nullptr)
+{
+    std::memset(&m_header, 0, sizeof(m_header));
+}
+
+bool CorpusView::attach(const uint8_t *data, size_t size)
+{
+    detach();
+    if (!data || size < PackedCorpus::HEADER_SIZE)
+    {
+        return false;
+    }
+
+    CorpusHeader header;
+    decodeHeader(data, header);
+    if (std::memcmp(header.magic, MAGIC, 8) != 0 || header.version != PackedCorpus::VERSION
+        || header.levels != DIFFICULTY_COUNT || header.recordSize != PackedCorpus::recordSize(header.fields))
+    {
+        return false;
+    }
+
+    // 各难度的范围必须首尾相接，且不超出文件
+    uint64_t next = 0;
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
+    {
+        if (header.levelStart[i] != next)
+        {
+            return false;
+        }
+        next += header.levelCount[i];
+    }
+    if (next != header.count || header.count > (size - PackedCorpus::HEADER_SIZE) / header.recordSize)
+    {
+        return false;
+    }
+
+    m_header = header;
+    m_data = data;
+    return true;
+}
+
+void CorpusView::detach()
+{
+    m_data = nullptr;
+    std::memset(&m_header, 0, sizeof(m_header));
+}
+
+bool CorpusView::isValid() const
+{
+    return m_data != nullptr;
+}
+
+uint32_t CorpusView::fields() const
+{
+    return m_header.fields;
+}
+
+uint64_t CorpusView::count() const
+{
+    return m_header.count;
+}
+
+uint64_t CorpusView::count(Difficulty level) const
+{
+    return m_header.levelCount[level];
+}
+
+void CorpusView::record(uint64_t index, CorpusRecord &out) const
+{
+    const uint8_t *p = m_data + PackedCorpus::HEADER_SIZE + index * m_header.recordSize;
+
+    PackedCorpus::unpack(p, out.puzzle);
+    p += 41;
+    if (m_header.fields & CORPUS_SOLUTION)
+    {
+        PackedCorpus::unpack(p, out.solution);
+        p += 41;
+    }
+    else
+    {
+        std::memset(out.solution, 0, 81);
+    }
+    if (m_header.fields & CORPUS_SCORE)
+    {
+        out.score = double(getLE(p, 2)) / 10;
+        p += 2;
+    }
+    else
+    {
+        out.score = 0;
+    }
+    if (m_header.fields & CORPUS_CLUES)
+    {
+        out.clues = *p;
+    }
+    else
+    {
+        out.clues = 0;
+        for (int i = 0; i < 81; i++)
+        {
+            out.clues += out.puzzle[i] != 0;
+        }
+    }
+}
+
+void CorpusView::record(Difficulty level, uint64_t index, CorpusRecord &out) const
+{
+    record(m_header.levelStart[level] + index, out);
+}
@@ -0,0 +1,371 @@
+﻿#include "puzzleparser.h"
+
+#include "compactcodec.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 字符分类，数字的值就是格子的值；其余分类都含NOT_CELL位，便于合并检查
+enum CharClass : uint8_t
+{
+    NOT_CELL = 16,
+    BLANK = NOT_CELL | 0,   // 空白和SS格式的竖线，忽略
+    RULE = NOT_CELL | 1,    // SS格式的分隔行
+    COMMENT = NOT_CELL | 2, // 行首的'#'和'['
+    OTHER = NOT_CELL | 3
+};
+
+struct ParserTables
+{
+    uint8_t cls[256];
+
+    ParserTables()
+    {
+        for (int ch = 0; ch < 256; ch++)
+        {
+            cls[ch] = OTHER;
+        }
+        for (int d = 1; d <= 9; d++)
+        {
+            cls['0' + d] = uint8_t(d);
+        }
+        cls['0'] = 0;
+        cls['.'] = 0;
+        for (char ch : { ' ', '\t', '\r', '|', '!' })
+        {
+            cls[uint8_t(ch)] = BLANK;
+        }
+        for (char ch : { '-', '+', '=' })
+        {
+            cls[uint8_t(ch)] = RULE;
+        }
+        cls['#'] = COMMENT;
+        cls['['] = COMMENT;
+    }
+};
+
+const ParserTables T;
+
+}
+
+PuzzleParser::PuzzleParser()
+    : m_rows(0)
+    , m_skipped(0)
+{
+}
+
+void PuzzleParser::reset()
+{
+    m_rows = 0;
+    m_skipped = 0;
+}
+
+bool PuzzleParser::feedLine(const char *line, size_t length, uint8_t *puzzle)
+{
+    // 最常见的81字符一行的格式：查表转换，最后统一检查，没有逐字符的分支
+    if (m_rows == 0 && length >= 81 && (length == 81 || T.cls[uint8_t(line[81])] == BLANK))
+    {
+        unsigned bad = 0;
+        for (int i = 0; i < 81; i++)
+        {
+            uint8_t value = T.cls[uint8_t(line[i])];
+            bad |= value;
+            puzzle[i] = value;
+        }
+        if (!(bad & NOT_CELL))
+        {
+            return true;
+        }
+    }
+
+    uint8_t cells[81];
+    int n = 0;
+    bool rule = false;
+    for (size_t i = 0; i < length; i++)
+    {
+        uint8_t value = T.cls[uint8_t(line[i])];
+        if (value <= 9)
+        {
+            if (n == 81 || rule)
+            {
+                n = -1;
+                break;
+            }
+            cells[n++] = value;
+        }
+        else if (value == RULE)
+        {
+            rule = true;
+        }
+        else if (value == COMMENT && n == 0 && !rule)
+        {
+            return false;
+        }
+        else if (value != BLANK)
+        {
+            // 81格之后可以有其他字段，如答案和分数
+            if (n == 81 && m_rows == 0 && T.cls[uint8_t(line[i - 1])] == BLANK)
+            {
+                break;
+            }
+            n = -1;
+            break;
+        }
+    }
+
+    if (n == 0)
+    {
+        // 空行或分隔行
+        return false;
+    }
+    if (n == 81 && m_rows == 0)
+    {
+        std::memcpy(puzzle, cells, 81);
+        return true;
+    }
+    if (n == 9)
+    {
+        std::memcpy(m_grid + m_rows * 9, cells, 9);
+        if (++m_rows == 9)
+        {
+            m_rows = 0;
+            std::memcpy(puzzle, m_grid, 81);
+            return true;
+        }
+        return false;
+    }
+
+    // 无法识别的行，同时丢弃未完成的9x9谜题
+    ++m_skipped;
+    m_rows = 0;
+    return false;
+}
+
+size_t PuzzleParser::parse(const char *data, size_t size, bool final, uint8_t *out, size_t capacity, size_t &consumed)
+{
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos < size && count < capacity)
+    {
+        const char *line = data + pos;
+        const char *newline = static_cast<const char *>(std::memchr(line, '\n', size - pos));
+        size_t length;
+        if (newline)
+        {
+            length = size_t(newline - line);
+            pos += length + 1;
+        }
+        else if (final)
+        {
+            length = size - pos;
+            pos = size;
+        }
+        else
+        {
+            break;
+        }
+        if (feedLine(line, length, out + count * 81))
+        {
+            ++count;
+        }
+    }
+    consumed = pos;
+    return count;
+}
+
+size_t PuzzleParser::skipped() const
+{
+    return m_skipped + (m_rows > 0);
+}
+
+PuzzleReader::PuzzleReader()
+    : m_file(nullptr)
+    , m_mapped(false)
+    , m_data(nullptr)
+    , m_size(0)
+    , m_pos(0)
+    , m_eof(true)
+    , m_compact(false)
+    , m_invalid(0)
+{
+}
+
+PuzzleReader::~PuzzleReader()
+{
+    close();
+}
+
+bool PuzzleReader::open(const std::string &path)
+{
+    close();
+    m_parser.reset();
+    m_invalid = 0;
+    m_eof = false;
+
+#ifndef _WIN32
+    // 普通文件直接映射，解析时没有拷贝
+    if (path != "-")
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd >= 0 && ::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0
+            && uint64_t(info.st_size) <= SIZE_MAX)
+        {
+            void *data = ::mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                ::madvise(data, size_t(info.st_size), MADV_SEQUENTIAL);
+                m_mapped = true;
+                m_data = static_cast<const char *>(data);
+                m_size = size_t(info.st_size);
+                m_eof = true;
+            }
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+#endif
+
+    if (!m_mapped)
+    {
+        m_file = path == "-" ? stdin : std::fopen(path.c_str(), "rb");
+        if (!m_file)
+        {
+            m_error = "cannot open " + path;
+            m_eof = true;
+            return false;
+        }
+        m_buffer.resize(1 << 20);
+        m_data = m_buffer.data();
+        while (m_size < 9 && refill())
+        {
+        }
+    }
+
+    if (m_size >= 8 && std::memcmp(m_data, COMPACT_MAGIC, 8) == 0)
+    {
+        if (m_size < 9 || uint8_t(m_data[8]) != COMPACT_VERSION)
+        {
+            m_error = "unsupported compact file " + path;
+            close();
+            return false;
+        }
+        m_compact = true;
+        m_pos = 9;
+    }
+    return true;
+}
+
+void PuzzleReader::close()
+{
+#ifndef _WIN32
+    if (m_mapped)
+    {
+        ::munmap(const_cast<char *>(m_data), m_size);
+    }
+#endif
+    if (m_file && m_file != stdin)
+    {
+        std::fclose(m_file);
+    }
+    m_file = nullptr;
+    m_mapped = false;
+    m_data = nullptr;
+    m_size = 0;
+    m_pos = 0;
+    m_eof = true;
+    m_compact = false;
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+}
+
+size_t PuzzleReader::read(uint8_t *out, size_t capacity)
+{
+    size_t count = 0;
+    while (count < capacity && m_data)
+    {
+        size_t available = m_size - m_pos;
+        if (m_compact)
+        {
+            size_t used = CompactCodec::decode(reinterpret_cast<const uint8_t *>(m_data) + m_pos, available,
+                                               out + count * 81);
+            if (used > 0)
+            {
+                m_pos += used;
+                ++count;
+                continue;
+            }
+        }
+        else
+        {
+            size_t consumed = 0;
+            count += m_parser.parse(m_data + m_pos, available, m_eof, out + count * 81, capacity - count, consumed);
+            m_pos += consumed;
+            if (count == capacity)
+            {
+                break;
+            }
+        }
+
+        if (!refill())
+        {
+            if (m_compact && m_pos < m_size)
+            {
+                ++m_invalid;
+                m_pos = m_size;
+            }
+            break;
+        }
+    }
+    return count;
+}
+
+bool PuzzleReader::isCompact() const
+{
+    return m_compact;
+}
+
+size_t PuzzleReader::skipped() const
+{
+    return m_parser.skipped() + m_invalid;
+}
+
+const std::string &PuzzleReader::errorString() const
+{
+    return m_error;
+}
+
+bool PuzzleReader::refill()
+{
+    if (m_mapped || m_eof || !m_file)
+    {
+        return false;
+    }
+
+    // 未处理的半行移到开头；一行比缓冲区还长时扩大缓冲区
+    size_t rest = m_size - m_pos;
+    std::memmove(m_buffer.data(), m_buffer.data() + m_pos, rest);
+    m_pos = 0;
+    m_size = rest;
+    if (m_size == m_buffer.size())
+    {
+        m_buffer.resize(m_buffer.size() * 2);
+    }
+    m_data = m_buffer.data();
+
+    size_t want = m_buffer.size() - m_size;
+    size_t got = std::fread(m_buffer.data() + m_size, 1, want, m_file);
+    m_size += got;
+    m_eof = got < want;
+    return true;
+}
@@ -0,0 +1,1023 @@
+﻿#include "rater.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+// 单元编号：0~8为行，9~17为列，18~26为宫
+struct Tables
+{
+    int unitCells[27][9];
+    int cellUnits[81][3];
+    int peers[81][20];
+    Bitboard unitMask[27];
+    Bitboard peerMask[81];
+    std::vector<int> combos[5]; // 9位中恰好有n位为1的所有掩码
+
+    Tables()
+    {
+        for (int i = 0; i < 9; i++)
+        {
+            for (int k = 0; k < 9; k++)
+            {
+                unitCells[i][k] = i * 9 + k;
+                unitCells[9 + i][k] = k * 9 + i;
+                unitCells[18 + i][k] = (i / 3 * 3 + k / 3) * 9 + i % 3 * 3 + k % 3;
+            }
+        }
+        for (int u = 0; u < 27; u++)
+        {
+            for (int k = 0; k < 9; k++)
+            {
+                unitMask[u].set(unitCells[u][k]);
+                cellUnits[unitCells[u][k]][u / 9] = u;
+            }
+        }
+        for (int i = 0; i < 81; i++)
+        {
+            peerMask[i] = unitMask[cellUnits[i][0]] | unitMask[cellUnits[i][1]] | unitMask[cellUnits[i][2]];
+            peerMask[i].reset(i);
+            Bitboard cells = peerMask[i];
+            for (int k = 0; k < 20; k++)
+            {
+                peers[i][k] = cells.pop();
+            }
+        }
+        for (int m = 0; m < 0x200; m++)
+        {
+            int n = popCount64(m);
+            if (n <= 4)
+            {
+                combos[n].push_back(m);
+            }
+        }
+    }
+};
+
+const Tables T;
+
+inline int bitCount(unsigned v)
+{
+    return popCount64(v);
+}
+
+inline int lowestDigit(unsigned v)
+{
+    return lowestBit64(v) + 1;
+}
+
+// 宫内的格子在同一行(列)时返回该行(列)的单元编号，否则返回-1
+inline int commonLine(const Bitboard &cells, int first, bool row)
+{
+    int u = row ? T.cellUnits[first][0] : T.cellUnits[first][1];
+    return cells.subsetOf(T.unitMask[u]) ? u : -1;
+}
+
+} // namespace
+
+Rater::Rater()
+{
+    uint8_t empty[81] = { 0 };
+    load(empty);
+}
+
+bool Rater::load(const uint8_t *puzzle)
+{
+    m_broken = false;
+    m_remaining = 81;
+    m_conflicts = 0;
+    for (int i = 0; i < 81; i++)
+    {
+        m_value[i] = 0;
+        m_cand[i] = 0x1ff;
+    }
+    for (int d = 0; d < 9; d++)
+    {
+        m_pos[d] = Bitboard::all();
+    }
+    for (int u = 0; u < 27; u++)
+    {
+        m_placed[u] = 0;
+        std::fill(m_count[u], m_count[u] + 9, uint8_t(0));
+    }
+
+    for (int i = 0; i < 81; i++)
+    {
+        if (puzzle[i] > 9)
+        {
+            m_broken = true;
+        }
+        else if (puzzle[i] > 0)
+        {
+            place(i, puzzle[i]);
+        }
+    }
+    return !m_broken;
+}
+
+void Rater::load(const uint8_t *values, const uint16_t *candidates)
+{
+    m_remaining = 81;
+    m_conflicts = 0;
+    for (int d = 0; d < 9; d++)
+    {
+        m_pos[d] = Bitboard();
+    }
+    for (int u = 0; u < 27; u++)
+    {
+        m_placed[u] = 0;
+        std::fill(m_count[u], m_count[u] + 9, uint8_t(0));
+    }
+
+    for (int i = 0; i < 81; i++)
+    {
+        int digit = values[i] <= 9 ? values[i] : 0;
+        m_value[i] = digit;
+        m_cand[i] = digit ? 0 : uint16_t(candidates[i] & 0x1ff);
+        for (unsigned m = m_cand[i]; m; m &= m - 1)
+        {
+            m_pos[lowestBit64(m)].set(i);
+        }
+        if (digit == 0)
+        {
+            continue;
+        }
+        --m_remaining;
+        for (int u : T.cellUnits[i])
+        {
+            if (m_count[u][digit - 1]++ > 0)
+            {
+                ++m_conflicts;
+            }
+            m_placed[u] |= 1u << (digit - 1);
+        }
+    }
+    m_broken = m_conflicts > 0;
+}
+
+bool Rater::isBroken() const
+{
+    return m_broken;
+}
+
+bool Rater::hasConflicts() const
+{
+    return m_conflicts > 0;
+}
+
+bool Rater::isFilled() const
+{
+    return m_remaining == 0;
+}
+
+int Rater::value(int cell) const
+{
+    return m_value[cell];
+}
+
+int Rater::candidates(int cell) const
+{
+    return m_cand[cell];
+}
+
+void Rater::place(int cell, int digit)
+{
+    unsigned bit = 1u << (digit - 1);
+    for (unsigned m = m_cand[cell]; m; m &= m - 1)
+    {
+        m_pos[lowestBit64(m)].reset(cell);
+    }
+    m_cand[cell] = 0;
+    m_value[cell] = digit;
+    --m_remaining;
+
+    for (int u : T.cellUnits[cell])
+    {
+        if (m_count[u][digit - 1]++ > 0)
+        {
+            ++m_conflicts;
+            m_broken = true;
+        }
+        m_placed[u] |= bit;
+    }
+
+    Bitboard peers = T.peerMask[cell] & m_pos[digit - 1];
+    while (!peers.empty())
+    {
+        eliminate(peers.pop(), digit);
+    }
+}
+
+bool Rater::eliminate(int cell, int digit)
+{
+    uint16_t bit = uint16_t(1u << (digit - 1));
+    if (!(m_cand[cell] & bit))
+    {
+        return false;
+    }
+    m_cand[cell] &= ~bit;
+    m_pos[digit - 1].reset(cell);
+    // 未填的格子没有候选数
+    if (m_cand[cell] == 0)
+    {
+        m_broken = true;
+    }
+    return true;
+}
+
+void Rater::refresh(int cell)
+{
+    const int *units = T.cellUnits[cell];
+    unsigned cand = m_value[cell] ? 0 : ~(m_placed[units[0]] | m_placed[units[1]] | m_placed[units[2]]) & 0x1ffu;
+    for (unsigned diff = cand ^ m_cand[cell]; diff; diff &= diff - 1)
+    {
+        int d = lowestBit64(diff);
+        if (cand & (1u << d))
+        {
+            m_pos[d].set(cell);
+        }
+        else
+        {
+            m_pos[d].reset(cell);
+        }
+    }
+    m_cand[cell] = uint16_t(cand);
+}
+
+void Rater::setValue(int cell, int digit)
+{
+    int previous = m_value[cell];
+    if (previous == digit)
+    {
+        return;
+    }
+
+    if (previous > 0)
+    {
+        for (int u : T.cellUnits[cell])
+        {
+            if (--m_count[u][previous - 1] > 0)
+            {
+                --m_conflicts;
+            }
+            else
+            {
+                m_placed[u] &= ~(1u << (previous - 1));
+            }
+        }
+        m_value[cell] = 0;
+        ++m_remaining;
+    }
+
+    if (digit > 0)
+    {
+        for (int u : T.cellUnits[cell])
+        {
+            if (m_count[u][digit - 1]++ > 0)
+            {
+                ++m_conflicts;
+            }
+            m_placed[u] |= 1u << (digit - 1);
+        }
+        m_value[cell] = digit;
+        --m_remaining;
+    }
+
+    // 只有这21个格子的候选数会受影响
+    refresh(cell);
+    for (int peer : T.peers[cell])
+    {
+        refresh(peer);
+    }
+
+    m_broken = m_conflicts > 0;
+}
+
+void Rater::apply(const Deduction &deduction)
+{
+    if (deduction.cell >= 0)
+    {
+        place(deduction.cell, deduction.digit);
+    }
+    for (int code : deduction.eliminations)
+    {
+        eliminate(code / 9, code % 9 + 1);
+    }
+}
+
+void Rater::addEliminations(Deduction &deduction, Bitboard targets, int digit) const
+{
+    targets &= m_pos[digit - 1];
+    while (!targets.empty())
+    {
+        deduction.eliminations.push_back(targets.pop() * 9 + digit - 1);
+    }
+}
+
+DeductionResult Rater::findDeduction(Deduction &deduction) const
+{
+    deduction.cell = -1;
+    deduction.digit = 0;
+    deduction.pattern.clear();
+    deduction.eliminations.clear();
+
+    if (m_broken || hasContradiction())
+    {
+        return DEDUCTION_CONTRADICTION;
+    }
+    if (m_remaining == 0)
+    {
+        return DEDUCTION_SOLVED;
+    }
+
+    bool found = findHiddenSingle(deduction)
+        || findNakedSingle(deduction)
+        || findPointing(deduction)
+        || findClaiming(deduction)
+        || findNakedSubset(deduction, 2)
+        || findFish(deduction, 2)
+        || findHiddenSubset(deduction, 2)
+        || findNakedSubset(deduction, 3)
+        || findFish(deduction, 3)
+        || findHiddenSubset(deduction, 3)
+        || findXYWing(deduction)
+        || findXYZWing(deduction)
+        || findNakedSubset(deduction, 4)
+        || findFish(deduction, 4)
+        || findHiddenSubset(deduction, 4)
+        || findXChain(deduction)
+        || findXYChain(deduction);
+    return found ? DEDUCTION_FOUND : DEDUCTION_STUCK;
+}
+
+bool Rater::hasContradiction() const
+{
+    for (int i = 0; i < 81; i++)
+    {
+        if (m_value[i] == 0 && m_cand[i] == 0)
+        {
+            return true;
+        }
+    }
+    for (int u = 0; u < 27; u++)
+    {
+        for (int d = 0; d < 9; d++)
+        {
+            if (!(m_placed[u] & (1u << d)) && (m_pos[d] & T.unitMask[u]).empty())
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findHiddenSingle(Deduction &deduction) const
+{
+    // 先找宫，再找行列，和人的习惯一致
+    for (int n = 0; n < 27; n++)
+    {
+        int u = (n + 18) % 27;
+        for (int d = 0; d < 9; d++)
+        {
+            if (m_placed[u] & (1u << d))
+            {
+                continue;
+            }
+            Bitboard cells = m_pos[d] & T.unitMask[u];
+            if (cells.count() == 1)
+            {
+                deduction.technique = HIDDEN_SINGLE;
+                deduction.cell = cells.first();
+                deduction.digit = d + 1;
+                deduction.pattern.assign(T.unitCells[u], T.unitCells[u] + 9);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findNakedSingle(Deduction &deduction) const
+{
+    for (int i = 0; i < 81; i++)
+    {
+        if (m_value[i] == 0 && bitCount(m_cand[i]) == 1)
+        {
+            deduction.technique = NAKED_SINGLE;
+            deduction.cell = i;
+            deduction.digit = lowestDigit(m_cand[i]);
+            deduction.pattern.push_back(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Rater::findPointing(Deduction &deduction) const
+{
+    for (int b = 18; b < 27; b++)
+    {
+        for (int d = 1; d <= 9; d++)
+        {
+            Bitboard cells = m_pos[d - 1] & T.unitMask[b];
+            if (cells.empty())
+            {
+                continue;
+            }
+            for (int row = 1; row >= 0; row--)
+            {
+                int line = commonLine(cells, cells.first(), row);
+                if (line < 0)
+                {
+                    continue;
+                }
+                addEliminations(deduction, T.unitMask[line] & ~T.unitMask[b], d);
+                if (!deduction.eliminations.empty())
+                {
+                    deduction.technique = POINTING;
+                    for (Bitboard c = cells; !c.empty();)
+                    {
+                        deduction.pattern.push_back(c.pop());
+                    }
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findClaiming(Deduction &deduction) const
+{
+    for (int u = 0; u < 18; u++)
+    {
+        for (int d = 1; d <= 9; d++)
+        {
+            Bitboard cells = m_pos[d - 1] & T.unitMask[u];
+            if (cells.empty())
+            {
+                continue;
+            }
+            int box = T.cellUnits[cells.first()][2];
+            if (!cells.subsetOf(T.unitMask[box]))
+            {
+                continue;
+            }
+            addEliminations(deduction, T.unitMask[box] & ~T.unitMask[u], d);
+            if (!deduction.eliminations.empty())
+            {
+                deduction.technique = CLAIMING;
+                for (Bitboard c = cells; !c.empty();)
+                {
+                    deduction.pattern.push_back(c.pop());
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findNakedSubset(Deduction &deduction, int size) const
+{
+    static const Technique techniques[] = { NAKED_SINGLE, NAKED_SINGLE, NAKED_PAIR, NAKED_TRIPLE, NAKED_QUAD };
+
+    for (int u = 0; u < 27; u++)
+    {
+        const int *cells = T.unitCells[u];
+        unsigned open = 0;
+        for (int k = 0; k < 9; k++)
+        {
+            if (m_value[cells[k]] == 0)
+            {
+                open |= 1u << k;
+            }
+        }
+        if (bitCount(open) <= size)
+        {
+            continue;
+        }
+
+        for (int combo : T.combos[size])
+        {
+            if (combo & ~open)
+            {
+                continue;
+            }
+            unsigned digits = 0;
+            for (unsigned m = combo; m; m &= m - 1)
+            {
+                digits |= m_cand[cells[lowestBit64(m)]];
+            }
+            if (bitCount(digits) != size)
+            {
+                continue;
+            }
+
+            for (unsigned m = open & ~combo; m; m &= m - 1)
+            {
+                int cell = cells[lowestBit64(m)];
+                for (unsigned hit = m_cand[cell] & digits; hit; hit &= hit - 1)
+                {
+                    deduction.eliminations.push_back(cell * 9 + lowestBit64(hit));
+                }
+            }
+            if (!deduction.eliminations.empty())
+            {
+                deduction.technique = techniques[size];
+                for (unsigned m = combo; m; m &= m - 1)
+                {
+                    deduction.pattern.push_back(cells[lowestBit64(m)]);
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findHiddenSubset(Deduction &deduction, int size) const
+{
+    static const Technique techniques[] = { HIDDEN_SINGLE, HIDDEN_SINGLE, HIDDEN_PAIR, HIDDEN_TRIPLE, HIDDEN_QUAD };
+
+    for (int u = 0; u < 27; u++)
+    {
+        unsigned free = ~m_placed[u] & 0x1ffu;
+        if (bitCount(free) <= size)
+        {
+            continue;
+        }
+
+        for (int combo : T.combos[size])
+        {
+            if (combo & ~free)
+            {
+                continue;
+            }
+            Bitboard cells;
+            for (unsigned m = combo; m; m &= m - 1)
+            {
+                cells |= m_pos[lowestBit64(m)] & T.unitMask[u];
+            }
+            if (cells.count() != size)
+            {
+                continue;
+            }
+
+            for (Bitboard c = cells; !c.empty();)
+            {
+                int cell = c.pop();
+                for (unsigned other = m_cand[cell] & ~combo; other; other &= other - 1)
+                {
+                    deduction.eliminations.push_back(cell * 9 + lowestBit64(other));
+                }
+            }
+            if (!deduction.eliminations.empty())
+            {
+                deduction.technique = techniques[size];
+                for (Bitboard c = cells; !c.empty();)
+                {
+                    deduction.pattern.push_back(c.pop());
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findFish(Deduction &deduction, int size) const
+{
+    static const Technique techniques[] = { HIDDEN_SINGLE, HIDDEN_SINGLE, X_WING, SWORDFISH, JELLYFISH };
+
+    for (int d = 1; d <= 9; d++)
+    {
+        const Bitboard &pos = m_pos[d - 1];
+
+        // base为0时以行为基础、列为覆盖，为9时反之
+        for (int base = 0; base <= 9; base += 9)
+        {
+            int cover = 9 - base;
+            unsigned lines[9]; // 每个基础单元中可填位置对应的覆盖单元
+            unsigned eligible = 0;
+            for (int i = 0; i < 9; i++)
+            {
+                lines[i] = 0;
+                for (int k = 0; k < 9; k++)
+                {
+                    if (pos.test(T.unitCells[base + i][k]))
+                    {
+                        lines[i] |= 1u << k;
+                    }
+                }
+                int count = bitCount(lines[i]);
+                if (count >= 2 && count <= size)
+                {
+                    eligible |= 1u << i;
+                }
+            }
+
+            for (int combo : T.combos[size])
+            {
+                if (combo & ~eligible)
+                {
+                    continue;
+                }
+                unsigned covers = 0;
+                Bitboard baseCells;
+                for (unsigned m = combo; m; m &= m - 1)
+                {
+                    int i = lowestBit64(m);
+                    covers |= lines[i];
+                    baseCells |= T.unitMask[base + i];
+                }
+                if (bitCount(covers) != size)
+                {
+                    continue;
+                }
+
+                Bitboard coverCells;
+                for (unsigned m = covers; m; m &= m - 1)
+                {
+                    coverCells |= T.unitMask[cover + lowestBit64(m)];
+                }
+                addEliminations(deduction, coverCells & ~baseCells, d);
+                if (!deduction.eliminations.empty())
+                {
+                    deduction.technique = techniques[size];
+                    for (Bitboard c = baseCells & pos; !c.empty();)
+                    {
+                        deduction.pattern.push_back(c.pop());
+                    }
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findXYWing(Deduction &deduction) const
+{
+    for (int pivot = 0; pivot < 81; pivot++)
+    {
+        unsigned xy = m_cand[pivot];
+        if (bitCount(xy) != 2)
+        {
+            continue;
+        }
+        for (int a : T.peers[pivot])
+        {
+            unsigned xz = m_cand[a];
+            if (bitCount(xz) != 2 || bitCount(xz & xy) != 1)
+            {
+                continue;
+            }
+            unsigned z = xz & ~xy;
+            unsigned yz = (xy & ~xz) | z;
+            for (int b : T.peers[pivot])
+            {
+                if (b == a || m_cand[b] != yz)
+                {
+                    continue;
+                }
+                int digit = lowestDigit(z);
+                addEliminations(deduction, T.peerMask[a] & T.peerMask[b], digit);
+                if (!deduction.eliminations.empty())
+                {
+                    deduction.technique = XY_WING;
+                    deduction.pattern = { pivot, a, b };
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findXYZWing(Deduction &deduction) const
+{
+    for (int pivot = 0; pivot < 81; pivot++)
+    {
+        unsigned xyz = m_cand[pivot];
+        if (bitCount(xyz) != 3)
+        {
+            continue;
+        }
+        for (int a : T.peers[pivot])
+        {
+            unsigned xz = m_cand[a];
+            if (bitCount(xz) != 2 || (xz & ~xyz))
+            {
+                continue;
+            }
+            for (int b : T.peers[pivot])
+            {
+                unsigned yz = m_cand[b];
+                if (b <= a || bitCount(yz) != 2 || (yz & ~xyz) || (xz | yz) != xyz)
+                {
+                    continue;
+                }
+                int digit = lowestDigit(xz & yz);
+                addEliminations(deduction, T.peerMask[pivot] & T.peerMask[a] & T.peerMask[b], digit);
+                if (!deduction.eliminations.empty())
+                {
+                    deduction.technique = XYZ_WING;
+                    deduction.pattern = { pivot, a, b };
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findXChain(Deduction &deduction) const
+{
+    // 单数字链：强链（单元内只有两个位置）和弱链（互相可见）交替出现，
+    // 起点为假时终点必为真，因此同时看到起点和终点的格子都不能填该数字
+    for (int d = 1; d <= 9; d++)
+    {
+        const Bitboard &pos = m_pos[d - 1];
+
+        int strong[81][3];
+        int strongCount[81] = { 0 };
+        for (int u = 0; u < 27; u++)
+        {
+            Bitboard cells = pos & T.unitMask[u];
+            if (cells.count() != 2)
+            {
+                continue;
+            }
+            int a = cells.pop();
+            int b = cells.pop();
+            strong[a][strongCount[a]++] = b;
+            strong[b][strongCount[b]++] = a;
+        }
+
+        for (Bitboard starts = pos; !starts.empty();)
+        {
+            int start = starts.pop();
+            if (strongCount[start] == 0)
+            {
+                continue;
+            }
+
+            // 状态编号cell * 2 + on，on为1表示该格为真
+            int parent[162];
+            int links[162];
+            std::fill(parent, parent + 162, -2);
+            int queue[162];
+            int head = 0;
+            int tail = 0;
+            queue[tail++] = start * 2;
+            parent[start * 2] = -1;
+            links[start * 2] = 0;
+
+            while (head < tail)
+            {
+                int state = queue[head++];
+                int cell = state / 2;
+                if (state % 2 == 0)
+                {
+                    for (int k = 0; k < strongCount[cell]; k++)
+                    {
+                        int next = strong[cell][k] * 2 + 1;
+                        if (parent[next] != -2)
+                        {
+                            continue;
+                        }
+                        parent[next] = state;
+                        links[next] = links[state] + 1;
+                        queue[tail++] = next;
+
+                        int end = next / 2;
+                        if (links[next] >= 2 && end != start)
+                        {
+                            addEliminations(deduction, T.peerMask[start] & T.peerMask[end], d);
+                            if (!deduction.eliminations.empty())
+                            {
+                                deduction.technique = X_CHAIN;
+                                for (int s = next; s >= 0; s = parent[s])
+                                {
+                                    deduction.pattern.push_back(s / 2);
+                                }
+                                std::reverse(deduction.pattern.begin(), deduction.pattern.end());
+                                return true;
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    for (Bitboard weak = T.peerMask[cell] & pos; !weak.empty();)
+                    {
+                        int next = weak.pop() * 2;
+                        if (parent[next] != -2)
+                        {
+                            continue;
+                        }
+                        parent[next] = state;
+                        links[next] = links[state];
+                        queue[tail++] = next;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool Rater::findXYChain(Deduction &deduction) const
+{
+    // 双值格链：起点不为x时，链上每个格子的值依次确定，终点为x，
+    // 因此同时看到起点和终点的格子都不能填x
+    for (int start = 0; start < 81; start++)
+    {
+        unsigned pair = m_cand[start];
+        if (bitCount(pair) != 2)
+        {
+            continue;
+        }
+        for (unsigned xs = pair; xs; xs &= xs - 1)
+        {
+            int x = lowestBit64(xs);
+
+            // 状态编号cell * 9 + t，表示该格的值为t + 1
+            int parent[729];
+            int length[729];
+            std::fill(parent, parent + 729, -2);
+            std::vector<int> queue;
+            int first = start * 9 + lowestBit64(pair & ~(1u << x));
+            queue.push_back(first);
+            parent[first] = -1;
+            length[first] = 1;
+
+            for (size_t head = 0; head < queue.size(); head++)
+            {
+                int state = queue[head];
+                int cell = state / 9;
+                unsigned value = 1u << (state % 9);
+                for (int next : T.peers[cell])
+                {
+                    unsigned cand = m_cand[next];
+                    if (bitCount(cand) != 2 || !(cand & value))
+                    {
+                        continue;
+                    }
+                    int t = lowestBit64(cand & ~value);
+                    int nextState = next * 9 + t;
+                    if (parent[nextState] != -2)
+                    {
+                        continue;
+                    }
+                    parent[nextState] = state;
+                    length[nextState] = length[state] + 1;
+                    queue.push_back(nextState);
+
+                    if (t == x && next != start && length[nextState] >= 3)
+                    {
+                        addEliminations(deduction, T.peerMask[start] & T.peerMask[next], x + 1);
+                        if (!deduction.eliminations.empty())
+                        {
+                            deduction.technique = XY_CHAIN;
+                            for (int s = nextState; s >= 0; s = parent[s])
+                            {
+                                deduction.pattern.push_back(s / 9);
+                            }
+                            std::reverse(deduction.pattern.begin(), deduction.pattern.end());
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+Rating Rater::rate()
+{
+    Rating rating = { !m_broken, false, HIDDEN_SINGLE, 0.0, 0 };
+    Deduction deduction;
+
+    for (;;)
+    {
+        DeductionResult result = findDeduction(deduction);
+        if (result == DEDUCTION_STUCK)
+        {
+            rating.hardest = TRIAL_AND_ERROR;
+            rating.score = techniqueScore(TRIAL_AND_ERROR);
+            return rating;
+        }
+        if (result == DEDUCTION_CONTRADICTION)
+        {
+            m_broken = true;
+        }
+        if (result != DEDUCTION_FOUND)
+        {
+            break;
+        }
+        apply(deduction);
+        ++rating.steps;
+
+        double score = techniqueScore(deduction.technique);
+        if (score > rating.score)
+        {
+            rating.score = score;
+            rating.hardest = deduction.technique;
+        }
+    }
+
+    rating.valid = !m_broken;
+    rating.solved = rating.valid;
+    return rating;
+}
+
+void Rater::rateBatch(const uint8_t *puzzles, size_t count, Rating *ratings, int threads)
+{
+    if (threads < 1)
+    {
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+
+    // 每次领取一小段，减少线程间的竞争
+    const size_t chunk = 64;
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        Rater rater;
+        for (;;)
+        {
+            size_t begin = next.fetch_add(chunk);
+            if (begin >= count)
+            {
+                break;
+            }
+            size_t end = std::min(begin + chunk, count);
+            for (size_t i = begin; i < end; i++)
+            {
+                rater.load(puzzles + i * 81);
+                ratings[i] = rater.rate();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++)
+    {
+        pool.push_back(std::thread(work));
+    }
+    work();
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+}
+
+const char *Rater::techniqueName(Technique technique)
+{
+    static const char *names[TECHNIQUE_COUNT] = {
+        "Hidden Single", "Naked Single", "Pointing", "Claiming",
+        "Naked Pair", "X-Wing", "Hidden Pair", "Naked Triple", "Swordfish", "Hidden Triple",
+        "XY-Wing", "XYZ-Wing", "Naked Quad", "Jellyfish", "Hidden Quad",
+        "X-Chain", "XY-Chain", "Trial and Error"
+    };
+    return names[technique];
+}
+
+double Rater::techniqueScore(Technique technique)
+{
+    static const double scores[TECHNIQUE_COUNT] = {
+        1.5, 2.3, 2.6, 2.8,
+        3.0, 3.2, 3.4, 3.6, 3.8, 4.0,
+        4.2, 4.4, 5.0, 5.2, 5.4,
+        6.6, 7.0, 10.0
+    };
+    return scores[technique];
+}
+
+Difficulty Rater::difficultyOf(double score)
+{
+    if (score < 2.5)
+    {
+        return EASY;
+    }
+    if (score < 3.5)
+    {
+        return MEDIUM;
+    }
+    if (score < 5.0)
+    {
+        return HARD;
+    }
+    return EXPERT;
+}
+
+const char *Rater::difficultyName(Difficulty difficulty)
+{
+    static const char *names[DIFFICULTY_COUNT] = { "Easy", "Medium", "Hard", "Expert" };
+    return names[difficulty];
+}
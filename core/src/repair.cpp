@@ -0,0 +1,165 @@
+﻿#include "repair.h"
+
+#include <cstring>
+
+RepairSearch::RepairSearch()
+    : m_checks(0)
+{
+}
+
+RepairResult RepairSearch::run(const uint8_t *clues, const uint8_t *entries, Bitboard &removal,
+                               const SolveBudget &budget)
+{
+    std::memcpy(m_clues, clues, 81);
+    std::memcpy(m_entries, entries, 81);
+    m_budget = budget;
+    m_cores.clear();
+    m_checks = 0;
+    removal = Bitboard();
+
+    Bitboard all;
+    for (int i = 0; i < 81; i++)
+    {
+        if (entries[i] && !clues[i])
+        {
+            all.set(i);
+        }
+    }
+
+    Feasibility base = check(Bitboard());
+    if (base != FEASIBLE)
+    {
+        return base == INFEASIBLE ? REPAIR_UNSOLVABLE : REPAIR_STOPPED;
+    }
+
+    for (;;)
+    {
+        Bitboard chosen;
+        int size = 82;
+        hit(Bitboard(), 0, chosen, size);
+
+        Bitboard kept = all & ~chosen;
+        Feasibility result = check(kept);
+        if (result == FEASIBLE)
+        {
+            removal = chosen;
+            return REPAIR_FOUND;
+        }
+        Bitboard core;
+        if (result == UNDECIDED || !shrink(kept, core))
+        {
+            return REPAIR_STOPPED;
+        }
+        m_cores.push_back(core);
+    }
+}
+
+const std::vector<Bitboard> &RepairSearch::cores() const
+{
+    return m_cores;
+}
+
+int RepairSearch::checks() const
+{
+    return m_checks;
+}
+
+Feasibility RepairSearch::check(const Bitboard &cells)
+{
+    uint8_t board[81];
+    std::memcpy(board, m_clues, 81);
+    for (Bitboard rest = cells; !rest.empty();)
+    {
+        int cell = rest.pop();
+        board[cell] = m_entries[cell];
+    }
+    ++m_checks;
+    return m_checker.check(board, m_budget);
+}
+
+bool RepairSearch::shrink(Bitboard cells, Bitboard &core)
+{
+    core = Bitboard();
+    for (;;)
+    {
+        // 已知的部分本身无解，就是极小冲突集合
+        Feasibility result = check(core);
+        if (result != FEASIBLE)
+        {
+            return result == INFEASIBLE;
+        }
+
+        // 逐个加入候选直到无解，最后加入的一定属于冲突集合，之前加入的才是新的候选
+        Bitboard added = core;
+        Bitboard prefix;
+        int last = -1;
+        for (Bitboard rest = cells; !rest.empty();)
+        {
+            last = rest.pop();
+            added.set(last);
+            result = check(added);
+            if (result == UNDECIDED)
+            {
+                return false;
+            }
+            if (result == INFEASIBLE)
+            {
+                break;
+            }
+            prefix.set(last);
+        }
+        if (result != INFEASIBLE)
+        {
+            // 调用者保证core和cells一起无解，不会到这里
+            return false;
+        }
+        core.set(last);
+        cells = prefix;
+    }
+}
+
+void RepairSearch::hit(const Bitboard &chosen, int size, Bitboard &best, int &bestSize) const
+{
+    // 选出未命中的集合中最小的一个，同时用互不相交的未命中集合个数作为下界
+    const Bitboard *branch = nullptr;
+    int branchSize = 82;
+    int bound = 0;
+    Bitboard used;
+    for (const Bitboard &core : m_cores)
+    {
+        if (core.intersects(chosen))
+        {
+            continue;
+        }
+        int count = core.count();
+        if (count < branchSize)
+        {
+            branch = &core;
+            branchSize = count;
+        }
+        if (!core.intersects(used))
+        {
+            used |= core;
+            ++bound;
+        }
+    }
+
+    if (!branch)
+    {
+        if (size < bestSize)
+        {
+            best = chosen;
+            bestSize = size;
+        }
+        return;
+    }
+    if (size + bound >= bestSize)
+    {
+        return;
+    }
+
+    for (Bitboard cells = *branch; !cells.empty();)
+    {
+        hit(chosen | Bitboard::cell(cells.pop()), size + 1, best, bestSize);
+    }
+}
@@ -0,0 +1,341 @@
+﻿#include "solvemetrics.h"
+
+#include "sudokusolver.h"
+
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+const int SUB_BUCKETS = 1 << LatencyHistogram::SUB_BITS;
+
+/**
+ * @brief 导出的百分位数
+ */
+const struct
+{
+    double fraction;
+    const char *label;
+    const char *key;
+} QUANTILES[] = {
+    { 0.50, "0.5", "p50_us" },
+    { 0.90, "0.9", "p90_us" },
+    { 0.99, "0.99", "p99_us" },
+    { 0.999, "0.999", "p999_us" },
+};
+
+std::atomic<uint64_t> nextId(1);
+
+std::string format(const char *pattern, double value)
+{
+    char text[64];
+    std::snprintf(text, sizeof(text), pattern, value);
+    return text;
+}
+
+}
+
+struct SolveMetrics::Shard
+{
+    LatencyHistogram histograms[METRIC_COUNT];
+    std::thread::id owner;
+    Shard *next;
+};
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(uint64_t nanos)
+{
+    // 只有一个写者，读改写不需要原子指令
+    std::atomic<uint64_t> &bucket = m_buckets[bucketOf(nanos)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_sum.store(m_sum.load(std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+    if (nanos > m_max.load(std::memory_order_relaxed))
+    {
+        m_max.store(nanos, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other)
+{
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        uint64_t count = other.m_buckets[i].load(std::memory_order_relaxed);
+        if (count)
+        {
+            m_buckets[i].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    m_count.fetch_add(other.m_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint64_t otherMax = other.m_max.load(std::memory_order_relaxed);
+    uint64_t current = m_max.load(std::memory_order_relaxed);
+    while (otherMax > current && !m_max.compare_exchange_weak(current, otherMax, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::sum() const
+{
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const
+{
+    uint64_t n = count();
+    return n ? double(sum()) / double(n) : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const
+{
+    // 按桶重新求和，不依赖可能与桶不同步的m_count
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        total += m_buckets[i].load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = uint64_t(fraction * double(total - 1)) + 1;
+    uint64_t seen = 0;
+    uint64_t highest = max();
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            uint64_t limit = bucketLimit(i);
+            return limit < highest ? limit : highest;
+        }
+    }
+    return highest;
+}
+
+int LatencyHistogram::bucketOf(uint64_t nanos)
+{
+    if (nanos < uint64_t(SUB_BUCKETS))
+    {
+        return int(nanos);
+    }
+    // 最高位决定区间，其后SUB_BITS位决定区间内的桶
+    int exponent = 63;
+    while (!(nanos >> exponent))
+    {
+        --exponent;
+    }
+    return ((exponent - SUB_BITS + 1) << SUB_BITS) + int((nanos >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucketLimit(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return uint64_t(bucket);
+    }
+    int exponent = (bucket >> SUB_BITS) + SUB_BITS - 1;
+    uint64_t mantissa = uint64_t(SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1)) + 1);
+    // 最后一个桶的上界溢出为0，减一后正好是最大值
+    return (mantissa << (exponent - SUB_BITS)) - 1;
+}
+
+SolveMetrics::SolveMetrics()
+    : m_shards(nullptr)
+    , m_id(nextId.fetch_add(1))
+{
+}
+
+SolveMetrics::~SolveMetrics()
+{
+    Shard *shard = m_shards.load();
+    while (shard)
+    {
+        Shard *next = shard->next;
+        delete shard;
+        shard = next;
+    }
+}
+
+SolveMetrics::Shard *SolveMetrics::localShard()
+{
+    // 每个线程缓存最近使用的对象和分片
+    static thread_local uint64_t cachedId = 0;
+    static thread_local Shard *cachedShard = nullptr;
+    if (cachedId == m_id)
+    {
+        return cachedShard;
+    }
+
+    std::thread::id self = std::this_thread::get_id();
+    Shard *shard = m_shards.load(std::memory_order_acquire);
+    while (shard && shard->owner != self)
+    {
+        shard = shard->next;
+    }
+    if (!shard)
+    {
+        shard = new Shard;
+        shard->owner = self;
+        shard->next = m_shards.load(std::memory_order_relaxed);
+        while (!m_shards.compare_exchange_weak(shard->next, shard, std::memory_order_release,
+                                               std::memory_order_relaxed))
+        {
+        }
+    }
+    cachedId = m_id;
+    cachedShard = shard;
+    return shard;
+}
+
+void SolveMetrics::record(SolveMetric metric, uint64_t nanos)
+{
+    localShard()->histograms[metric].record(nanos);
+}
+
+void SolveMetrics::recordSolve(SolveMetric metric, uint64_t nanos, const SudokuSolver &solver)
+{
+    Shard *shard = localShard();
+    shard->histograms[metric].record(nanos);
+    if (solver.phaseTiming())
+    {
+        uint64_t propagate = solver.propagateNanos();
+        shard->histograms[METRIC_PROPAGATE].record(propagate);
+        shard->histograms[METRIC_SEARCH].record(nanos > propagate ? nanos - propagate : 0);
+    }
+}
+
+void SolveMetrics::snapshot(SolveMetric metric, LatencyHistogram &out) const
+{
+    out.reset();
+    for (Shard *shard = m_shards.load(std::memory_order_acquire); shard; shard = shard->next)
+    {
+        out.add(shard->histograms[metric]);
+    }
+}
+
+void SolveMetrics::reset()
+{
+    for (Shard *shard = m_shards.load(std::memory_order_acquire); shard; shard = shard->next)
+    {
+        for (LatencyHistogram &histogram : shard->histograms)
+        {
+            histogram.reset();
+        }
+    }
+}
+
+const char *SolveMetrics::metricName(SolveMetric metric)
+{
+    static const char *const names[METRIC_COUNT] = { "solve",    "uniqueness", "rate",
+                                                     "generate", "propagate",  "search" };
+    return metric >= 0 && metric < METRIC_COUNT ? names[metric] : "";
+}
+
+std::string SolveMetrics::toPrometheus(const std::string &prefix) const
+{
+    std::string text;
+    LatencyHistogram histogram;
+    // 操作和求解阶段分成两个指标族，同一族的样本要写在一起
+    const struct
+    {
+        const char *family;
+        const char *label;
+        const char *help;
+        int first;
+        int last;
+    } families[] = {
+        { "_operation_seconds", "operation", "Latency of solver operations.", METRIC_SOLVE, METRIC_GENERATE },
+        { "_solver_phase_seconds", "phase", "Time per solve spent in each solver phase.", METRIC_PROPAGATE,
+          METRIC_SEARCH },
+    };
+    for (const auto &family : families)
+    {
+        std::string name = prefix + family.family;
+        text += "# HELP " + name + " " + family.help + "\n";
+        text += "# TYPE " + name + " summary\n";
+        for (int metric = family.first; metric <= family.last; metric++)
+        {
+            snapshot(SolveMetric(metric), histogram);
+            std::string label = std::string(family.label) + "=\"" + metricName(SolveMetric(metric)) + "\"";
+            for (const auto &quantile : QUANTILES)
+            {
+                text += name + "{" + label + ",quantile=\"" + quantile.label + "\"} "
+                    + format("%.9g", double(histogram.percentile(quantile.fraction)) / 1e9) + "\n";
+            }
+            text += name + "_sum{" + label + "} " + format("%.9g", double(histogram.sum()) / 1e9) + "\n";
+            text += name + "_count{" + label + "} " + format("%.0f", double(histogram.count())) + "\n";
+        }
+
+        // 最大值不属于summary，单独作为gauge
+        std::string maxName = name.substr(0, name.size() - 8) + "_max_seconds";
+        text += "# HELP " + maxName + " Slowest value since start.\n";
+        text += "# TYPE " + maxName + " gauge\n";
+        for (int metric = family.first; metric <= family.last; metric++)
+        {
+            snapshot(SolveMetric(metric), histogram);
+            text += maxName + "{" + family.label + "=\"" + metricName(SolveMetric(metric)) + "\"} "
+                + format("%.9g", double(histogram.max()) / 1e9) + "\n";
+        }
+    }
+    return text;
+}
+
+std::string SolveMetrics::toJson() const
+{
+    std::string text = "{";
+    LatencyHistogram histogram;
+    for (int metric = 0; metric < METRIC_COUNT; metric++)
+    {
+        snapshot(SolveMetric(metric), histogram);
+        text += std::string(metric ? "," : "") + "\"" + metricName(SolveMetric(metric)) + "\":{";
+        text += "\"count\":" + format("%.0f", double(histogram.count()));
+        text += ",\"mean_us\":" + format("%.3f", histogram.mean() / 1e3);
+        for (const auto &quantile : QUANTILES)
+        {
+            text += std::string(",\"") + quantile.key
+                + "\":" + format("%.3f", double(histogram.percentile(quantile.fraction)) / 1e3);
+        }
+        text += ",\"max_us\":" + format("%.3f", double(histogram.max()) / 1e3) + "}";
+    }
+    return text + "}";
+}
+
+bool SolveMetrics::writeFile(const std::string &path) const
+{
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    std::string text = json ? toJson() + "\n" : toPrometheus();
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    return std::fclose(file) == 0 && ok;
+}
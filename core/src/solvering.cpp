@@ -0,0 +1,463 @@
+﻿#include "solvering.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(RingSlot) == 192, "a slot should fill three cache lines");
+static_assert(sizeof(RingHeader) % 64 == 0, "slots should start on a cache line");
+
+namespace {
+
+const char MAGIC[8] = { 'S', 'D', 'K', 'R', 'I', 'N', 'G', 0 };
+
+// 进入睡眠前忙等的次数，提交和求解都很快时可以省去系统调用
+const int SPIN_COUNT = 256;
+
+#ifdef __linux__
+
+// 跨进程的futex，不能用FUTEX_PRIVATE_FLAG
+void futexWait(std::atomic<uint32_t> &word, uint32_t expected, int timeoutMs)
+{
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = long(timeoutMs % 1000) * 1000000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected,
+            timeoutMs < 0 ? nullptr : &timeout, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t> &word, int count)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+/**
+ * @brief 等待word变为value，先忙等再睡眠
+ * @return 超时返回false
+ */
+bool waitFor(std::atomic<uint32_t> &word, uint32_t value, std::atomic<uint32_t> &waiters, int timeoutMs)
+{
+    for (int i = 0; i < SPIN_COUNT; i++)
+    {
+        if (word.load(std::memory_order_acquire) == value)
+        {
+            return true;
+        }
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    waiters.fetch_add(1);
+    bool reached = true;
+    uint32_t current;
+    while ((current = word.load()) != value)
+    {
+        int remaining = timeoutMs;
+        if (timeoutMs >= 0)
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long elapsed = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+            if (elapsed >= timeoutMs)
+            {
+                reached = false;
+                break;
+            }
+            remaining = int(timeoutMs - elapsed);
+        }
+        futexWait(word, current, remaining);
+    }
+    waiters.fetch_sub(1);
+    return reached;
+}
+
+/**
+ * @brief 设置word，有进程在等待时唤醒它们
+ */
+void publish(std::atomic<uint32_t> &word, uint32_t value, std::atomic<uint32_t> &waiters)
+{
+    word.store(value);
+    if (waiters.load() > 0)
+    {
+        futexWake(word, INT_MAX);
+    }
+}
+
+/**
+ * @brief 槽位的持有者是否已经退出，-1表示已被其他进程认领收回
+ */
+bool ownerExited(int32_t owner)
+{
+    return owner == -1 || (owner > 0 && kill(pid_t(owner), 0) != 0 && errno == ESRCH);
+}
+
+#endif
+
+}
+
+SolveRing::SolveRing()
+    : m_header(nullptr)
+    , m_slots(nullptr)
+    , m_size(0)
+    , m_owner(false)
+    , m_pid(0)
+{
+}
+
+SolveRing::~SolveRing()
+{
+    detach();
+}
+
+#ifdef __linux__
+
+bool SolveRing::create(const std::string &name, uint32_t slots)
+{
+    detach();
+    if (slots < 4 || (slots & (slots - 1)) != 0)
+    {
+        m_error = "the slot count must be a power of two, at least 4";
+        return false;
+    }
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    size_t size = sizeof(RingHeader) + size_t(slots) * sizeof(RingSlot);
+    if (fd < 0 || ftruncate(fd, off_t(size)) != 0 || !map(fd, size))
+    {
+        m_error = "cannot create shared memory " + name + ": " + std::strerror(errno);
+        if (fd >= 0)
+        {
+            close(fd);
+            shm_unlink(name.c_str());
+        }
+        return false;
+    }
+    close(fd);
+    m_name = name;
+    m_owner = true;
+    m_pid = int32_t(getpid());
+
+    // 新对象的内容全为0，就地构造计数器；魔数最后写，attach看到魔数时环已可用
+    new (m_header) RingHeader();
+    m_header->version = VERSION;
+    m_header->slotCount = slots;
+    for (uint32_t i = 0; i < slots; i++)
+    {
+        new (&m_slots[i]) RingSlot();
+        m_slots[i].sequence.store(i);
+        m_slots[i].waiters.store(0);
+        m_slots[i].owner.store(0);
+    }
+    m_header->head.store(0);
+    m_header->tail.store(0);
+    m_header->doorbell.store(0);
+    m_header->sleepers.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_header->magic, MAGIC, 8);
+    return true;
+}
+
+bool SolveRing::attach(const std::string &name)
+{
+    detach();
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(RingHeader) || !map(fd, size_t(info.st_size)))
+    {
+        m_error = "cannot open shared memory " + name + ", is the solver daemon running?";
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    close(fd);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t slots = m_header->slotCount;
+    if (std::memcmp(m_header->magic, MAGIC, 8) != 0 || m_header->version != VERSION || slots < 4
+        || (slots & (slots - 1)) != 0 || m_size != sizeof(RingHeader) + size_t(slots) * sizeof(RingSlot))
+    {
+        m_error = name + " is not a compatible solve ring";
+        detach();
+        return false;
+    }
+    m_name = name;
+    m_pid = int32_t(getpid());
+    return true;
+}
+
+void SolveRing::detach()
+{
+    if (m_header)
+    {
+        munmap(m_header, m_size);
+    }
+    if (m_owner)
+    {
+        shm_unlink(m_name.c_str());
+    }
+    m_header = nullptr;
+    m_slots = nullptr;
+    m_size = 0;
+    m_owner = false;
+    m_name.clear();
+}
+
+bool SolveRing::map(int fd, size_t size)
+{
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    m_header = static_cast<RingHeader *>(data);
+    m_slots = reinterpret_cast<RingSlot *>(static_cast<char *>(data) + sizeof(RingHeader));
+    m_size = size;
+    return true;
+}
+
+RingSlot *SolveRing::tryAcquire(uint32_t &ticket)
+{
+    uint32_t t = m_header->head.load(std::memory_order_acquire);
+    for (;;)
+    {
+        RingSlot *slot = &m_slots[t & (m_header->slotCount - 1)];
+        int32_t state = int32_t(slot->sequence.load(std::memory_order_acquire) - t);
+        if (state < 0)
+        {
+            // 上一圈的槽位还没有归还
+            return nullptr;
+        }
+        if (state == 0 && m_header->head.compare_exchange_weak(t, t + 1))
+        {
+            slot->owner.store(m_pid);
+            ticket = t;
+            return slot;
+        }
+        if (state > 0)
+        {
+            t = m_header->head.load(std::memory_order_acquire);
+        }
+    }
+}
+
+RingSlot *SolveRing::acquire(uint32_t &ticket)
+{
+    for (;;)
+    {
+        if (RingSlot *slot = tryAcquire(ticket))
+        {
+            return slot;
+        }
+        // 等待下一个票号的槽位被归还后重试
+        uint32_t t = m_header->head.load();
+        RingSlot *slot = &m_slots[t & (m_header->slotCount - 1)];
+        uint32_t current = slot->sequence.load();
+        if (int32_t(current - t) < 0)
+        {
+            slot->waiters.fetch_add(1);
+            futexWait(slot->sequence, current, -1);
+            slot->waiters.fetch_sub(1);
+        }
+    }
+}
+
+void SolveRing::submit(RingSlot *slot, uint32_t ticket)
+{
+    slot->sequence.store(ticket + 1);
+    m_header->doorbell.fetch_add(1);
+    if (m_header->sleepers.load() > 0)
+    {
+        futexWake(m_header->doorbell, 1);
+    }
+}
+
+bool SolveRing::wait(RingSlot *slot, uint32_t ticket, int timeoutMs)
+{
+    return waitFor(slot->sequence, ticket + 2, slot->waiters, timeoutMs);
+}
+
+void SolveRing::release(RingSlot *slot, uint32_t ticket)
+{
+    // 先清除持有者再归还，reclaim不会把下一个持有者的槽位当成旧的
+    slot->owner.store(0);
+    publish(slot->sequence, ticket + m_header->slotCount, slot->waiters);
+}
+
+RingSlot *SolveRing::next(uint32_t &ticket, const std::atomic<bool> &stop)
+{
+    int idle = 0;
+    for (;;)
+    {
+        uint32_t t = m_header->tail.load(std::memory_order_acquire);
+        RingSlot *slot = &m_slots[t & (m_header->slotCount - 1)];
+        int32_t state = int32_t(slot->sequence.load(std::memory_order_acquire) - (t + 1));
+        if (state == 0)
+        {
+            if (m_header->tail.compare_exchange_weak(t, t + 1))
+            {
+                ticket = t;
+                return slot;
+            }
+            continue;
+        }
+        if (state > 0)
+        {
+            // 其他线程已经取走，tail已经前进
+            continue;
+        }
+        if (stop)
+        {
+            return nullptr;
+        }
+        if (++idle < SPIN_COUNT)
+        {
+            continue;
+        }
+
+        // 先登记睡眠再读门铃，提交者要么看到登记而唤醒，要么门铃已变使futex立即返回
+        m_header->sleepers.fetch_add(1);
+        uint32_t bell = m_header->doorbell.load();
+        if (int32_t(slot->sequence.load() - (t + 1)) < 0 && !stop)
+        {
+            futexWait(m_header->doorbell, bell, -1);
+        }
+        m_header->sleepers.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void SolveRing::complete(RingSlot *slot, uint32_t ticket)
+{
+    publish(slot->sequence, ticket + 2, slot->waiters);
+}
+
+void SolveRing::wakeSolvers()
+{
+    m_header->doorbell.fetch_add(1);
+    futexWake(m_header->doorbell, INT_MAX);
+}
+
+uint32_t SolveRing::reclaim()
+{
+    uint32_t mask = m_header->slotCount - 1;
+    uint32_t reclaimed = 0;
+    for (uint32_t i = 0; i <= mask; i++)
+    {
+        RingSlot *slot = &m_slots[i];
+        int32_t owner = slot->owner.load();
+        if (!ownerExited(owner))
+        {
+            continue;
+        }
+        // 持有者已经退出，只有收回者会改变owner，用compare_exchange认领槽位
+        uint32_t sequence = slot->sequence.load();
+        uint32_t state = (sequence - i) & mask;
+        if (state == 0 && owner != -1 && slot->owner.compare_exchange_strong(owner, -1))
+        {
+            // 领取后没有提交：作为空槽位提交，求解完成后由下一次收回归还
+            slot->limit = 0;
+            submit(slot, sequence);
+            ++reclaimed;
+        }
+        else if (state == 2 && slot->owner.compare_exchange_strong(owner, 0))
+        {
+            publish(slot->sequence, sequence - 2 + m_header->slotCount, slot->waiters);
+            if (owner != -1)
+            {
+                ++reclaimed;
+            }
+        }
+    }
+    return reclaimed;
+}
+
+#else
+
+bool SolveRing::create(const std::string &, uint32_t)
+{
+    m_error = "the solve ring needs Linux";
+    return false;
+}
+
+bool SolveRing::attach(const std::string &)
+{
+    m_error = "the solve ring needs Linux";
+    return false;
+}
+
+void SolveRing::detach()
+{
+}
+
+bool SolveRing::map(int, size_t)
+{
+    return false;
+}
+
+RingSlot *SolveRing::tryAcquire(uint32_t &)
+{
+    return nullptr;
+}
+
+RingSlot *SolveRing::acquire(uint32_t &)
+{
+    return nullptr;
+}
+
+void SolveRing::submit(RingSlot *, uint32_t)
+{
+}
+
+bool SolveRing::wait(RingSlot *, uint32_t, int)
+{
+    return false;
+}
+
+void SolveRing::release(RingSlot *, uint32_t)
+{
+}
+
+RingSlot *SolveRing::next(uint32_t &, const std::atomic<bool> &)
+{
+    return nullptr;
+}
+
+void SolveRing::complete(RingSlot *, uint32_t)
+{
+}
+
+void SolveRing::wakeSolvers()
+{
+}
+
+uint32_t SolveRing::reclaim()
+{
+    return 0;
+}
+
+#endif
+
+uint32_t SolveRing::slotCount() const
+{
+    return m_header ? m_header->slotCount : 0;
+}
+
+const std::string &SolveRing::errorString() const
+{
+    return m_error;
+}
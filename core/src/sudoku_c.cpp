@@ -0,0 +1,118 @@
+﻿#include "sudoku_c.h"
+
+#include "sudokusolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#define SUDOKU_VERSION_STRING "1.0.0"
+
+namespace {
+
+bool isValidInput(const uint8_t *puzzle)
+{
+    for (int i = 0; i < 81; i++)
+    {
+        if (puzzle[i] > 9)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int solveOne(SudokuSolver &solver, const uint8_t *puzzle, uint8_t *solution)
+{
+    if (!isValidInput(puzzle))
+    {
+        std::memset(solution, 0, 81);
+        return SUDOKU_INVALID;
+    }
+    if (solver.solve(puzzle, solution) == 0)
+    {
+        std::memset(solution, 0, 81);
+        return SUDOKU_NO_SOLUTION;
+    }
+    return SUDOKU_SOLVED;
+}
+
+}
+
+const char *sudoku_version(void)
+{
+    return SUDOKU_VERSION_STRING;
+}
+
+int sudoku_abi_version(void)
+{
+    return SUDOKU_ABI_VERSION;
+}
+
+int sudoku_solve(const uint8_t *puzzle, uint8_t *solution)
+{
+    SudokuSolver solver;
+    return solveOne(solver, puzzle, solution);
+}
+
+int sudoku_count(const uint8_t *puzzle, int limit)
+{
+    if (!isValidInput(puzzle))
+    {
+        return SUDOKU_INVALID;
+    }
+    SudokuSolver solver;
+    return solver.solve(puzzle, nullptr, limit);
+}
+
+size_t sudoku_solve_batch(const uint8_t *puzzles, size_t count, uint8_t *solutions,
+                          int *status, int threads)
+{
+    if (threads < 1)
+    {
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+    threads = int(std::min<size_t>(size_t(threads), (count + 63) / 64));
+
+    // 每次领取一小段，减少线程间的竞争；每个线程一个求解器，求解时不再分配内存
+    const size_t chunk = 64;
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> solved(0);
+    auto work = [&]() {
+        SudokuSolver solver;
+        size_t local = 0;
+        for (;;)
+        {
+            size_t begin = next.fetch_add(chunk);
+            if (begin >= count)
+            {
+                break;
+            }
+            size_t end = std::min(begin + chunk, count);
+            for (size_t i = begin; i < end; i++)
+            {
+                int result = solveOne(solver, puzzles + i * 81, solutions + i * 81);
+                if (status)
+                {
+                    status[i] = result;
+                }
+                local += result == SUDOKU_SOLVED;
+            }
+        }
+        solved += local;
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++)
+    {
+        pool.push_back(std::thread(work));
+    }
+    work();
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+    return solved;
+}
@@ -0,0 +1,438 @@
+﻿#include "sudokusolver.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief 相关格子和单元的查找表
+ */
+struct Tables
+{
+    int unitCells[27][9]; // 行0-8，列9-17，宫18-26
+    int peers[81][20];
+
+    Tables()
+    {
+        for (int i = 0; i < 9; i++)
+        {
+            for (int j = 0; j < 9; j++)
+            {
+                unitCells[i][j] = i * 9 + j;
+                unitCells[9 + i][j] = j * 9 + i;
+                unitCells[18 + i][j] = (i / 3 * 3 + j / 3) * 9 + i % 3 * 3 + j % 3;
+            }
+        }
+        for (int cell = 0; cell < 81; cell++)
+        {
+            int r = cell / 9;
+            int c = cell % 9;
+            int n = 0;
+            for (int other = 0; other < 81; other++)
+            {
+                int r2 = other / 9;
+                int c2 = other % 9;
+                bool sameBox = r / 3 == r2 / 3 && c / 3 == c2 / 3;
+                if (other != cell && (r == r2 || c == c2 || sameBox))
+                {
+                    peers[cell][n++] = other;
+                }
+            }
+        }
+    }
+};
+
+const Tables T;
+
+inline int bitCount(unsigned v)
+{
+    int count = 0;
+    while (v)
+    {
+        v &= v - 1;
+        ++count;
+    }
+    return count;
+}
+
+inline int lowestDigit(unsigned v)
+{
+    int digit = 1;
+    while (!(v & 1))
+    {
+        v >>= 1;
+        ++digit;
+    }
+    return digit;
+}
+
+}
+
+SudokuSolver::SudokuSolver()
+    : m_queued(0)
+    , m_solution(nullptr)
+    , m_limit(1)
+    , m_num(0)
+    , m_all(false)
+    , m_nodes(0)
+    , m_timing(false)
+    , m_stop(STOP_NONE)
+    , m_propagateNanos(0)
+    , m_consistent(false)
+{
+}
+
+int SudokuSolver::solve(const uint8_t *puzzle, uint8_t *solution, int limit)
+{
+    resetCounters();
+    std::chrono::steady_clock::time_point begin;
+    if (m_timing)
+    {
+        begin = std::chrono::steady_clock::now();
+    }
+    m_consistent = load(puzzle);
+    if (m_timing)
+    {
+        // 填入线索和第一次传播都算作传播
+        m_propagateNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - begin).count();
+    }
+    return finish(solution, limit);
+}
+
+int SudokuSolver::solveAll(const uint8_t *puzzle, uint8_t *solutions, int limit)
+{
+    m_all = true;
+    int count = solve(puzzle, solutions, limit);
+    m_all = false;
+    return count;
+}
+
+bool SudokuSolver::prepare(const uint8_t *puzzle)
+{
+    m_consistent = load(puzzle);
+    return m_consistent;
+}
+
+bool SudokuSolver::assign(int cell, int digit)
+{
+    State &root = m_stack[0];
+    if (!m_consistent || cell < 0 || cell >= 81)
+    {
+        return false;
+    }
+    // 传播可能已经推出了这个数字
+    if (root.value[cell] == digit)
+    {
+        return true;
+    }
+    if (root.value[cell] || digit < 1 || digit > 9 || !(root.cand[cell] & (1u << (digit - 1))))
+    {
+        m_consistent = false;
+        return false;
+    }
+    m_consistent = place(root, cell, digit) && propagate(root);
+    m_queued = 0;
+    return m_consistent;
+}
+
+int SudokuSolver::resume(uint8_t *solution, int limit)
+{
+    resetCounters();
+    return finish(solution, limit);
+}
+
+unsigned long long SudokuSolver::nodes() const
+{
+    return m_nodes;
+}
+
+void SudokuSolver::setBudget(const SolveBudget &budget)
+{
+    m_budget = budget;
+}
+
+SolveStop SudokuSolver::stopReason() const
+{
+    return m_stop;
+}
+
+void SudokuSolver::setPhaseTiming(bool enabled)
+{
+    m_timing = enabled;
+}
+
+bool SudokuSolver::phaseTiming() const
+{
+    return m_timing;
+}
+
+unsigned long long SudokuSolver::propagateNanos() const
+{
+    return m_propagateNanos;
+}
+
+void SudokuSolver::resetCounters()
+{
+    m_num = 0;
+    m_nodes = 0;
+    m_queued = 0;
+    m_propagateNanos = 0;
+    m_stop = STOP_NONE;
+    if (m_budget.maxMillis > 0)
+    {
+        m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_budget.maxMillis);
+    }
+}
+
+bool SudokuSolver::load(const uint8_t *puzzle)
+{
+    State &root = m_stack[0];
+    for (int i = 0; i < 81; i++)
+    {
+        root.cand[i] = 0x1ff;
+    }
+    std::memset(root.value, 0, sizeof(root.value));
+    root.remaining = 81;
+    m_queued = 0;
+
+    for (int i = 0; i < 81; i++)
+    {
+        int digit = puzzle[i];
+        if (digit == 0)
+        {
+            continue;
+        }
+        // 数字越界，或者和已经填入的线索冲突
+        if (digit > 9 || !(root.cand[i] & (1u << (digit - 1))) || !place(root, i, digit))
+        {
+            m_queued = 0;
+            return false;
+        }
+    }
+    return propagate(root);
+}
+
+int SudokuSolver::finish(uint8_t *solution, int limit)
+{
+    m_solution = solution;
+    m_limit = limit;
+    if (m_consistent)
+    {
+        search(0);
+    }
+    if (m_budget.progress)
+    {
+        m_budget.progress->store(m_nodes, std::memory_order_relaxed);
+    }
+    return m_num;
+}
+
+bool SudokuSolver::place(State &state, int cell, int digit)
+{
+    unsigned bit = 1u << (digit - 1);
+    state.value[cell] = uint8_t(digit);
+    state.cand[cell] = 0;
+    --state.remaining;
+
+    const int *peers = T.peers[cell];
+    for (int k = 0; k < 20; k++)
+    {
+        int peer = peers[k];
+        unsigned cand = state.cand[peer];
+        if (!(cand & bit))
+        {
+            continue;
+        }
+        cand ^= bit;
+        state.cand[peer] = uint16_t(cand);
+        if (cand == 0)
+        {
+            // 只有未填的格子才有候选数，删空说明矛盾
+            return false;
+        }
+        if (!(cand & (cand - 1)))
+        {
+            m_queue[m_queued++] = peer;
+        }
+    }
+    return true;
+}
+
+bool SudokuSolver::propagate(State &state)
+{
+    for (;;)
+    {
+        // 唯一余数
+        while (m_queued > 0)
+        {
+            int cell = m_queue[--m_queued];
+            if (state.value[cell])
+            {
+                continue;
+            }
+            if (!place(state, cell, lowestDigit(state.cand[cell])))
+            {
+                m_queued = 0;
+                return false;
+            }
+        }
+
+        if (state.remaining == 0)
+        {
+            return true;
+        }
+
+        // 隐性唯一数：某个数字在单元中只剩一个位置
+        bool found = false;
+        for (int u = 0; u < 27; u++)
+        {
+            const int *cells = T.unitCells[u];
+            unsigned once = 0;
+            unsigned twice = 0;
+            unsigned placed = 0;
+            for (int k = 0; k < 9; k++)
+            {
+                int cell = cells[k];
+                unsigned cand = state.cand[cell];
+                twice |= once & cand;
+                once |= cand;
+                if (state.value[cell])
+                {
+                    placed |= 1u << (state.value[cell] - 1);
+                }
+            }
+            if ((once | placed) != 0x1ff)
+            {
+                m_queued = 0;
+                return false;
+            }
+
+            unsigned unique = once & ~twice;
+            for (int k = 0; unique && k < 9; k++)
+            {
+                int cell = cells[k];
+                unsigned hit = state.cand[cell] & unique;
+                if (!hit)
+                {
+                    continue;
+                }
+                if (hit & (hit - 1))
+                {
+                    // 一个格子是两个数字的唯一位置
+                    m_queued = 0;
+                    return false;
+                }
+                unique ^= hit;
+                if (state.cand[cell] != hit)
+                {
+                    state.cand[cell] = uint16_t(hit);
+                    m_queue[m_queued++] = cell;
+                    found = true;
+                }
+            }
+        }
+
+        if (!found)
+        {
+            return true;
+        }
+    }
+}
+
+bool SudokuSolver::advance(State &next, int cell, int digit)
+{
+    if (!m_timing)
+    {
+        return place(next, cell, digit) && propagate(next);
+    }
+    auto start = std::chrono::steady_clock::now();
+    bool consistent = place(next, cell, digit) && propagate(next);
+    m_propagateNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start).count();
+    return consistent;
+}
+
+void SudokuSolver::checkBudget()
+{
+    if (m_budget.progress)
+    {
+        m_budget.progress->store(m_nodes, std::memory_order_relaxed);
+    }
+    if (m_budget.cancel && m_budget.cancel->load(std::memory_order_relaxed))
+    {
+        m_stop = STOP_CANCELLED;
+    }
+    else if (m_budget.maxNodes > 0 && m_nodes >= m_budget.maxNodes)
+    {
+        m_stop = STOP_NODES;
+    }
+    else if (m_budget.maxMillis > 0 && std::chrono::steady_clock::now() >= m_deadline)
+    {
+        m_stop = STOP_TIME;
+    }
+}
+
+void SudokuSolver::search(int depth)
+{
+    ++m_nodes;
+    const State &state = m_stack[depth];
+    if ((m_nodes & 255) == 0)
+    {
+        checkBudget();
+        if (m_stop != STOP_NONE)
+        {
+            return;
+        }
+    }
+
+    if (state.remaining == 0)
+    {
+        if (m_solution && (m_num == 0 || m_all))
+        {
+            std::memcpy(m_solution + 81 * m_num, state.value, 81);
+        }
+        ++m_num;
+        return;
+    }
+
+    // 选择候选数最少的格子
+    int best = -1;
+    int bestCount = 10;
+    for (int i = 0; i < 81; i++)
+    {
+        if (state.value[i])
+        {
+            continue;
+        }
+        int count = bitCount(state.cand[i]);
+        if (count < bestCount)
+        {
+            best = i;
+            bestCount = count;
+            if (count == 2)
+            {
+                break;
+            }
+        }
+    }
+
+    unsigned cand = state.cand[best];
+    while (cand && m_num < m_limit && m_stop == STOP_NONE)
+    {
+        unsigned bit = cand & (0u - cand);
+        cand ^= bit;
+
+        State &next = m_stack[depth + 1];
+        next = state;
+        if (advance(next, best, lowestDigit(bit)))
+        {
+            search(depth + 1);
+        }
+        else
+        {
+            m_queued = 0;
+        }
+    }
+}
@@ -0,0 +1,168 @@
+﻿/**
+ * @file boardmodel.h
+ * @brief Game state of the board, independent of the widgets
+ */
+
+#ifndef BOARDMODEL_H
+#define BOARDMODEL_H
+
+#include "bitboard.h"
+
+#include <QObject>
+
+#include <cstdint>
+
+/**
+ * @brief The BoardModel class 盘面上的数字、每个数字的位置、冲突数和候选数
+ * @details 修改一个格子只更新它的20个相关格子，候选数只由数字决定，撤销后完全恢复。
+ * 控件不保存状态，只根据信号重绘变化的格子；sudoku-modelcheck对照从头计算的结果随机检查它
+ */
+class BoardModel : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BoardModel(QObject *parent = nullptr);
+
+    /**
+     * @brief 和cell同行、同列或同宫的20个格子
+     */
+    static Bitboard peers(int cell);
+
+    /**
+     * @brief 第unit个单元的9个格子，行0-8，列9-17，宫18-26
+     */
+    static Bitboard unit(int unit);
+
+    /**
+     * @brief 载入谜题，非0的格子成为不可修改的谜面
+     * @param puzzle 按行排列的81个数字
+     */
+    void load(const uint8_t *puzzle);
+
+    /**
+     * @brief 修改一个格子，通知值、冲突数和剩余个数发生变化的格子和数字
+     * @param value 0表示清空
+     */
+    void setValue(int cell, int value);
+
+    /**
+     * @brief 清空所有玩家填入的数字
+     */
+    void clearEntries();
+
+    int value(int cell) const;
+
+    /**
+     * @brief 按行排列的81个数字
+     */
+    const uint8_t *values() const;
+
+    /**
+     * @brief 是否是谜面的格子
+     */
+    bool isGiven(int cell) const;
+
+    /**
+     * @brief 谜面的格子
+     */
+    Bitboard givens() const;
+
+    /**
+     * @brief 填着digit的格子
+     */
+    Bitboard positions(int digit) const;
+
+    /**
+     * @brief digit在第unit个单元中出现的次数
+     */
+    int unitCount(int unit, int digit) const;
+
+    /**
+     * @brief 和cell的值相同的相关格子个数，空格为0
+     */
+    int conflicts(int cell) const;
+
+    /**
+     * @brief 有冲突的格子
+     */
+    Bitboard conflictCells() const;
+
+    /**
+     * @brief digit还可以再填几次，填多了时为负数
+     */
+    int remaining(int digit) const;
+
+    /**
+     * @brief 空格的候选数，第i位表示数字i+1没有出现在同行、同列和同宫；已填的格子为0
+     */
+    int candidates(int cell) const;
+
+signals:
+    /**
+     * @brief 格子的值改变了
+     */
+    void valueChanged(int cell, int value);
+
+    /**
+     * @brief 格子的冲突数改变了
+     */
+    void conflictsChanged(int cell, int conflicts);
+
+    /**
+     * @brief 数字的剩余个数改变了
+     */
+    void remainingChanged(int digit, int remaining);
+
+    /**
+     * @brief 格子的候选数改变了
+     */
+    void candidatesChanged(int cell, int candidates);
+
+    /**
+     * @brief 载入了新的谜题，所有格子都要重新显示
+     */
+    void loaded();
+
+private:
+    /**
+     * @brief 修改cell的冲突数，变化时通知
+     */
+    void setConflicts(int cell, int conflicts);
+
+    /**
+     * @brief 是否有同一单元的格子填着digit
+     */
+    bool seen(int cell, int digit) const;
+
+    /**
+     * @brief 没有出现在cell所在单元中的数字，已填的格子为0
+     */
+    int freeDigits(int cell) const;
+
+    /**
+     * @brief 重新判断空格cell的候选数中digit这一位，变化时通知
+     */
+    void updateCandidate(int cell, int digit);
+
+    /**
+     * @brief 修改cell的候选数，变化时通知
+     */
+    void setCandidates(int cell, int candidates);
+
+    uint8_t m_values[81];
+
+    Bitboard m_givens;
+
+    Bitboard m_positions[10]; // 下标0不用
+
+    uint8_t m_unitCounts[27][10];
+
+    uint8_t m_conflicts[81];
+
+    Bitboard m_conflictCells;
+
+    uint16_t m_candidates[81];
+};
+
+#endif // BOARDMODEL_H
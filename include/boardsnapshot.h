@@ -0,0 +1,43 @@
+﻿/**
+ * @file boardsnapshot.h
+ * @brief Copy-on-write snapshot of every cell state, shared row by row
+ */
+
+#ifndef BOARDSNAPSHOT_H
+#define BOARDSNAPSHOT_H
+
+#include <QSharedData>
+#include <QSharedDataPointer>
+
+/**
+ * @brief The BoardSnapshot class 81个格子的状态，按行分成9块
+ * @details 复制快照只复制9个指针，所有行仍然共享；修改某个格子时只复制它所在的一行。
+ * 两个快照的同一行是同一块内存时内容一定相同，比较时可以整行跳过
+ */
+class BoardSnapshot
+{
+public:
+    BoardSnapshot();
+
+    quint32 state(int cell) const;
+
+    /**
+     * @brief 修改一个格子，状态没变时不复制所在的行
+     */
+    void setState(int cell, quint32 value);
+
+    /**
+     * @brief 某一行是否和other共享同一块内存
+     */
+    bool sharesRow(const BoardSnapshot &other, int row) const;
+
+private:
+    struct Row : QSharedData
+    {
+        quint32 states[9] = {};
+    };
+
+    QSharedDataPointer<Row> m_rows[9];
+};
+
+#endif // BOARDSNAPSHOT_H
@@ -0,0 +1,25 @@
+﻿/**
+ * @file console.h
+ * @brief Headless batch modes started from the command line
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+/**
+ * @brief 判断命令行是否要求以无界面模式运行
+ * @param argc 参数个数
+ * @param argv 参数列表
+ */
+bool isConsoleMode(int argc, char *argv[]);
+
+/**
+ * @brief 以无界面模式运行
+ * @details 目前支持：
+ * --search-clues <终盘> 在终盘中搜索线索数不超过--max-clues的全部极小谜题
+ * --rate <文件> 为文件中的每个谜题评分，每行输出谜题、分数和最难的技巧
+ * @return 进程的返回值
+ */
+int runConsole(int argc, char *argv[]);
+
+#endif // CONSOLE_H
@@ -0,0 +1,58 @@
+﻿/**
+ * @file corpus.h
+ * @brief Packed puzzle corpus mapped into memory
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "packedcorpus.h"
+#include "puzzlepool.h"
+
+#include <QFile>
+
+/**
+ * @brief The Corpus class 由sudoku-corpus --format packed生成的谜题库
+ * @details 文件用mmap映射到内存，启动时只校验文件头；按难度随机选取一道谜题
+ * 只是一次下标计算和一条记录的解码，内存占用不随谜题数增长
+ */
+class Corpus
+{
+public:
+    Corpus();
+
+    ~Corpus();
+
+    /**
+     * @brief 映射谜题库文件
+     * @return 文件能否打开且格式有效
+     */
+    bool load(const QString &path);
+
+    /**
+     * @brief 随机选取一道指定难度的谜题
+     * @return 该难度没有谜题时返回false
+     */
+    bool pick(Difficulty level, PoolEntry &entry) const;
+
+    /**
+     * @brief 谜题总数
+     */
+    qint64 size() const;
+
+    /**
+     * @brief 谜题库是否保存了答案，没有时pick取出的答案全为0
+     */
+    bool hasSolutions() const;
+
+private:
+    void unload();
+
+    QFile m_file;
+
+    uchar *m_data;
+
+    CorpusView m_view;
+};
+
+#endif // CORPUS_H
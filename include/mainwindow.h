@@ -12,22 +12,58 @@
 #include "selectpanel.h"
 #include "gridwidget.h"
 #include "counter.h"
-
+#include "rater.h"
+#include "puzzlepool.h"
+#include "corpus.h"
+#include "sudokusolver.h"
+#include "boardmodel.h"
+#include "boardsnapshot.h"
+#include "feasibility.h"
+#include "repair.h"
+#include "sessionjournal.h"
+
+#include <QComboBox>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QMainWindow>
 #include <QPushButton>
-#include <QStack>
+#include <QSlider>
+#include <QTimer>
+
+#include <atomic>
+
+/**
+ * @brief 历史中某一步之后所有格子的状态，每隔若干步保存一份，跳转时从最近的一份开始重放
+ */
+struct Checkpoint
+{
+    quint32 states[81];
+};
 
 /**
- * @brief The Op struct
+ * @brief 一个假设分支：盘面和它自己的历史，分叉时所有内容都和原分支共享
  */
-struct Op
+struct Branch
 {
-    int row;    // 操作的行数
-    int col;    // 操作的列数
-    int before; // 更改前的值
-    int after;  // 更改后的值
-    Op(int _row = 0, int _col = 0, int _before = 0, int _after = 0)
-        : row(_row), col(_col), before(_before), after(_after) {}
+    QString name;
+    BoardSnapshot board;
+    QVector<Transaction> history;
+    QVector<Checkpoint> checkpoints;
+    int position = 0;
+};
+
+
+/**
+ * @brief 后台求解的结果
+ */
+struct SolveOutcome
+{
+    int count;                // 找到的解的个数
+    uint8_t solution[81];     // count大于0时有效
+    SolveStop stop;           // 停止的原因
+    unsigned long long nodes; // 访问的节点数
+    RepairResult repair;      // 无解时修复的结果
+    Bitboard removal;         // 修复要删除的玩家数字
 };
 
 
@@ -62,10 +98,30 @@ private slots:
     void receiveResult(int selected);
 
     /**
-     * @brief 求解当前数独
+     * @brief 在后台求解当前数独，正在求解时取消
      */
     void solve();
 
+    /**
+     * @brief 后台求解结束，盘面没有变化时一次性填入答案
+     */
+    void solveFinished();
+
+    /**
+     * @brief 求解中定时在状态栏显示进度
+     */
+    void showSolveProgress();
+
+    /**
+     * @brief 在后台检查当前盘面是否还有解，上一次检查未结束时等它结束后再检查
+     */
+    void checkFeasibility();
+
+    /**
+     * @brief 检查结束，盘面已经变化时重新检查，否则无解时在状态栏提示
+     */
+    void feasibilityChecked();
+
     /**
      * @brief 随机加载数独
      */
@@ -81,11 +137,47 @@ private slots:
      */
     void redo();
 
+    /**
+     * @brief 从当前盘面分出一个新的分支并切换过去
+     */
+    void forkBranch();
+
+    /**
+     * @brief 切换到另一个分支，只重绘两个分支不同的格子
+     */
+    void switchBranch(int index);
+
+    /**
+     * @brief 跳到历史中的任意一步，只重绘最终的盘面
+     * @param position 已经生效的操作数，0是载入第一道谜题之后
+     */
+    void jumpTo(int position);
+
     /**
      * @brief 清除九宫格，不包括谜面
      */
     void clearAll();
 
+    /**
+     * @brief 提示下一步推理，高亮相关的格子并显示技巧名称
+     */
+    void hint();
+
+    /**
+     * @brief 标出所有和答案不符的数字
+     */
+    void checkBoard();
+
+    /**
+     * @brief 打开或关闭自动候选数，关闭后恢复手动标记的候选数
+     */
+    void setAutoMarks(bool enabled);
+
+    /**
+     * @brief 后台求出谜题的答案，唯一时缓存下来；期间换了谜题时为新谜题重新求解
+     */
+    void solutionFinished();
+
 private:
     Ui::MainWindow *ui;
 
@@ -111,14 +203,134 @@ private:
      */
     void clearGrid(int r, int c);
 
+    /**
+     * @brief 开始一步操作，之后到endAction为止的所有修改合成一条撤销记录，可以嵌套
+     */
+    void beginAction();
+
+    /**
+     * @brief 结束一步操作，有格子被修改时追加到历史，并丢弃可以重做的部分
+     */
+    void endAction();
+
+    /**
+     * @brief 格子的状态：数字或手动的候选数，以及是否是谜面
+     */
+    quint32 cellState(int cell) const;
+
+    /**
+     * @brief 手动标记的候选数，打开自动候选数时是保存下来的那份
+     */
+    int manualMarks(int cell) const;
+
+    /**
+     * @brief 设置空格的手动候选数
+     */
+    void setManualMarks(int cell, int marks);
+
+    /**
+     * @brief 把撤销记录应用到盘面上，所有格子修改完后一起重绘
+     * @param forward true表示重做，false表示撤销
+     */
+    void applyTransaction(const Transaction &transaction, bool forward);
+
+    /**
+     * @brief 把所有格子改成给定的状态，谜面不同时先换谜题，修改完后一起重绘
+     */
+    void applyStates(const quint32 *target);
+
+    /**
+     * @brief 把一个不是谜面的格子改成给定的状态，没有变化时不做任何事
+     */
+    void applyCellState(int cell, quint32 state);
+
+    /**
+     * @brief 把当前盘面和历史存进当前分支，没变的行仍然和其他分支共享
+     */
+    void captureBranch();
+
+    /**
+     * @brief 以当前的历史重写对局日志
+     */
+    void saveSession();
+
+    /**
+     * @brief 在状态数组上重放历史，不碰盘面和控件
+     * @param from states对应的步数
+     * @param to 重放到的步数，可以比from小
+     */
+    void replayHistory(quint32 *states, int from, int to) const;
+
+    /**
+     * @brief 以当前盘面为起点清空历史
+     */
+    void resetHistory();
+
+    /**
+     * @brief 恢复上一次的对局：重建历史和存档，显示当时的盘面
+     */
+    void restoreSession(const SessionState &session);
+
+    /**
+     * @brief 按当前步数更新回退、重做按钮和时间轴
+     */
+    void updateHistoryControls();
+
     /**
      * @brief 调整某个单元格的值
      * @param r 所选行
      * @param c 所选列
-     * @param previous 修改之前的值
      * @param selected 修改之后的值
      */
-    void changeNumber(int r, int c, int previous, int selected);
+    void changeNumber(int r, int c, int selected);
+
+    /**
+     * @brief 把谜题显示到九宫格上，并重置计数、候选数和操作栈
+     * @param puzzle 按行排列的81个数字，0表示空格
+     * @param solution 谜题的答案，为nullptr时在后台求解
+     */
+    void setPuzzle(const uint8_t *puzzle, const uint8_t *solution = nullptr);
+
+    /**
+     * @brief 从资源文件中随机读取一道谜题，谜题池为空时使用
+     * @param puzzle 读取的谜题
+     */
+    void readResourcePuzzle(uint8_t *puzzle);
+
+    /**
+     * @brief 取消提示的高亮和文字
+     */
+    void clearHint();
+
+    /**
+     * @brief 载入谜题后按盘面模型重新显示所有格子和计数
+     */
+    void showBoard();
+
+    /**
+     * @brief 求解无解时高亮最少要删除的玩家数字
+     */
+    void showRepair(const SolveOutcome &outcome);
+
+    /**
+     * @brief 在状态栏显示一行文字
+     */
+    void showStatus(const QString &text);
+
+    /**
+     * @brief 盘面被修改，正在进行的求解结果作废
+     */
+    void boardChanged();
+
+    /**
+     * @brief 根据缓存的答案重新计算所有错误的数字，并取消已有的标记
+     */
+    void resetMistakes();
+
+    /**
+     * @brief 在后台求m_solutionClues的答案，上一次求解未结束时取消它，等它结束后再求
+     */
+    void findSolution();
 
     /*****************************/
 
@@ -147,6 +359,26 @@ private:
      */
     QPushButton *m_redoButton;
 
+    /**
+     * @brief 历史时间轴，拖动时跳到对应的一步
+     */
+    QSlider *m_timeline;
+
+    /**
+     * @brief 分支列表
+     */
+    QComboBox *m_branchBox;
+
+    /**
+     * @brief 求解按钮，求解中变为取消按钮
+     */
+    QPushButton *m_solveButton;
+
+    /**
+     * @brief 状态栏，位于九宫格和按钮之间
+     */
+    QLabel *m_statusLabel;
+
     /*****************************/
 
     /**
@@ -172,24 +404,185 @@ private:
     bool m_forcing;
 
     /**
-     * @brief 储存每个数组单元格的影响范围
+     * @brief 盘面上的数字、每个数字的位置和冲突数，控件只显示它的内容
+     */
+    BoardModel m_board;
+
+    /**
+     * @brief 所有操作的记录，前m_historyPos条已经生效，其余的可以重做
+     */
+    QVector<Transaction> m_history;
+
+    /**
+     * @brief 当前盘面在历史中的位置
+     */
+    int m_historyPos;
+
+    /**
+     * @brief 第i个是前i * HISTORY_CHECKPOINT条操作生效后的盘面
+     */
+    QVector<Checkpoint> m_checkpoints;
+
+    /**
+     * @brief 所有分支，当前分支的内容在切换或分叉时才存进去
+     */
+    QVector<Branch> m_branches;
+
+    /**
+     * @brief 当前分支的下标
+     */
+    int m_branch;
+
+    /**
+     * @brief 正在进行的操作开始时每个格子的状态
+     */
+    quint32 m_actionStart[81];
+
+    /**
+     * @brief beginAction的嵌套层数，回到0时记录操作
+     */
+    int m_actionDepth;
+
+    /**
+     * @brief 之前的提示删除的候选数，之后的提示先在副本上删掉它们再推理
+     * @details 删除只依赖已填的数字，只有数字被擦掉或换谜题时才作废
+     */
+    Deduction m_hintEliminations;
+
+    /**
+     * @brief 提示高亮的格子
+     */
+    Bitboard m_hintCells;
+
+    /**
+     * @brief 预先生成的谜题，加载时直接从中取出
+     */
+    PuzzlePool *m_pool;
+
+    /**
+     * @brief 谜题库，谜题池为空时使用
+     */
+    Corpus m_corpus;
+
+    /**
+     * @brief 对局日志，每步操作都写进去，下次启动时恢复
+     */
+    SessionJournal *m_journal;
+
+    /**
+     * @brief 等待后台求解的结果
+     */
+    QFutureWatcher<SolveOutcome> m_solveWatcher;
+
+    /**
+     * @brief 求解中刷新进度的定时器
+     */
+    QTimer m_solveProgress;
+
+    /**
+     * @brief 求解开始后的时间
+     */
+    QElapsedTimer m_solveClock;
+
+    /**
+     * @brief 置为true时后台求解尽快停止
+     */
+    std::atomic<bool> m_cancelSolve;
+
+    /**
+     * @brief 后台求解已访问的节点数
+     */
+    std::atomic<unsigned long long> m_solveNodes;
+
+    /**
+     * @brief 盘面的版本，每次修改加一
+     */
+    quint64 m_boardVersion;
+
+    /**
+     * @brief 开始求解时的盘面版本，结束时不同则丢弃结果
+     */
+    quint64 m_solveVersion;
+
+    /**
+     * @brief 无解检查，保留上一次的解和传播状态；检查进行中只由工作线程访问
+     */
+    FeasibilityChecker m_feasibility;
+
+    /**
+     * @brief 等待后台无解检查的结果
+     */
+    QFutureWatcher<Feasibility> m_feasibilityWatcher;
+
+    /**
+     * @brief 盘面修改后延迟检查，连续输入时只检查最后的盘面
+     */
+    QTimer m_feasibilityDelay;
+
+    /**
+     * @brief 置为true时后台检查尽快停止
+     */
+    std::atomic<bool> m_cancelFeasibility;
+
+    /**
+     * @brief 开始检查时的盘面版本
+     */
+    quint64 m_feasibilityVersion;
+
+    /**
+     * @brief 当前谜题的答案，加载时缓存，m_hasSolution为false时无效
+     */
+    uint8_t m_solution[81];
+
+    /**
+     * @brief 答案是否已经求出并且唯一
+     */
+    bool m_hasSolution;
+
+    /**
+     * @brief 等待后台求出当前谜题的答案
+     */
+    QFutureWatcher<SolveOutcome> m_solutionWatcher;
+
+    /**
+     * @brief 置为true时后台求答案尽快停止
+     */
+    std::atomic<bool> m_cancelSolution;
+
+    /**
+     * @brief 需要在后台求答案的谜面
+     */
+    uint8_t m_solutionClues[81];
+
+    /**
+     * @brief 每次加载谜题加一
+     */
+    quint64 m_puzzleVersion;
+
+    /**
+     * @brief 开始求答案时的谜题版本
+     */
+    quint64 m_solutionVersion;
+
+    /**
+     * @brief 和答案不符的格子，在changeNumber中逐格更新
      */
-    QVector<QVector<QSet<QPair<int, int>>>> m_controlRanges;
+    Bitboard m_mistakes;
 
     /**
-     * @brief 储存每个数字的所有位置
+     * @brief 已经被标记为错误的格子
      */
-    QVector<QSet<QPair<int, int>>> m_numPositions;
+    Bitboard m_markedMistakes;
 
     /**
-     * @brief 操作栈，用于记录操作
+     * @brief 是否显示自动候选数，打开时格子的候选数只跟随盘面模型
      */
-    QStack<Op> m_undoOps;
+    bool m_autoMarks;
 
     /**
-     * @brief 操作栈，用于记录回退的操作
+     * @brief 打开自动候选数之前手动标记的候选数
      */
-    QStack<Op> m_redoOps;
+    int m_manualMarks[81];
 };
 
 #endif // MAINWINDOW_H
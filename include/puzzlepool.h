@@ -0,0 +1,114 @@
+﻿/**
+ * @file puzzlepool.h
+ * @brief Pool of pre-generated puzzles refilled in the background
+ */
+
+#ifndef PUZZLEPOOL_H
+#define PUZZLEPOOL_H
+
+#include "rater.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+/**
+ * @brief 池中的一道谜题，生成时已经求解并评分
+ */
+struct PoolEntry
+{
+    uint8_t puzzle[81];   // 谜面，0表示空格
+    uint8_t solution[81]; // 答案
+    float score;          // 难度分数，见Rater
+};
+
+/**
+ * @brief The PuzzlePool class 按难度分级缓存已生成的谜题
+ * @details 每个难度一个固定容量的环形队列，取出是O(1)的。
+ * 任一难度的数量低于水位线时唤醒后台的低优先级线程，生成、求解并评分新的谜题，
+ * 直到所有难度都补满。池中的内容在析构时保存到文件，下次启动时直接读回
+ */
+class PuzzlePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param path 保存池内容的文件，为空时不保存
+     * @param capacity 每个难度最多缓存的谜题数
+     * @param watermark 低于这个数量时开始补充
+     */
+    PuzzlePool(const QString &path, int capacity, int watermark, QObject *parent = nullptr);
+
+    /**
+     * @brief 停止后台线程并保存池的内容
+     */
+    ~PuzzlePool();
+
+    /**
+     * @brief 启动后台补充线程
+     */
+    void start();
+
+    /**
+     * @brief 取出一道指定难度的谜题
+     * @return 该难度为空时返回false
+     */
+    bool take(Difficulty level, PoolEntry &entry);
+
+    /**
+     * @brief 返回某个难度当前缓存的数量
+     */
+    int size(Difficulty level) const;
+
+    /**
+     * @brief 生成某个难度的谜题时保留的线索数下限
+     */
+    static int minClues(Difficulty level);
+
+private:
+    /**
+     * @brief 每个难度的环形队列
+     */
+    struct Ring
+    {
+        QVector<PoolEntry> entries;
+        int head = 0;
+        int count = 0;
+    };
+
+    /**
+     * @brief 后台线程的主循环
+     */
+    void run();
+
+    bool push(const PoolEntry &entry);
+
+    bool needsRefill() const;
+
+    bool isFull() const;
+
+    bool load();
+
+    bool save() const;
+
+    QString m_path;
+
+    int m_capacity;
+
+    int m_watermark;
+
+    Ring m_rings[DIFFICULTY_COUNT];
+
+    mutable QMutex m_mutex;
+
+    QWaitCondition m_wake;
+
+    QThread *m_thread;
+
+    bool m_stopping;
+};
+
+#endif // PUZZLEPOOL_H
@@ -0,0 +1,151 @@
+﻿/**
+ * @file sessionjournal.h
+ * @brief Crash-safe journal of the game session, restored at the next start
+ *
+ * The session (the board when the history starts, every action and the
+ * current position in the history) is kept in two files: a snapshot written
+ * atomically, and an append-only journal of the records added since. Records
+ * are handed to a background thread that appends them in batches and syncs
+ * the file once per batch, so the GUI thread never waits for the disk. Once
+ * the journal grows long it is compacted into a new snapshot. Every record
+ * carries a checksum; a torn record at the end of the journal is dropped.
+ */
+
+#ifndef SESSIONJOURNAL_H
+#define SESSIONJOURNAL_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+/**
+ * @brief 一步操作的撤销记录，无论修改了多少个格子都只有一条
+ * @details 每个被修改的格子压缩成一个32位整数：格子编号和修改前后的状态，见mainwindow.cpp
+ */
+struct Transaction
+{
+    QVector<quint32> changes;
+};
+
+/**
+ * @brief 一局游戏的全部内容
+ */
+struct SessionState
+{
+    quint32 base[81];             // 历史开始时每个格子的状态
+    QVector<Transaction> history; // 所有操作
+    int position = 0;             // 已经生效的操作数
+};
+
+/**
+ * @brief The SessionJournal class 把对局写入快照和追加日志，下次启动时恢复
+ * @details 日志中有两种记录：新的操作（同时丢弃可以重做的部分）和在历史中移动。
+ * 对象自己维护一份对局的副本，日志记录够多时在调用线程把副本序列化成快照，
+ * 交给后台线程写入并清空日志。快照和日志带有同一个代号，代号不同的日志已经合并进了快照
+ */
+class SessionJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param path 文件名的前缀，快照和日志分别加上.snap和.log
+     */
+    explicit SessionJournal(const QString &path, QObject *parent = nullptr);
+
+    /**
+     * @brief 写完所有记录后停止后台线程
+     */
+    ~SessionJournal();
+
+    /**
+     * @brief 读取上一次的对局，要在start之前调用
+     * @return 没有可用的快照时返回false
+     */
+    bool restore(SessionState &state);
+
+    /**
+     * @brief 启动后台写入线程
+     */
+    void start();
+
+    /**
+     * @brief 以新的对局代替原来的内容，立即写入快照
+     */
+    void reset(const SessionState &state);
+
+    /**
+     * @brief 记录一步新的操作
+     * @param position 操作之前的位置，之后的历史被丢弃
+     */
+    void appendAction(int position, const Transaction &transaction);
+
+    /**
+     * @brief 记录撤销、重做或跳转后的位置
+     */
+    void appendMove(int position);
+
+private:
+    /**
+     * @brief 等待写入的数据，snapshot为true时是整个快照
+     */
+    struct Pending
+    {
+        QByteArray data;
+        bool snapshot;
+        quint32 generation;
+    };
+
+    /**
+     * @brief 后台线程的主循环
+     */
+    void run();
+
+    /**
+     * @brief 把记录应用到对局的副本上
+     * @return 记录和副本不符时返回false
+     */
+    bool apply(int type, int position, const QVector<quint32> &changes);
+
+    void appendRecord(int type, int position, const QVector<quint32> &changes);
+
+    /**
+     * @brief 把对局的副本写成新的快照，之后的记录写进新的日志
+     */
+    void compact();
+
+    void enqueue(const QByteArray &data, bool snapshot);
+
+    QByteArray snapshotData() const;
+
+    QString m_snapshotPath;
+
+    QString m_journalPath;
+
+    SessionState m_state;
+
+    bool m_ready; // 对局副本是否有效，无效时不记录
+
+    int m_records; // 快照之后的记录数
+
+    quint32 m_generation; // 最新快照的代号
+
+    quint32 m_journalGeneration; // 日志文件头中的代号，start之后只由后台线程访问
+
+    qint64 m_validLength; // 日志中完整记录的长度，为0时需要重写
+
+    QVector<Pending> m_pending;
+
+    QMutex m_mutex;
+
+    QWaitCondition m_wake;
+
+    QThread *m_thread;
+
+    bool m_stopping;
+};
+
+#endif // SESSIONJOURNAL_H
@@ -85,15 +85,16 @@ public:
     void hideBackground();
 
     /**
-     * @brief 调整冲突数
-     * @param num 改变的冲突数
+     * @brief 设置冲突数，由盘面模型计算
+     * @param num 和该格值相同的相关格子数
      */
-    void changeConflict(int num);
+    void setConflict(int num);
 
     /**
-     * @brief 清空冲突数
+     * @brief 标记填入的数字和答案不符，没有冲突时绘制一个虚线圆环
+     * @param mistake 是否标记
      */
-    void clearConflict();
+    void setMistake(bool mistake);
 
     int m_multiValue;
 
@@ -195,6 +196,11 @@ private:
      */
     int m_numConflict;
 
+    /**
+     * @brief 是否被标记为错误
+     */
+    bool m_mistake;
+
     QString m_borderRadius;
     QString m_borderColor;
     QString m_fontColor;
@@ -1,8 +1,14 @@
 ﻿#include "mainwindow.h"
+#include "console.h"
 #include <QApplication>
 
 int main(int argc, char* argv[])
 {
+    // 批处理模式不创建窗口
+    if (isConsoleMode(argc, argv)) {
+        return runConsole(argc, argv);
+    }
+
     QApplication app(argc, argv);
 
     MainWindow w;
@@ -0,0 +1,277 @@
+﻿#include "boardmodel.h"
+
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief 编译期生成的查找表，Bitboard用lo和hi两个64位整数保存
+ */
+struct Tables
+{
+    uint64_t peerLo[81];
+    uint64_t peerHi[81];
+    uint64_t unitLo[27];
+    uint64_t unitHi[27];
+    int units[81][3]; // 每个格子所在的行、列和宫
+};
+
+constexpr Tables makeTables()
+{
+    Tables t{};
+    for (int cell = 0; cell < 81; cell++) {
+        int r = cell / 9;
+        int c = cell % 9;
+        int units[3] = { r, 9 + c, 18 + r / 3 * 3 + c / 3 };
+        for (int k = 0; k < 3; k++) {
+            t.units[cell][k] = units[k];
+            if (cell < 64) {
+                t.unitLo[units[k]] |= uint64_t(1) << cell;
+            } else {
+                t.unitHi[units[k]] |= uint64_t(1) << (cell - 64);
+            }
+        }
+    }
+    for (int cell = 0; cell < 81; cell++) {
+        for (int k = 0; k < 3; k++) {
+            t.peerLo[cell] |= t.unitLo[t.units[cell][k]];
+            t.peerHi[cell] |= t.unitHi[t.units[cell][k]];
+        }
+        if (cell < 64) {
+            t.peerLo[cell] &= ~(uint64_t(1) << cell);
+        } else {
+            t.peerHi[cell] &= ~(uint64_t(1) << (cell - 64));
+        }
+    }
+    return t;
+}
+
+constexpr Tables T = makeTables();
+
+static_assert(T.units[80][2] == 26, "cell 80 lies in the last box");
+static_assert(T.peerLo[0] == 0x80402010081c0ffeULL && T.peerHi[0] == 0x100, "peers of cell 0");
+
+}
+
+BoardModel::BoardModel(QObject* parent)
+    : QObject(parent)
+{
+    uint8_t empty[81] = {};
+    load(empty);
+}
+
+Bitboard BoardModel::peers(int cell)
+{
+    return Bitboard(T.peerLo[cell], T.peerHi[cell]);
+}
+
+Bitboard BoardModel::unit(int unit)
+{
+    return Bitboard(T.unitLo[unit], T.unitHi[unit]);
+}
+
+void BoardModel::load(const uint8_t* puzzle)
+{
+    std::memset(m_values, 0, sizeof(m_values));
+    std::memset(m_unitCounts, 0, sizeof(m_unitCounts));
+    std::memset(m_conflicts, 0, sizeof(m_conflicts));
+    for (Bitboard& positions : m_positions) {
+        positions = Bitboard();
+    }
+    m_givens = Bitboard();
+    m_conflictCells = Bitboard();
+
+    for (int cell = 0; cell < 81; cell++) {
+        int digit = puzzle[cell];
+        if (digit < 1 || digit > 9) {
+            continue;
+        }
+        m_values[cell] = uint8_t(digit);
+        m_givens.set(cell);
+        m_positions[digit].set(cell);
+        for (int unit : T.units[cell]) {
+            ++m_unitCounts[unit][digit];
+        }
+    }
+    // 空格的候选数，以及谜面本身可能有的冲突
+    for (int cell = 0; cell < 81; cell++) {
+        m_candidates[cell] = uint16_t(freeDigits(cell));
+        if (m_values[cell]) {
+            m_conflicts[cell] = uint8_t((peers(cell) & m_positions[m_values[cell]]).count());
+            if (m_conflicts[cell]) {
+                m_conflictCells.set(cell);
+            }
+        }
+    }
+    emit loaded();
+}
+
+void BoardModel::setValue(int cell, int value)
+{
+    int previous = m_values[cell];
+    if (previous == value || m_givens.test(cell)) {
+        return;
+    }
+
+    Bitboard around = peers(cell);
+
+    // 旧值从相关格子的冲突中去掉
+    if (previous) {
+        m_positions[previous].reset(cell);
+        for (int unit : T.units[cell]) {
+            --m_unitCounts[unit][previous];
+        }
+        for (Bitboard cells = around & m_positions[previous]; !cells.empty();) {
+            int other = cells.pop();
+            setConflicts(other, m_conflicts[other] - 1);
+        }
+    }
+
+    m_values[cell] = uint8_t(value);
+    emit valueChanged(cell, value);
+
+    // 三个单元里都没有这个数字时不会有冲突，不用求交集
+    int conflicts = 0;
+    if (value) {
+        if (seen(cell, value)) {
+            for (Bitboard cells = around & m_positions[value]; !cells.empty();) {
+                int other = cells.pop();
+                setConflicts(other, m_conflicts[other] + 1);
+                ++conflicts;
+            }
+        }
+        m_positions[value].set(cell);
+        for (int unit : T.units[cell]) {
+            ++m_unitCounts[unit][value];
+        }
+    }
+    setConflicts(cell, conflicts);
+
+    // 只有旧值和新值两个数字在相关的空格中可能改变
+    for (Bitboard cells = around; !cells.empty();) {
+        int other = cells.pop();
+        if (!m_values[other]) {
+            updateCandidate(other, previous);
+            updateCandidate(other, value);
+        }
+    }
+    setCandidates(cell, freeDigits(cell));
+
+    if (previous) {
+        emit remainingChanged(previous, remaining(previous));
+    }
+    if (value) {
+        emit remainingChanged(value, remaining(value));
+    }
+}
+
+void BoardModel::clearEntries()
+{
+    for (int cell = 0; cell < 81; cell++) {
+        if (m_values[cell] && !m_givens.test(cell)) {
+            setValue(cell, 0);
+        }
+    }
+}
+
+int BoardModel::value(int cell) const
+{
+    return m_values[cell];
+}
+
+const uint8_t* BoardModel::values() const
+{
+    return m_values;
+}
+
+bool BoardModel::isGiven(int cell) const
+{
+    return m_givens.test(cell);
+}
+
+Bitboard BoardModel::givens() const
+{
+    return m_givens;
+}
+
+Bitboard BoardModel::positions(int digit) const
+{
+    return m_positions[digit];
+}
+
+int BoardModel::unitCount(int unit, int digit) const
+{
+    return m_unitCounts[unit][digit];
+}
+
+int BoardModel::conflicts(int cell) const
+{
+    return m_conflicts[cell];
+}
+
+Bitboard BoardModel::conflictCells() const
+{
+    return m_conflictCells;
+}
+
+int BoardModel::remaining(int digit) const
+{
+    return 9 - m_positions[digit].count();
+}
+
+int BoardModel::candidates(int cell) const
+{
+    return m_candidates[cell];
+}
+
+bool BoardModel::seen(int cell, int digit) const
+{
+    const int* units = T.units[cell];
+    return (m_unitCounts[units[0]][digit] | m_unitCounts[units[1]][digit] | m_unitCounts[units[2]][digit]) != 0;
+}
+
+int BoardModel::freeDigits(int cell) const
+{
+    if (m_values[cell]) {
+        return 0;
+    }
+    int candidates = 0;
+    for (int digit = 1; digit <= 9; digit++) {
+        if (!seen(cell, digit)) {
+            candidates |= 1 << (digit - 1);
+        }
+    }
+    return candidates;
+}
+
+void BoardModel::updateCandidate(int cell, int digit)
+{
+    if (!digit) {
+        return;
+    }
+    unsigned bit = 1u << (digit - 1);
+    setCandidates(cell, seen(cell, digit) ? m_candidates[cell] & ~bit : m_candidates[cell] | bit);
+}
+
+void BoardModel::setCandidates(int cell, int candidates)
+{
+    if (m_candidates[cell] == candidates) {
+        return;
+    }
+    m_candidates[cell] = uint16_t(candidates);
+    emit candidatesChanged(cell, candidates);
+}
+
+void BoardModel::setConflicts(int cell, int conflicts)
+{
+    if (m_conflicts[cell] == conflicts) {
+        return;
+    }
+    m_conflicts[cell] = uint8_t(conflicts);
+    if (conflicts) {
+        m_conflictCells.set(cell);
+    } else {
+        m_conflictCells.reset(cell);
+    }
+    emit conflictsChanged(cell, conflicts);
+}
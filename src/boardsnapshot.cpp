@@ -0,0 +1,25 @@
+﻿#include "boardsnapshot.h"
+
+BoardSnapshot::BoardSnapshot()
+{
+    for (QSharedDataPointer<Row>& row : m_rows) {
+        row = new Row;
+    }
+}
+
+quint32 BoardSnapshot::state(int cell) const
+{
+    return m_rows[cell / 9]->states[cell % 9];
+}
+
+void BoardSnapshot::setState(int cell, quint32 value)
+{
+    if (state(cell) != value) {
+        m_rows[cell / 9]->states[cell % 9] = value;
+    }
+}
+
+bool BoardSnapshot::sharesRow(const BoardSnapshot& other, int row) const
+{
+    return m_rows[row].constData() == other.m_rows[row].constData();
+}
@@ -0,0 +1,168 @@
+﻿#include "console.h"
+#include "cluesearch.h"
+#include "puzzleparser.h"
+#include "rater.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+#include <csignal>
+#include <cstring>
+
+static ClueSearch *runningSearch = nullptr;
+
+// Ctrl+C时停止搜索，已完成的任务保存在检查点中
+static void interruptSearch(int)
+{
+    if (runningSearch)
+    {
+        runningSearch->stop();
+    }
+}
+
+static int searchClues(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+
+    std::vector<int> grid;
+    for (QChar ch : parser.value("search-clues"))
+    {
+        if (ch.isDigit())
+        {
+            grid.push_back(ch.digitValue());
+        }
+    }
+
+    ClueSearch search(grid);
+    if (!search.isValid())
+    {
+        err << "invalid solution grid\n";
+        return 1;
+    }
+    err << search.unavoidableSets().size() << " unavoidable sets\n";
+    err.flush();
+
+    runningSearch = &search;
+    std::signal(SIGINT, interruptSearch);
+    long long found = search.run(parser.value("max-clues").toInt(),
+                                 parser.value("threads").toInt(),
+                                 parser.value("output").toStdString(),
+                                 parser.value("checkpoint").toStdString());
+    std::signal(SIGINT, SIG_DFL);
+    runningSearch = nullptr;
+
+    if (found < 0)
+    {
+        err << QString::fromStdString(search.errorString()) << "\n";
+        return 1;
+    }
+    err << found << " puzzles found\n";
+    return 0;
+}
+
+static int ratePuzzles(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+
+    PuzzleReader input;
+    if (!input.open(parser.value("rate").toStdString()))
+    {
+        err << QString::fromStdString(input.errorString()) << "\n";
+        return 1;
+    }
+
+    QFile output(parser.value("output"));
+    bool opened = output.fileName() == "-" ? output.open(stdout, QIODevice::WriteOnly)
+                                           : output.open(QIODevice::WriteOnly);
+    if (!opened)
+    {
+        err << "cannot open " << output.fileName() << "\n";
+        return 1;
+    }
+
+    // 分块读取和评分，内存占用和语料大小无关
+    const int chunk = 1 << 16;
+    int threads = parser.value("threads").toInt();
+    std::vector<uint8_t> puzzles(size_t(chunk) * 81);
+    std::vector<Rating> ratings(chunk);
+    long long total = 0;
+
+    int count;
+    while ((count = int(input.read(puzzles.data(), size_t(chunk)))) > 0)
+    {
+        Rater::rateBatch(puzzles.data(), size_t(count), ratings.data(), threads);
+
+        QByteArray text;
+        for (int i = 0; i < count; i++)
+        {
+            const uint8_t *puzzle = &puzzles[size_t(i) * 81];
+            for (int k = 0; k < 81; k++)
+            {
+                text += puzzle[k] ? char('0' + puzzle[k]) : '.';
+            }
+            const Rating &rating = ratings[i];
+            if (rating.valid)
+            {
+                text += ' ' + QByteArray::number(rating.score, 'f', 1) + ' ' + Rater::techniqueName(rating.hardest) + '\n';
+            }
+            else
+            {
+                text += " invalid\n";
+            }
+        }
+        output.write(text);
+        total += count;
+    }
+
+    err << total << " puzzles rated";
+    if (input.skipped())
+    {
+        err << ", " << input.skipped() << " lines skipped";
+    }
+    err << "\n";
+    return 0;
+}
+
+// 参数是选项本身，或者是QCommandLineParser也接受的"--option=value"
+static bool isOption(const char *arg, const char *option)
+{
+    size_t length = std::strlen(option);
+    return std::strncmp(arg, option, length) == 0 && (arg[length] == '\0' || arg[length] == '=');
+}
+
+bool isConsoleMode(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (isOption(argv[i], "--search-clues") || isOption(argv[i], "--rate"))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int runConsole(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOptions({
+        { "search-clues", "Find every minimal puzzle inside the solution <grid>.", "grid" },
+        { "rate", "Rate every puzzle in <file>, - for stdin.", "file" },
+        { "max-clues", "Upper bound of the clue count.", "k", "17" },
+        { "threads", "Number of worker threads, 0 for all cores.", "n", "0" },
+        { "output", "Output file, - for stdout.", "file", "-" },
+        { "checkpoint", "Checkpoint file used to resume an interrupted run.", "file" },
+    });
+    parser.process(app);
+
+    if (parser.isSet("rate"))
+    {
+        return ratePuzzles(parser);
+    }
+    return searchClues(parser);
+}
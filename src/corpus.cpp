@@ -0,0 +1,68 @@
+﻿#include "corpus.h"
+
+#include <QRandomGenerator>
+
+#include <cstring>
+
+Corpus::Corpus()
+    : m_data(nullptr)
+{
+}
+
+Corpus::~Corpus()
+{
+    unload();
+}
+
+bool Corpus::load(const QString& path)
+{
+    unload();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    m_data = m_file.map(0, m_file.size());
+    if (!m_data || !m_view.attach(m_data, size_t(m_file.size()))) {
+        unload();
+        return false;
+    }
+    return true;
+}
+
+bool Corpus::pick(Difficulty level, PoolEntry& entry) const
+{
+    if (!m_view.isValid() || m_view.count(level) == 0) {
+        return false;
+    }
+
+    CorpusRecord record;
+    quint64 index = QRandomGenerator::global()->generate64() % m_view.count(level);
+    m_view.record(level, index, record);
+
+    std::memcpy(entry.puzzle, record.puzzle, 81);
+    std::memcpy(entry.solution, record.solution, 81);
+    entry.score = float(record.score);
+    return true;
+}
+
+qint64 Corpus::size() const
+{
+    return qint64(m_view.count());
+}
+
+bool Corpus::hasSolutions() const
+{
+    return m_view.isValid() && (m_view.fields() & CORPUS_SOLUTION) != 0;
+}
+
+void Corpus::unload()
+{
+    m_view.detach();
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_file.close();
+}
@@ -1,13 +1,52 @@
 ﻿#include "mainwindow.h"
 #include "ui_mainwindow.h"
 
-#include "sudokusolver.h"
+#include "puzzleparser.h"
 #include <QDebug>
 #include <QDir>
 #include <QFontDatabase>
 #include <QJsonDocument>
 #include <QRandomGenerator>
+#include <QStandardPaths>
 #include <QTime>
+#include <QtConcurrent>
+
+// 后台求解的预算，超出后放弃并提示
+const unsigned long long SOLVE_MAX_NODES = 200000000;
+const long long SOLVE_MAX_MILLIS = 30000;
+
+// 求解中刷新状态栏的间隔
+const int SOLVE_PROGRESS_INTERVAL = 100;
+
+// 撤销记录中格子的状态：0-8位是空格的候选数或已填的数字，再加两个标志位
+const quint32 STATE_FILLED = 1u << 9;
+const quint32 STATE_GIVEN = 1u << 10;
+const int STATE_BITS = 11;
+
+// 一个格子的修改：0-6位是格子编号，之后是修改前和修改后的状态
+inline quint32 packChange(int cell, quint32 before, quint32 after)
+{
+    return quint32(cell) | before << 7 | after << (7 + STATE_BITS);
+}
+
+inline int changeCell(quint32 change)
+{
+    return int(change & 0x7f);
+}
+
+inline quint32 changeState(quint32 change, bool after)
+{
+    return (change >> (after ? 7 + STATE_BITS : 7)) & ((1u << STATE_BITS) - 1);
+}
+
+// 历史中每隔多少步保存一份完整的盘面，跳转最多重放这么多步
+const int HISTORY_CHECKPOINT = 32;
+
+// 盘面修改后等待多久再检查是否无解，检查本身通常只要几微秒
+const int FEASIBILITY_DELAY = 15;
+
+// 无解检查的时间上限，超出后不提示
+const long long FEASIBILITY_MAX_MILLIS = 2000;
 
 /**
  * @brief 加载颜色风格
@@ -64,6 +103,20 @@ MainWindow::MainWindow(QWidget* parent)
     , m_sc(-1)
     , m_switching(false)
     , m_forcing(false)
+    , m_historyPos(0)
+    , m_branch(0)
+    , m_actionDepth(0)
+    , m_cancelSolve(false)
+    , m_solveNodes(0)
+    , m_boardVersion(0)
+    , m_solveVersion(0)
+    , m_cancelFeasibility(false)
+    , m_feasibilityVersion(0)
+    , m_hasSolution(false)
+    , m_cancelSolution(false)
+    , m_puzzleVersion(0)
+    , m_solutionVersion(0)
+    , m_autoMarks(false)
 {
     /*********************************************/
 
@@ -77,25 +130,14 @@ MainWindow::MainWindow(QWidget* parent)
 
     m_grids.resize(9);
     m_counters.resize(10);
-    m_numPositions.resize(10);
-    m_controlRanges.resize(9);
+
+    // 只记录删除，不确定任何格子
+    m_hintEliminations.cell = -1;
+    m_hintEliminations.digit = 0;
 
     for (int r = 0; r < 9; r++) {
         m_grids[r].resize(9);
-        m_controlRanges[r].resize(9);
         for (int c = 0; c < 9; c++) {
-            // initialize control range, doesn't include self
-            for (int i = 0; i < 9; i++) {
-                m_controlRanges[r][c].insert(qMakePair(r, i));
-                m_controlRanges[r][c].insert(qMakePair(i, c));
-            }
-            for (int i = r / 3 * 3; i < r / 3 * 3 + 3; i++) {
-                for (int j = c / 3 * 3; j < c / 3 * 3 + 3; j++) {
-                    m_controlRanges[r][c].insert(qMakePair(i, j));
-                }
-            }
-            m_controlRanges[r][c].erase(m_controlRanges[r][c].find(qMakePair(r, c)));
-
             GridWidget* grid = new GridWidget(r, c, gridSize, this);
             grid->move(margin + c * gridSize + c / 3 * spacing, margin + r * gridSize + r / 3 * spacing);
             grid->setColorStyle(colorStyle["GridWidget"].toObject());
@@ -141,11 +183,13 @@ MainWindow::MainWindow(QWidget* parent)
                 }
 
                 // 从有唯一值到有多选值也看做是一步操作
-                if (m_panel->m_selected && m_grids[m_sr][m_sc]->value()) {
+                beginAction();
+                if (m_panel->m_selected && m_board.value(m_sr * 9 + m_sc)) {
                     receiveResult(0);
                 }
 
-                m_grids[m_sr][m_sc]->setMultiValue(m_panel->m_selected);
+                setManualMarks(m_sr * 9 + m_sc, m_panel->m_selected);
+                endAction();
                 m_panel->hide();
                 smartAssistOff(m_sr, m_sc);
             });
@@ -158,10 +202,13 @@ MainWindow::MainWindow(QWidget* parent)
                     // 这里的逻辑还要再看看游戏里的逻辑是怎么样的
 
                     if (m_sr >= 0 && m_sc >= 0) {
-                        m_grids[m_sr][m_sc]->m_multiValue = m_panel->m_selected;
+                        beginAction();
+                        setManualMarks(m_sr * 9 + m_sc, m_panel->m_selected);
+                        endAction();
                         smartAssistOff(m_sr, m_sc);
                     }
-                    m_panel->setSelected(grid->value() ? 0 : grid->m_multiValue);
+                    // 菜单编辑的是玩家自己的候选数，自动候选数打开时格子上显示的不是它们
+                    m_panel->setSelected(m_board.value(r * 9 + c) ? 0 : manualMarks(r * 9 + c));
                     m_panel->show(grid->geometry().x(), grid->geometry().y());
                     grid->leave();
                     smartAssistOn(r, c);
@@ -179,26 +226,60 @@ MainWindow::MainWindow(QWidget* parent)
     this->setStyleSheet("QPushButton#createdButton{background-color:#FFFFFF;color:#5F5F5F;}"
                         "QPushButton#createdButton:hover{background-color:rgb(236, 236, 236);}"
                         "QPushButton#createdButton:pressed{background-color:rgb(222, 222, 222);}"
+                        "QPushButton#createdButton:checked{background-color:rgb(222, 222, 222);}"
                         "QPushButton#createdButton:!enabled{background-color:rgb(200, 200, 200);}");
 
+    // 底部的按钮平分九宫格的宽度
+    const int buttonCount = 6;
+    int buttonWidth = (gridSize * 9 + spacing * 2 - spacing * (buttonCount - 1)) / buttonCount;
+
     // 加载按钮
-    QPushButton* loadButton = createButton(this, QSize(gridSize * 3, gridSize), "Load");
+    QPushButton* loadButton = createButton(this, QSize(buttonWidth, gridSize), "Load");
     loadButton->setStyleSheet(QString("border-radius:%1px;").arg(halfSize));
-    loadButton->move(margin + (gridSize * 3 + spacing) * 0, margin + gridSize * 9 + halfSize);
+    loadButton->move(margin + (buttonWidth + spacing) * 0, margin + gridSize * 9 + halfSize);
     connect(loadButton, SIGNAL(clicked()), this, SLOT(loadRandomPuzzle()));
 
-    // 求解按钮
-    QPushButton* solveButton = createButton(this, QSize(gridSize * 3, gridSize), "Solve");
-    solveButton->setStyleSheet(QString("border-radius:%1px;").arg(halfSize));
-    solveButton->move(margin + (gridSize * 3 + spacing) * 1, margin + gridSize * 9 + halfSize);
-    connect(solveButton, SIGNAL(clicked()), this, SLOT(solve()));
+    // 求解按钮，求解中变为取消按钮
+    m_solveButton = createButton(this, QSize(buttonWidth, gridSize), "Solve");
+    m_solveButton->setStyleSheet(QString("border-radius:%1px;").arg(halfSize));
+    m_solveButton->move(margin + (buttonWidth + spacing) * 1, margin + gridSize * 9 + halfSize);
+    connect(m_solveButton, SIGNAL(clicked()), this, SLOT(solve()));
+    connect(&m_solveWatcher, SIGNAL(finished()), this, SLOT(solveFinished()));
+    m_solveProgress.setInterval(SOLVE_PROGRESS_INTERVAL);
+    connect(&m_solveProgress, SIGNAL(timeout()), this, SLOT(showSolveProgress()));
+
+    // 每次修改后在后台检查盘面是否还有解
+    m_feasibilityDelay.setSingleShot(true);
+    m_feasibilityDelay.setInterval(FEASIBILITY_DELAY);
+    connect(&m_feasibilityDelay, SIGNAL(timeout()), this, SLOT(checkFeasibility()));
+    connect(&m_feasibilityWatcher, SIGNAL(finished()), this, SLOT(feasibilityChecked()));
 
     // 清空按钮
-    QPushButton* clearButton = createButton(this, QSize(gridSize * 3, gridSize), "Clear");
+    QPushButton* clearButton = createButton(this, QSize(buttonWidth, gridSize), "Clear");
     clearButton->setStyleSheet(QString("border-radius:%1px;").arg(halfSize));
-    clearButton->move(margin + (gridSize * 3 + spacing) * 2, margin + gridSize * 9 + halfSize);
+    clearButton->move(margin + (buttonWidth + spacing) * 2, margin + gridSize * 9 + halfSize);
     connect(clearButton, SIGNAL(clicked()), this, SLOT(clearAll()));
 
+    // 提示按钮
+    QPushButton* hintButton = createButton(this, QSize(buttonWidth, gridSize), "Hint");
+    hintButton->setStyleSheet(QString("border-radius:%1px;").arg(halfSize));
+    hintButton->move(margin + (buttonWidth + spacing) * 3, margin + gridSize * 9 + halfSize);
+    connect(hintButton, SIGNAL(clicked()), this, SLOT(hint()));
+
+    // 检查按钮
+    QPushButton* checkButton = createButton(this, QSize(buttonWidth, gridSize), "Check");
+    checkButton->setStyleSheet(QString("border-radius:%1px;").arg(halfSize));
+    checkButton->move(margin + (buttonWidth + spacing) * 4, margin + gridSize * 9 + halfSize);
+    connect(checkButton, SIGNAL(clicked()), this, SLOT(checkBoard()));
+    connect(&m_solutionWatcher, SIGNAL(finished()), this, SLOT(solutionFinished()));
+
+    // 自动候选数开关
+    QPushButton* autoButton = createButton(this, QSize(buttonWidth, gridSize), "Auto");
+    autoButton->setStyleSheet(QString("border-radius:%1px;").arg(halfSize));
+    autoButton->move(margin + (buttonWidth + spacing) * 5, margin + gridSize * 9 + halfSize);
+    autoButton->setCheckable(true);
+    connect(autoButton, SIGNAL(toggled(bool)), this, SLOT(setAutoMarks(bool)));
+
     // 回退按钮
     m_undoButton = createButton(this, QSize(halfSize, gridSize), "<");
     m_undoButton->move(margin + gridSize * 9 + halfSize, margin + gridSize * 9 + halfSize);
@@ -211,16 +292,49 @@ MainWindow::MainWindow(QWidget* parent)
     m_redoButton->setStyleSheet(QString("border-top-right-radius:%1px;border-bottom-right-radius:%1px;").arg(halfSize / 2));
     connect(m_redoButton, SIGNAL(clicked()), this, SLOT(redo()));
 
+    // 历史时间轴，在按钮下面单独一行，右边是分支
+    int rowHeight = halfSize - spacing * 2;
+    int rowTop = margin + gridSize * 10 + halfSize + spacing;
+    m_timeline = new QSlider(Qt::Horizontal, this);
+    m_timeline->setFixedSize(gridSize * 6, rowHeight);
+    m_timeline->move(margin, rowTop);
+    m_timeline->setFocusPolicy(Qt::NoFocus);
+    connect(m_timeline, SIGNAL(valueChanged(int)), this, SLOT(jumpTo(int)));
+
+    // 分支列表
+    m_branchBox = new QComboBox(this);
+    m_branchBox->setFixedSize(gridSize * 2, rowHeight);
+    m_branchBox->move(margin + gridSize * 6 + spacing, rowTop);
+    m_branchBox->setFocusPolicy(Qt::NoFocus);
+    connect(m_branchBox, SIGNAL(activated(int)), this, SLOT(switchBranch(int)));
+
+    // 分叉按钮
+    QPushButton* forkButton = createButton(this, QSize(gridSize, rowHeight), "Fork");
+    forkButton->setStyleSheet(QString("border-radius:%1px;").arg(rowHeight / 2));
+    forkButton->move(margin + gridSize * 8 + spacing * 2, rowTop);
+    connect(forkButton, SIGNAL(clicked()), this, SLOT(forkBranch()));
+
+    // 状态栏
+    int nIndex = QFontDatabase::addApplicationFont(":/fonts/ARLRDBD.TTF");
+    QStringList strList(QFontDatabase::applicationFontFamilies(nIndex));
+    m_statusLabel = new QLabel(this);
+    m_statusLabel->setFont(QFont(strList.at(0), 11));
+    m_statusLabel->setFixedSize(gridSize * 9 + spacing * 2, halfSize - spacing * 2);
+    m_statusLabel->move(margin, margin + gridSize * 9 + spacing * 2);
+    m_statusLabel->setStyleSheet(QString("color:%1;").arg(colorStyle["Counter"].toObject()["cnt_font_color"].toString()));
+
     /***************************************/
 
     m_panel = new SelectPanel(gridSize, this);
     m_panel->setColorStyle(colorStyle["SelectPanel"].toObject());
     connect(m_panel, &SelectPanel::finish, [&](int selected) {
-        m_grids[m_sr][m_sc]->setMultiValue(0);
+        beginAction();
+        setManualMarks(m_sr * 9 + m_sc, 0);
         m_panel->m_selected = 0;
 
         smartAssistOff(m_sr, m_sc);
         receiveResult(selected);
+        endAction();
         m_forcing = true;
         m_panel->hide();
         m_forcing = false;
@@ -237,14 +351,58 @@ MainWindow::MainWindow(QWidget* parent)
         m_counters[num] = counter;
     }
 
-    loadRandomPuzzle();
+    // 控件只跟随盘面模型的变化
+    connect(&m_board, &BoardModel::valueChanged, this, [=](int cell, int value) {
+        m_grids[cell / 9][cell % 9]->setValue(value);
+    });
+    connect(&m_board, &BoardModel::conflictsChanged, this, [=](int cell, int conflicts) {
+        m_grids[cell / 9][cell % 9]->setConflict(conflicts);
+    });
+    connect(&m_board, &BoardModel::remainingChanged, this, [=](int digit, int remaining) {
+        m_counters[digit]->setCount(qMax(remaining, 0));
+    });
+    connect(&m_board, &BoardModel::candidatesChanged, this, [=](int cell, int candidates) {
+        if (m_autoMarks) {
+            m_grids[cell / 9][cell % 9]->setMultiValue(candidates);
+        }
+    });
+    connect(&m_board, &BoardModel::loaded, this, &MainWindow::showBoard);
+
+    // 谜题池，内容保存在应用数据目录中，启动后在后台补充
+    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataPath);
+    m_pool = new PuzzlePool(dataPath + "/pool.bin", 16, 8, this);
+    m_pool->start();
+
+    // sudoku-corpus --format packed生成的谜题库，放在同一个目录下
+    m_corpus.load(dataPath + "/corpus.sdc");
+
+    // 先读出上一次的对局并启动日志线程，之后加载谜题产生的记录才会写入
+    m_journal = new SessionJournal(dataPath + "/session", this);
+    SessionState session;
+    bool restored = m_journal->restore(session);
+    m_journal->start();
+
+    // 开始时只有一个分支
+    m_branches.resize(1);
+    m_branches[0].name = "Main";
+    m_branchBox->addItem(m_branches[0].name);
+
+    // 恢复上一次的对局；没有时随机加载一道谜题，它不能撤销
+    if (restored) {
+        restoreSession(session);
+    } else {
+        loadRandomPuzzle();
+        resetHistory();
+    }
+    captureBranch();
 
     /*********************************************/
 
     // 窗口设置
 
     int minSize = gridSize * 10 + halfSize + 2 * margin;
-    this->setMinimumSize(minSize, minSize);
+    this->setMinimumSize(minSize, minSize + halfSize);
 
     QLinearGradient linearGrad(QPointF(0, minSize), QPointF(minSize, 0));
     linearGrad.setColorAt(0, colorStyle["top_right_color"].toString());
@@ -258,88 +416,90 @@ MainWindow::MainWindow(QWidget* parent)
 
 MainWindow::~MainWindow()
 {
+    // 后台求解在取消后很快返回，等它结束再释放
+    m_cancelSolve = true;
+    m_cancelFeasibility = true;
+    m_cancelSolution = true;
+    m_solveWatcher.waitForFinished();
+    m_feasibilityWatcher.waitForFinished();
+    m_solutionWatcher.waitForFinished();
     delete ui;
     delete m_panel;
 }
 
 void MainWindow::receiveResult(int selected)
 {
-    int previous = m_grids[m_sr][m_sc]->value();
+    int previous = m_board.value(m_sr * 9 + m_sc);
     // 选择和之前相同表示清空当前格子
     if (previous == selected) {
         selected = 0;
     }
 
-    changeNumber(m_sr, m_sc, previous, selected);
-
-    m_undoOps.append(Op(m_sr, m_sc, previous, selected));
-    m_undoButton->setEnabled(true);
-
-    m_redoOps.clear();
-    m_redoButton->setEnabled(false);
+    beginAction();
+    changeNumber(m_sr, m_sc, selected);
+    endAction();
 }
 
 void MainWindow::highlight(int num, int active)
 {
-    for (auto pair : m_numPositions[num]) {
+    // 取消高亮时如果在选择状态，被覆盖的块不会被取消高亮，提示的格子也保持高亮
+    Bitboard keep = m_hintCells;
+    if (!active && m_panel->isVisible()) {
+        keep |= BoardModel::peers(m_sr * 9 + m_sc);
+    }
+
+    for (Bitboard cells = m_board.positions(num); !cells.empty();) {
+        int cell = cells.pop();
         if (active) {
-            m_grids[pair.first][pair.second]->showBackground();
-        }
-        // 取消高亮时如果在选择状态，被覆盖的块不会被取消高亮
-        else if (!m_panel->isVisible() || m_controlRanges[m_sr][m_sc].find(pair) == m_controlRanges[m_sr][m_sc].end()) {
-            m_grids[pair.first][pair.second]->hideBackground();
+            m_grids[cell / 9][cell % 9]->showBackground();
+        } else if (!keep.test(cell)) {
+            m_grids[cell / 9][cell % 9]->hideBackground();
         }
     }
 }
 
-void MainWindow::changeNumber(int r, int c, int previous, int selected)
+void MainWindow::changeNumber(int r, int c, int selected)
 {
-    m_grids[r][c]->setValue(selected);
-
-    int conflicts = 0;
+    clearHint();
+    boardChanged();
 
-    // 冲突检测，将和旧值相同的格子冲突数都减去1
-    if (previous > 0) {
-        m_counters[previous]->modify(1);
-        m_numPositions[previous].erase(m_numPositions[previous].find(qMakePair(r, c)));
-        for (auto pair : m_controlRanges[r][c]) {
-            if (m_grids[pair.first][pair.second]->value() == previous) {
-                m_grids[pair.first][pair.second]->changeConflict(-1);
-                --conflicts;
-            }
-        }
+    // 填了数字的格子不保留候选数，撤销记录里的状态才和显示一致
+    int cell = r * 9 + c;
+    if (selected && manualMarks(cell)) {
+        setManualMarks(cell, 0);
     }
 
-    // 如果新的值不为0，将和新值相同的格子冲突数加1，再计算本身的冲突数
-    if (selected > 0) {
-        m_counters[selected]->modify(-1);
-        m_numPositions[selected].insert(qMakePair(r, c));
-        for (auto pair : m_controlRanges[r][c]) {
-            if (m_grids[pair.first][pair.second]->value() == selected) {
-                m_grids[pair.first][pair.second]->changeConflict(1);
-                ++conflicts;
-            }
-        }
+    // 擦掉或改掉数字后，之前提示的删除可能不再成立
+    if (m_board.value(cell)) {
+        m_hintEliminations.eliminations.clear();
     }
 
-    m_grids[r][c]->changeConflict(conflicts);
+    // 冲突数和计数由盘面模型增量更新，控件通过信号刷新
+    m_board.setValue(cell, selected);
+
+    // 有答案时直接对照答案，原来的错误标记随旧值一起去掉
+    if (m_hasSolution && selected && selected != m_solution[cell]) {
+        m_mistakes.set(cell);
+    } else {
+        m_mistakes.reset(cell);
+    }
+    if (m_markedMistakes.test(cell)) {
+        m_markedMistakes.reset(cell);
+        m_grids[r][c]->setMistake(false);
+    }
 }
 
 void MainWindow::clearGrid(int r, int c)
 {
-    int previous = m_grids[r][c]->value();
+    int previous = m_board.value(r * 9 + c);
     // 之前也为空就什么也不做
     if (previous == 0) {
         return;
     }
 
-    changeNumber(r, c, previous, 0);
-
-    m_undoOps.append(Op(r, c, previous, 0));
-    m_undoButton->setEnabled(true);
-
-    m_redoOps.clear();
-    m_redoButton->setEnabled(false);
+    beginAction();
+    changeNumber(r, c, 0);
+    endAction();
 }
 
 void MainWindow::clearAll()
@@ -348,43 +508,43 @@ void MainWindow::clearAll()
         return;
     }
 
-    QVector<int> counts(10, 0);
-    for (int r = 0; r < 9; r++) {
-        for (int c = 0; c < 9; c++) {
-            int value = m_grids[r][c]->value();
-            m_grids[r][c]->setMultiValue(0);
-            if (m_grids[r][c]->isEnabled() && value) {
-                ++counts[value];
-                m_grids[r][c]->setValue(0);
-                m_numPositions[value].erase(m_numPositions[value].find(qMakePair(r, c)));
+    clearHint();
+    boardChanged();
+    beginAction();
+
+    // 自动候选数由盘面模型更新，只清除手动的
+    if (!m_autoMarks) {
+        for (int r = 0; r < 9; r++) {
+            for (int c = 0; c < 9; c++) {
+                m_grids[r][c]->setMultiValue(0);
             }
-            m_grids[r][c]->clearConflict();
         }
     }
-
-    for (int num = 1; num <= 9; ++num) {
-        m_counters[num]->modify(counts[num]);
-    }
-
-    m_undoOps.clear();
-    m_undoButton->setEnabled(false);
-
-    m_redoOps.clear();
-    m_redoButton->setEnabled(false);
+    std::fill(m_manualMarks, m_manualMarks + 81, 0);
+    m_board.clearEntries();
+    m_hintEliminations.eliminations.clear();
+    resetMistakes();
+    endAction();
 }
 
 void MainWindow::smartAssistOff(int r, int c)
 {
-    for (auto& pair : m_controlRanges[r][c]) {
-        m_grids[pair.first][pair.second]->hideBackground();
+    for (Bitboard cells = BoardModel::peers(r * 9 + c); !cells.empty();) {
+        int cell = cells.pop();
+        if (!m_hintCells.test(cell)) {
+            m_grids[cell / 9][cell % 9]->hideBackground();
+        }
+    }
+    if (!m_hintCells.test(r * 9 + c)) {
+        m_grids[r][c]->hideBackground();
     }
-    m_grids[r][c]->hideBackground();
 }
 
 void MainWindow::smartAssistOn(int r, int c)
 {
-    for (auto& pair : m_controlRanges[r][c]) {
-        m_grids[pair.first][pair.second]->showBackground();
+    for (Bitboard cells = BoardModel::peers(r * 9 + c); !cells.empty();) {
+        int cell = cells.pop();
+        m_grids[cell / 9][cell % 9]->showBackground();
     }
     m_grids[r][c]->showBackground();
 }
@@ -396,6 +556,33 @@ void MainWindow::loadRandomPuzzle()
         return;
     }
 
+    // 换谜题也是一步操作，可以撤销回原来的谜题和填入的数字
+    beginAction();
+
+    // 随机选一个难度，为空时依次尝试其他难度；先取谜题池，再取谜题库，都没有时才读资源文件
+    uint8_t puzzle[81];
+    PoolEntry entry;
+    int first = QRandomGenerator::global()->bounded(int(DIFFICULTY_COUNT));
+    for (int source = 0; source < 2; source++) {
+        for (int i = 0; i < DIFFICULTY_COUNT; i++) {
+            auto level = Difficulty((first + i) % DIFFICULTY_COUNT);
+            if (source == 0 ? m_pool->take(level, entry) : m_corpus.pick(level, entry)) {
+                // 不带答案的谜题库和资源文件中的谜题一样在后台求解
+                setPuzzle(entry.puzzle, source == 0 || m_corpus.hasSolutions() ? entry.solution : nullptr);
+                endAction();
+                showStatus(QString("%1 puzzle (%2)").arg(Rater::difficultyName(level)).arg(double(entry.score), 0, 'f', 1));
+                return;
+            }
+        }
+    }
+
+    readResourcePuzzle(puzzle);
+    setPuzzle(puzzle);
+    endAction();
+}
+
+void MainWindow::readResourcePuzzle(uint8_t* puzzle)
+{
     QString path = ":/puzzles/";
     QDir directory(path);
     QStringList files = directory.entryList(QStringList() << "*.txt", QDir::Files);
@@ -408,82 +595,457 @@ void MainWindow::loadRandomPuzzle()
 
     QFile file(path + files[n]);
     file.open(QFile::ReadOnly);
-    QString array = file.readAll();
-    QStringList rows = array.split('\n');
+    QByteArray data = file.readAll();
     file.close();
 
-    QVector<int> counts(10, 0);
-    for (auto& set : m_numPositions) {
-        set.clear();
+    // 资源文件中只有一道谜题，格式由解析器识别
+    PuzzleParser parser;
+    size_t consumed;
+    if (parser.parse(data.constData(), size_t(data.size()), true, puzzle, 1, consumed) == 0) {
+        std::fill(puzzle, puzzle + 81, uint8_t(0));
     }
+}
+
+void MainWindow::setPuzzle(const uint8_t* puzzle, const uint8_t* solution)
+{
+    clearHint();
+    boardChanged();
 
-    int val;
     for (int r = 0; r < 9; r++) {
-        QStringList cols = rows.at(r).split(' ');
         for (int c = 0; c < 9; c++) {
-            val = cols.at(c).toInt();
-            m_grids[r][c]->setEnabled(val == 0); // 值为0表示待填充，即可操作
-            m_grids[r][c]->setValue(val);
-            m_numPositions[val].insert(qMakePair(r, c));
-            ++counts[val];
+            m_grids[r][c]->setMultiValue(0);
+        }
+    }
+    std::fill(m_manualMarks, m_manualMarks + 81, 0);
+    m_board.load(puzzle);
+    m_hintEliminations.eliminations.clear();
+
+    // 谜题池和带答案的谜题库自带答案，其他谜题在后台求解，唯一时才用来检查
+    ++m_puzzleVersion;
+    m_hasSolution = solution != nullptr;
+    if (solution) {
+        std::copy(solution, solution + 81, m_solution);
+        if (m_solutionWatcher.isRunning()) {
+            m_cancelSolution = true;
         }
+    } else {
+        std::copy(puzzle, puzzle + 81, m_solutionClues);
+        findSolution();
     }
+    resetMistakes();
+}
 
-    for (int num = 1; num <= 9; ++num) {
-        m_counters[num]->setCount(9 - counts[num]);
+void MainWindow::findSolution()
+{
+    // 被取消的求解结束后由solutionFinished重新开始
+    if (m_solutionWatcher.isRunning()) {
+        m_cancelSolution = true;
+        return;
     }
 
-    m_undoOps.clear();
-    m_undoButton->setEnabled(false);
-    m_redoButton->setEnabled(false);
+    uint8_t clues[81];
+    std::copy(m_solutionClues, m_solutionClues + 81, clues);
+
+    m_cancelSolution = false;
+    m_solutionVersion = m_puzzleVersion;
+    m_solutionWatcher.setFuture(QtConcurrent::run([this, clues]() {
+        SolveBudget budget;
+        budget.maxNodes = SOLVE_MAX_NODES;
+        budget.maxMillis = SOLVE_MAX_MILLIS;
+        budget.cancel = &m_cancelSolution;
+
+        SudokuSolver solver;
+        solver.setBudget(budget);
+        SolveOutcome outcome;
+        outcome.count = solver.solve(clues, outcome.solution, 2);
+        outcome.stop = solver.stopReason();
+        outcome.nodes = solver.nodes();
+        return outcome;
+    }));
 }
 
 void MainWindow::solve()
 {
+    // 求解中按钮是取消按钮
+    if (m_solveWatcher.isRunning()) {
+        m_cancelSolve = true;
+        return;
+    }
+
     if (m_panel->isVisible()) {
         return;
     }
 
-    QVector<QVector<int>> puzzle(9, QVector<int>(9, 0));
+    // 不可编辑的格子是谜面，其余非空格子是玩家填入的数字
+    uint8_t puzzle[81];
+    uint8_t clues[81];
     for (int r = 0; r < 9; r++) {
         for (int c = 0; c < 9; c++) {
-            puzzle[r][c] = m_grids[r][c]->value();
+            puzzle[r * 9 + c] = uint8_t(m_board.value(r * 9 + c));
+            clues[r * 9 + c] = m_board.isGiven(r * 9 + c) ? puzzle[r * 9 + c] : 0;
         }
     }
 
-    SudokuSolver solver(puzzle);
-    solver.Solve();
-    if (solver.m_num == 0) {
+    clearHint();
+    m_cancelSolve = false;
+    m_solveNodes = 0;
+    m_solveVersion = m_boardVersion;
+    m_solveClock.start();
+    m_solveButton->setText("Cancel");
+    m_solveProgress.start();
+    showSolveProgress();
+
+    // 工作线程只访问两个原子变量，结果由solveFinished在界面线程中填入
+    m_solveWatcher.setFuture(QtConcurrent::run([this, puzzle, clues]() {
+        SolveBudget budget;
+        budget.maxNodes = SOLVE_MAX_NODES;
+        budget.maxMillis = SOLVE_MAX_MILLIS;
+        budget.cancel = &m_cancelSolve;
+        budget.progress = &m_solveNodes;
+
+        SudokuSolver solver;
+        solver.setBudget(budget);
+        SolveOutcome outcome;
+        outcome.count = solver.solve(puzzle, outcome.solution);
+        outcome.stop = solver.stopReason();
+        outcome.nodes = solver.nodes();
+
+        // 无解时找出最少要删除的玩家数字
+        outcome.repair = REPAIR_STOPPED;
+        if (outcome.count == 0 && outcome.stop == STOP_NONE) {
+            RepairSearch repair;
+            outcome.repair = repair.run(clues, puzzle, outcome.removal, budget);
+        }
+        return outcome;
+    }));
+}
+
+void MainWindow::solveFinished()
+{
+    m_solveProgress.stop();
+    m_solveButton->setText("Solve");
+
+    // 求解期间盘面被修改过，答案不再对应当前的盘面
+    if (m_solveVersion != m_boardVersion) {
+        m_statusLabel->clear();
         return;
     }
 
-    for (int num = 1; num <= 9; ++num) {
-        m_numPositions[num].clear();
-        m_counters[num]->setCount(0);
+    SolveOutcome outcome = m_solveWatcher.result();
+    double seconds = m_solveClock.elapsed() / 1000.0;
+    if (outcome.stop == STOP_CANCELLED) {
+        showStatus(QString("Solve cancelled after %L1 nodes").arg(outcome.nodes));
+        return;
+    }
+    if (outcome.stop != STOP_NONE) {
+        showStatus(QString("Gave up after %L1 nodes and %2 s").arg(outcome.nodes).arg(seconds, 0, 'f', 1));
+        return;
+    }
+    if (outcome.count == 0) {
+        showRepair(outcome);
+        return;
     }
 
+    boardChanged();
+    beginAction();
+
     for (int r = 0; r < 9; r++) {
         for (int c = 0; c < 9; c++) {
-            int value = solver.m_res[r][c];
             m_grids[r][c]->setMultiValue(0);
-            m_grids[r][c]->setValue(value);
-            m_numPositions[value].insert(qMakePair(r, c));
+            m_board.setValue(r * 9 + c, outcome.solution[r * 9 + c]);
+        }
+    }
+    resetMistakes();
+    endAction();
+    showStatus(QString("Solved in %1 s (%L2 nodes)").arg(seconds, 0, 'f', 2).arg(outcome.nodes));
+}
+
+void MainWindow::showBoard()
+{
+    for (int r = 0; r < 9; r++) {
+        for (int c = 0; c < 9; c++) {
+            int cell = r * 9 + c;
+            m_grids[r][c]->setEnabled(!m_board.isGiven(cell)); // 谜面不可操作
+            m_grids[r][c]->setValue(m_board.value(cell));
+            m_grids[r][c]->setConflict(m_board.conflicts(cell));
+            if (m_autoMarks) {
+                m_grids[r][c]->setMultiValue(m_board.candidates(cell));
+            }
+        }
+    }
+    for (int num = 1; num <= 9; ++num) {
+        m_counters[num]->setCount(qMax(m_board.remaining(num), 0));
+    }
+}
+
+void MainWindow::setAutoMarks(bool enabled)
+{
+    if (m_autoMarks == enabled) {
+        return;
+    }
+
+    // 打开时保存手动的候选数，关闭时恢复
+    m_autoMarks = enabled;
+    for (int cell = 0; cell < 81; cell++) {
+        GridWidget* grid = m_grids[cell / 9][cell % 9];
+        if (enabled) {
+            m_manualMarks[cell] = grid->multiValue();
+            grid->setMultiValue(m_board.candidates(cell));
+        } else {
+            grid->setMultiValue(m_board.value(cell) ? 0 : m_manualMarks[cell]);
+        }
+    }
+}
+
+void MainWindow::showRepair(const SolveOutcome& outcome)
+{
+    if (outcome.repair == REPAIR_UNSOLVABLE) {
+        showStatus("The puzzle itself has no solution");
+        return;
+    }
+    if (outcome.repair != REPAIR_FOUND) {
+        showStatus("No solution is reachable from this board");
+        return;
+    }
+
+    // 和提示一样高亮，盘面变化时取消
+    m_hintCells = outcome.removal;
+    QStringList parts;
+    for (Bitboard cells = outcome.removal; !cells.empty();) {
+        int cell = cells.pop();
+        m_grids[cell / 9][cell % 9]->showBackground();
+        if (parts.size() < 4) {
+            parts << QString("r%1c%2").arg(cell / 9 + 1).arg(cell % 9 + 1);
+        } else if (parts.size() == 4) {
+            parts << "...";
+        }
+    }
+    int count = outcome.removal.count();
+    showStatus(QString("No solution: erase %1 %2 (%3)").arg(count).arg(count == 1 ? "entry" : "entries").arg(parts.join(", ")));
+}
+
+void MainWindow::showSolveProgress()
+{
+    showStatus(QString("Solving... %L1 nodes, %2 s").arg(m_solveNodes.load()).arg(m_solveClock.elapsed() / 1000.0, 0, 'f', 1));
+}
+
+void MainWindow::boardChanged()
+{
+    ++m_boardVersion;
+    if (m_solveWatcher.isRunning()) {
+        m_cancelSolve = true;
+    }
+    if (m_feasibilityWatcher.isRunning()) {
+        m_cancelFeasibility = true;
+    }
+    m_feasibilityDelay.start();
+}
+
+void MainWindow::checkFeasibility()
+{
+    // 被取消的检查结束后由feasibilityChecked重新开始
+    if (m_feasibilityWatcher.isRunning()) {
+        return;
+    }
+
+    uint8_t board[81];
+    std::copy(m_board.values(), m_board.values() + 81, board);
+
+    m_cancelFeasibility = false;
+    m_feasibilityVersion = m_boardVersion;
+    m_feasibilityWatcher.setFuture(QtConcurrent::run([this, board]() {
+        SolveBudget budget;
+        budget.maxMillis = FEASIBILITY_MAX_MILLIS;
+        budget.cancel = &m_cancelFeasibility;
+        return m_feasibility.check(board, budget);
+    }));
+}
+
+void MainWindow::feasibilityChecked()
+{
+    // 检查期间盘面又被修改，等待中的延迟结束后会再检查，否则立即检查
+    if (m_feasibilityVersion != m_boardVersion) {
+        if (!m_feasibilityDelay.isActive()) {
+            checkFeasibility();
         }
+        return;
+    }
+
+    // 正在求解时状态栏显示求解进度，求解结束时自己会报告无解
+    if (m_feasibilityWatcher.result() == INFEASIBLE && !m_solveWatcher.isRunning()) {
+        showStatus("No solution is reachable from this board");
     }
 }
 
+void MainWindow::hint()
+{
+    if (m_panel->isVisible()) {
+        return;
+    }
+
+    clearHint();
+
+    // 从盘面模型增量维护的候选数开始推理；之前提示的删除先做掉，
+    // 否则只删除候选数的提示每次都一样，永远到不了下一步
+    uint16_t candidates[81];
+    for (int cell = 0; cell < 81; cell++) {
+        candidates[cell] = uint16_t(m_board.candidates(cell));
+    }
+    Rater state;
+    state.load(m_board.values(), candidates);
+    state.apply(m_hintEliminations);
+    Deduction deduction;
+    if (state.hasConflicts()) {
+        showStatus("Hint: resolve the conflicts on the board first");
+        return;
+    }
+    if (state.isFilled()) {
+        showStatus("The puzzle is solved");
+        return;
+    }
+    DeductionResult result = state.findDeduction(deduction);
+    if (result == DEDUCTION_CONTRADICTION) {
+        showStatus("Hint: no solution is reachable from this board");
+        return;
+    }
+    if (result == DEDUCTION_STUCK) {
+        showStatus("Hint: no logical step found, a guess is needed");
+        return;
+    }
+
+    if (deduction.cell < 0) {
+        m_hintEliminations.eliminations.insert(m_hintEliminations.eliminations.end(),
+                                               deduction.eliminations.begin(), deduction.eliminations.end());
+    }
+
+    for (int cell : deduction.pattern) {
+        m_hintCells.set(cell);
+    }
+    if (deduction.cell >= 0) {
+        m_hintCells.set(deduction.cell);
+    }
+    for (Bitboard cells = m_hintCells; !cells.empty();) {
+        int cell = cells.pop();
+        m_grids[cell / 9][cell % 9]->showBackground();
+    }
+
+    // 例如 "Hidden Single: r3c5 = 7" 或 "X-Wing: r1c2 ≠ 4, r7c2 ≠ 4"
+    QString text = QString("%1: ").arg(Rater::techniqueName(deduction.technique));
+    if (deduction.cell >= 0) {
+        text += QString("r%1c%2 = %3").arg(deduction.cell / 9 + 1).arg(deduction.cell % 9 + 1).arg(deduction.digit);
+    } else {
+        QStringList parts;
+        for (int code : deduction.eliminations) {
+            if (parts.size() == 4) {
+                parts << "...";
+                break;
+            }
+            int cell = code / 9;
+            parts << QString("r%1c%2 ≠ %3").arg(cell / 9 + 1).arg(cell % 9 + 1).arg(code % 9 + 1);
+        }
+        text += parts.join(", ");
+    }
+    showStatus(text);
+}
+
+void MainWindow::checkBoard()
+{
+    if (m_panel->isVisible()) {
+        return;
+    }
+
+    clearHint();
+    if (!m_hasSolution) {
+        if (m_solutionWatcher.isRunning()) {
+            showStatus("Check: still working out the solution, try again in a moment");
+        } else if (m_solutionWatcher.result().stop != STOP_NONE) {
+            showStatus("Check: the solution could not be worked out within the budget");
+        } else {
+            showStatus("Check: the puzzle has no unique solution");
+        }
+        return;
+    }
+
+    for (Bitboard cells = m_mistakes; !cells.empty();) {
+        int cell = cells.pop();
+        m_grids[cell / 9][cell % 9]->setMistake(true);
+    }
+    m_markedMistakes = m_mistakes;
+
+    int count = m_mistakes.count();
+    showStatus(count == 0 ? QString("No mistakes so far") : QString("%1 wrong %2").arg(count).arg(count == 1 ? "entry" : "entries"));
+}
+
+void MainWindow::solutionFinished()
+{
+    // 求解期间换了谜题：自带答案时不用再求，否则为新谜题重新求解
+    if (m_solutionVersion != m_puzzleVersion) {
+        if (!m_hasSolution) {
+            findSolution();
+        }
+        return;
+    }
+
+    // 超出预算时不知道答案是否唯一
+    SolveOutcome outcome = m_solutionWatcher.result();
+    if (outcome.count != 1 || outcome.stop != STOP_NONE) {
+        return;
+    }
+
+    // 求解期间已经填入的数字也要对照
+    std::copy(outcome.solution, outcome.solution + 81, m_solution);
+    m_hasSolution = true;
+    resetMistakes();
+}
+
+void MainWindow::resetMistakes()
+{
+    for (Bitboard cells = m_markedMistakes; !cells.empty();) {
+        int cell = cells.pop();
+        m_grids[cell / 9][cell % 9]->setMistake(false);
+    }
+    m_markedMistakes = Bitboard();
+
+    m_mistakes = Bitboard();
+    if (!m_hasSolution) {
+        return;
+    }
+    for (int cell = 0; cell < 81; cell++) {
+        int value = m_board.value(cell);
+        if (value && value != m_solution[cell]) {
+            m_mistakes.set(cell);
+        }
+    }
+}
+
+void MainWindow::clearHint()
+{
+    for (Bitboard cells = m_hintCells; !cells.empty();) {
+        int cell = cells.pop();
+        m_grids[cell / 9][cell % 9]->hideBackground();
+    }
+    m_hintCells = Bitboard();
+    m_statusLabel->clear();
+}
+
+void MainWindow::showStatus(const QString& text)
+{
+    m_statusLabel->setText(text);
+}
+
 void MainWindow::redo()
 {
     if (m_panel->isVisible()) {
         return;
     }
 
-    Op op = m_redoOps.pop();
-    m_undoOps.push(op);
-    changeNumber(op.row, op.col, op.before, op.after);
+    if (m_historyPos == m_history.size()) {
+        return;
+    }
 
-    m_undoButton->setEnabled(true);
-    m_redoButton->setEnabled(m_redoOps.size() > 0);
+    applyTransaction(m_history[m_historyPos++], true);
+    updateHistoryControls();
+    m_journal->appendMove(m_historyPos);
 }
 
 void MainWindow::undo()
@@ -492,10 +1054,321 @@ void MainWindow::undo()
         return;
     }
 
-    Op op = m_undoOps.pop();
-    m_redoOps.push(op);
-    changeNumber(op.row, op.col, op.after, op.before);
+    if (m_historyPos == 0) {
+        return;
+    }
+
+    applyTransaction(m_history[--m_historyPos], false);
+    updateHistoryControls();
+    m_journal->appendMove(m_historyPos);
+}
+
+void MainWindow::jumpTo(int position)
+{
+    position = qBound(0, position, m_history.size());
+    if (position == m_historyPos) {
+        return;
+    }
+    if (m_panel->isVisible()) {
+        updateHistoryControls();
+        return;
+    }
+
+    // 从最近的存档或当前盘面开始，在数组上重放，最多重放HISTORY_CHECKPOINT / 2步
+    int below = position / HISTORY_CHECKPOINT;
+    int above = below + 1;
+    int from = below * HISTORY_CHECKPOINT;
+    const quint32* start = m_checkpoints[below].states;
+    if (above < m_checkpoints.size() && above * HISTORY_CHECKPOINT - position < position - from) {
+        from = above * HISTORY_CHECKPOINT;
+        start = m_checkpoints[above].states;
+    }
+
+    quint32 target[81];
+    if (qAbs(position - m_historyPos) < qAbs(position - from)) {
+        from = m_historyPos;
+        for (int cell = 0; cell < 81; cell++) {
+            target[cell] = cellState(cell);
+        }
+    } else {
+        std::copy(start, start + 81, target);
+    }
+    replayHistory(target, from, position);
+
+    applyStates(target);
+    m_historyPos = position;
+    updateHistoryControls();
+    m_journal->appendMove(m_historyPos);
+    showStatus(QString("Move %1 of %2").arg(m_historyPos).arg(m_history.size()));
+}
+
+void MainWindow::beginAction()
+{
+    if (m_actionDepth++ == 0) {
+        for (int cell = 0; cell < 81; cell++) {
+            m_actionStart[cell] = cellState(cell);
+        }
+    }
+}
+
+void MainWindow::endAction()
+{
+    if (--m_actionDepth > 0) {
+        return;
+    }
+
+    Transaction transaction;
+    Checkpoint current;
+    for (int cell = 0; cell < 81; cell++) {
+        current.states[cell] = cellState(cell);
+        if (current.states[cell] != m_actionStart[cell]) {
+            transaction.changes.append(packChange(cell, m_actionStart[cell], current.states[cell]));
+        }
+    }
+    if (transaction.changes.isEmpty()) {
+        return;
+    }
+
+    // 新的操作之后，原来可以重做的部分和它们的存档都作废
+    m_history.resize(m_historyPos);
+    m_checkpoints.resize(m_historyPos / HISTORY_CHECKPOINT + 1);
+    m_history.append(transaction);
+    if (++m_historyPos % HISTORY_CHECKPOINT == 0) {
+        m_checkpoints.append(current);
+    }
+    updateHistoryControls();
+    m_journal->appendAction(m_historyPos - 1, transaction);
+}
+
+void MainWindow::resetHistory()
+{
+    Checkpoint current;
+    for (int cell = 0; cell < 81; cell++) {
+        current.states[cell] = cellState(cell);
+    }
+    m_history.clear();
+    m_checkpoints.clear();
+    m_checkpoints.append(current);
+    m_historyPos = 0;
+    updateHistoryControls();
+    saveSession();
+}
+
+void MainWindow::saveSession()
+{
+    SessionState session;
+    std::copy(m_checkpoints[0].states, m_checkpoints[0].states + 81, session.base);
+    session.history = m_history;
+    session.position = m_historyPos;
+    m_journal->reset(session);
+}
+
+void MainWindow::captureBranch()
+{
+    Branch& branch = m_branches[m_branch];
+    for (int cell = 0; cell < 81; cell++) {
+        branch.board.setState(cell, cellState(cell));
+    }
+    branch.history = m_history;
+    branch.checkpoints = m_checkpoints;
+    branch.position = m_historyPos;
+}
+
+void MainWindow::forkBranch()
+{
+    if (m_panel->isVisible()) {
+        return;
+    }
+
+    // 复制只增加引用计数，两个分支中的一个修改时才复制被改的行和历史
+    captureBranch();
+    Branch branch = m_branches[m_branch];
+    branch.name = QString("Branch %1").arg(m_branches.size() + 1);
+    m_branches.append(branch);
+    m_branch = m_branches.size() - 1;
+    m_branchBox->addItem(branch.name);
+    m_branchBox->setCurrentIndex(m_branch);
+    showStatus(QString("Playing on %1").arg(branch.name));
+}
+
+void MainWindow::switchBranch(int index)
+{
+    if (index == m_branch || index < 0 || index >= m_branches.size()) {
+        return;
+    }
+    if (m_panel->isVisible()) {
+        m_branchBox->setCurrentIndex(m_branch);
+        return;
+    }
+
+    captureBranch();
+    const BoardSnapshot& from = m_branches[m_branch].board;
+    const Branch& to = m_branches[index];
+
+    // 共享的行一定相同，只比较分叉后被修改过的行
+    QVector<int> cells;
+    bool givensChanged = false;
+    for (int row = 0; row < 9; row++) {
+        if (to.board.sharesRow(from, row)) {
+            continue;
+        }
+        for (int cell = row * 9; cell < row * 9 + 9; cell++) {
+            quint32 before = from.state(cell);
+            quint32 after = to.board.state(cell);
+            if (before != after) {
+                cells.append(cell);
+                givensChanged |= ((before | after) & STATE_GIVEN) != 0;
+            }
+        }
+    }
+
+    if (givensChanged) {
+        quint32 target[81];
+        for (int cell = 0; cell < 81; cell++) {
+            target[cell] = to.board.state(cell);
+        }
+        applyStates(target);
+    } else {
+        // 只有这些格子的控件会重绘
+        for (int cell : cells) {
+            applyCellState(cell, to.board.state(cell));
+        }
+    }
+
+    m_branch = index;
+    m_history = to.history;
+    m_checkpoints = to.checkpoints;
+    m_historyPos = to.position;
+    updateHistoryControls();
+    saveSession();
+    showStatus(QString("Playing on %1").arg(to.name));
+}
+
+void MainWindow::restoreSession(const SessionState& session)
+{
+    // 从开头重放一遍，每隔HISTORY_CHECKPOINT步存一份盘面
+    Checkpoint checkpoint;
+    std::copy(session.base, session.base + 81, checkpoint.states);
+    m_history = session.history;
+    m_checkpoints.clear();
+    m_checkpoints.append(checkpoint);
+    for (int i = 0; i < m_history.size(); i++) {
+        replayHistory(checkpoint.states, i, i + 1);
+        if ((i + 1) % HISTORY_CHECKPOINT == 0) {
+            m_checkpoints.append(checkpoint);
+        }
+    }
+
+    int from = session.position / HISTORY_CHECKPOINT * HISTORY_CHECKPOINT;
+    const quint32* start = m_checkpoints[from / HISTORY_CHECKPOINT].states;
+    quint32 target[81];
+    std::copy(start, start + 81, target);
+    replayHistory(target, from, session.position);
+    applyStates(target);
+
+    m_historyPos = session.position;
+    updateHistoryControls();
+}
+
+void MainWindow::updateHistoryControls()
+{
+    m_undoButton->setEnabled(m_historyPos > 0);
+    m_redoButton->setEnabled(m_historyPos < m_history.size());
+
+    // 设置范围和位置不能再触发跳转
+    m_timeline->blockSignals(true);
+    m_timeline->setRange(0, m_history.size());
+    m_timeline->setValue(m_historyPos);
+    m_timeline->blockSignals(false);
+}
+
+void MainWindow::replayHistory(quint32* states, int from, int to) const
+{
+    for (int i = from; i < to; i++) {
+        for (quint32 change : m_history[i].changes) {
+            states[changeCell(change)] = changeState(change, true);
+        }
+    }
+    for (int i = from - 1; i >= to; i--) {
+        for (quint32 change : m_history[i].changes) {
+            states[changeCell(change)] = changeState(change, false);
+        }
+    }
+}
+
+quint32 MainWindow::cellState(int cell) const
+{
+    int value = m_board.value(cell);
+    quint32 state = value ? quint32(value) | STATE_FILLED : quint32(manualMarks(cell));
+    if (m_board.isGiven(cell)) {
+        state |= STATE_GIVEN;
+    }
+    return state;
+}
+
+int MainWindow::manualMarks(int cell) const
+{
+    return m_autoMarks ? m_manualMarks[cell] : m_grids[cell / 9][cell % 9]->multiValue();
+}
 
-    m_redoButton->setEnabled(true);
-    m_undoButton->setEnabled(m_undoOps.size() > 0);
+void MainWindow::setManualMarks(int cell, int marks)
+{
+    if (m_autoMarks) {
+        m_manualMarks[cell] = marks;
+    } else {
+        m_grids[cell / 9][cell % 9]->setMultiValue(marks);
+    }
+}
+
+void MainWindow::applyTransaction(const Transaction& transaction, bool forward)
+{
+    quint32 target[81];
+    for (int cell = 0; cell < 81; cell++) {
+        target[cell] = cellState(cell);
+    }
+    for (quint32 change : transaction.changes) {
+        target[changeCell(change)] = changeState(change, forward);
+    }
+    applyStates(target);
+}
+
+void MainWindow::applyStates(const quint32* target)
+{
+    // 修改完所有格子后整个窗口只重绘一次
+    setUpdatesEnabled(false);
+
+    bool givensChanged = false;
+    for (int cell = 0; cell < 81; cell++) {
+        quint32 state = cellState(cell);
+        givensChanged |= ((state | target[cell]) & STATE_GIVEN) && state != target[cell];
+    }
+
+    // 谜面变了说明跨过了换谜题的操作，先载入目标的谜面
+    if (givensChanged) {
+        uint8_t clues[81];
+        for (int cell = 0; cell < 81; cell++) {
+            clues[cell] = (target[cell] & STATE_GIVEN) ? uint8_t(target[cell] & 0xf) : 0;
+        }
+        setPuzzle(clues);
+    }
+
+    for (int cell = 0; cell < 81; cell++) {
+        applyCellState(cell, target[cell]);
+    }
+
+    setUpdatesEnabled(true);
+}
+
+void MainWindow::applyCellState(int cell, quint32 state)
+{
+    if (state & STATE_GIVEN) {
+        return;
+    }
+    int value = (state & STATE_FILLED) ? int(state & 0xf) : 0;
+    if (value != m_board.value(cell)) {
+        changeNumber(cell / 9, cell % 9, value);
+    }
+    if (!value && manualMarks(cell) != int(state & 0x1ff)) {
+        setManualMarks(cell, int(state & 0x1ff));
+    }
 }
@@ -0,0 +1,211 @@
+﻿#include "puzzlepool.h"
+
+#include "generator.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSaveFile>
+
+#include <climits>
+
+namespace {
+
+const quint32 POOL_MAGIC = 0x53504f4c; // "SPOL"
+const quint16 POOL_VERSION = 1;
+
+// 各难度生成时保留的线索数下限，线索多的谜题更可能落在简单的难度
+const int MIN_CLUES[DIFFICULTY_COUNT] = { 36, 30, 26, 0 };
+
+// 连续这么多道谜题都放不进池子时暂停一会儿，避免某个难度迟迟生成不出来时空转
+const int MAX_MISSES = 64;
+
+}
+
+PuzzlePool::PuzzlePool(const QString& path, int capacity, int watermark, QObject* parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_capacity(capacity)
+    , m_watermark(watermark)
+    , m_thread(nullptr)
+    , m_stopping(false)
+{
+    for (Ring& ring : m_rings) {
+        ring.entries.resize(capacity);
+    }
+    if (!m_path.isEmpty()) {
+        load();
+    }
+}
+
+PuzzlePool::~PuzzlePool()
+{
+    if (m_thread) {
+        m_mutex.lock();
+        m_stopping = true;
+        m_wake.wakeAll();
+        m_mutex.unlock();
+        m_thread->wait();
+        delete m_thread;
+    }
+    if (!m_path.isEmpty()) {
+        save();
+    }
+}
+
+void PuzzlePool::start()
+{
+    if (m_thread) {
+        return;
+    }
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->start(QThread::LowestPriority);
+}
+
+bool PuzzlePool::take(Difficulty level, PoolEntry& entry)
+{
+    QMutexLocker locker(&m_mutex);
+    Ring& ring = m_rings[level];
+    if (ring.count == 0) {
+        return false;
+    }
+    entry = ring.entries[ring.head];
+    ring.head = (ring.head + 1) % m_capacity;
+    --ring.count;
+    if (ring.count < m_watermark) {
+        m_wake.wakeAll();
+    }
+    return true;
+}
+
+int PuzzlePool::size(Difficulty level) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_rings[level].count;
+}
+
+int PuzzlePool::minClues(Difficulty level)
+{
+    return MIN_CLUES[level];
+}
+
+void PuzzlePool::run()
+{
+    Generator generator(QRandomGenerator::global()->generate());
+    Rater rater;
+    int misses = 0;
+
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopping) {
+        if (!needsRefill() || misses >= MAX_MISSES) {
+            misses = 0;
+            m_wake.wait(&m_mutex, needsRefill() ? 1000 : ULONG_MAX);
+            continue;
+        }
+
+        // 补到所有难度都满为止，每次按最缺的难度决定保留多少线索
+        while (!m_stopping && !isFull() && misses < MAX_MISSES) {
+            int target = 0;
+            for (int level = 1; level < DIFFICULTY_COUNT; level++) {
+                if (m_rings[level].count < m_rings[target].count) {
+                    target = level;
+                }
+            }
+            locker.unlock();
+
+            PoolEntry entry;
+            generator.generate(entry.puzzle, entry.solution, MIN_CLUES[target]);
+            rater.load(entry.puzzle);
+            entry.score = float(rater.rate().score);
+
+            locker.relock();
+            misses = push(entry) ? 0 : misses + 1;
+        }
+    }
+}
+
+bool PuzzlePool::push(const PoolEntry& entry)
+{
+    Ring& ring = m_rings[Rater::difficultyOf(entry.score)];
+    if (ring.count == m_capacity) {
+        return false;
+    }
+    ring.entries[(ring.head + ring.count) % m_capacity] = entry;
+    ++ring.count;
+    return true;
+}
+
+bool PuzzlePool::needsRefill() const
+{
+    for (const Ring& ring : m_rings) {
+        if (ring.count < m_watermark) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PuzzlePool::isFull() const
+{
+    for (const Ring& ring : m_rings) {
+        if (ring.count < m_capacity) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PuzzlePool::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic;
+    quint16 version;
+    in >> magic >> version;
+    if (magic != POOL_MAGIC || version != POOL_VERSION) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (int level = 0; level < DIFFICULTY_COUNT; level++) {
+        quint32 count;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+            PoolEntry entry;
+            in.readRawData(reinterpret_cast<char*>(entry.puzzle), 81);
+            in.readRawData(reinterpret_cast<char*>(entry.solution), 81);
+            in >> entry.score;
+            if (in.status() == QDataStream::Ok && Rater::difficultyOf(entry.score) == level) {
+                push(entry);
+            }
+        }
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+bool PuzzlePool::save() const
+{
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << POOL_MAGIC << POOL_VERSION;
+
+    QMutexLocker locker(&m_mutex);
+    for (const Ring& ring : m_rings) {
+        out << quint32(ring.count);
+        for (int i = 0; i < ring.count; i++) {
+            const PoolEntry& entry = ring.entries[(ring.head + i) % m_capacity];
+            out.writeRawData(reinterpret_cast<const char*>(entry.puzzle), 81);
+            out.writeRawData(reinterpret_cast<const char*>(entry.solution), 81);
+            out << entry.score;
+        }
+    }
+    return file.commit();
+}
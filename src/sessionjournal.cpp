@@ -0,0 +1,361 @@
+﻿#include "sessionjournal.h"
+
+#include <QDeadlineTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const quint32 SNAPSHOT_MAGIC = 0x53534e50; // "SSNP"
+const quint32 JOURNAL_MAGIC = 0x534a524e;  // "SJRN"
+const quint16 SESSION_VERSION = 1;
+
+// 日志记录的类型
+const int RECORD_ACTION = 1; // 新的操作，position是操作之前的位置
+const int RECORD_MOVE = 2;   // 撤销、重做或跳转，position是之后的位置
+
+// 快照之后累积这么多条记录时合并成新的快照
+const int JOURNAL_COMPACT_RECORDS = 1024;
+
+// 收到记录后等这么久再写，期间的记录合成一批，只同步一次
+const int JOURNAL_BATCH_DELAY = 100;
+
+template <typename T>
+void put(QByteArray& out, T value)
+{
+    uchar bytes[sizeof(T)];
+    qToLittleEndian(value, bytes);
+    out.append(reinterpret_cast<const char*>(bytes), int(sizeof(T)));
+}
+
+/**
+ * @brief 从映射的内存中按小端序读取，越界后ok为false，之后读到的都是0
+ */
+struct Reader
+{
+    const uchar* p;
+    const uchar* end;
+    bool ok = true;
+
+    template <typename T>
+    T read()
+    {
+        if (!ok || end - p < qptrdiff(sizeof(T))) {
+            ok = false;
+            return 0;
+        }
+        T value = qFromLittleEndian<T>(p);
+        p += sizeof(T);
+        return value;
+    }
+};
+
+// 格子编号在低7位，见mainwindow.cpp
+bool validChanges(const QVector<quint32>& changes)
+{
+    for (quint32 change : changes) {
+        if ((change & 0x7f) >= 81) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray header(quint32 magic, quint32 generation)
+{
+    QByteArray data;
+    put(data, magic);
+    put(data, SESSION_VERSION);
+    put(data, generation);
+    return data;
+}
+
+bool readHeader(Reader& in, quint32 magic, quint32& generation)
+{
+    bool match = in.read<quint32>() == magic && in.read<quint16>() == SESSION_VERSION;
+    generation = in.read<quint32>();
+    return match && in.ok;
+}
+
+/**
+ * @brief 清空日志，只留下文件头
+ */
+bool resetJournal(QFile& journal, quint32 generation)
+{
+    if (!journal.isOpen() && !journal.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    QByteArray data = header(JOURNAL_MAGIC, generation);
+    return journal.resize(0) && journal.seek(0) && journal.write(data) == data.size();
+}
+
+void syncFile(QFile& file)
+{
+    file.flush();
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    ::fsync(file.handle());
+#endif
+}
+
+}
+
+SessionJournal::SessionJournal(const QString& path, QObject* parent)
+    : QObject(parent)
+    , m_snapshotPath(path + ".snap")
+    , m_journalPath(path + ".log")
+    , m_ready(false)
+    , m_records(0)
+    , m_generation(0)
+    , m_journalGeneration(0)
+    , m_validLength(0)
+    , m_thread(nullptr)
+    , m_stopping(false)
+{
+}
+
+SessionJournal::~SessionJournal()
+{
+    if (m_thread) {
+        m_mutex.lock();
+        m_stopping = true;
+        m_wake.wakeAll();
+        m_mutex.unlock();
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+bool SessionJournal::restore(SessionState& state)
+{
+    QFile snapshot(m_snapshotPath);
+    if (!snapshot.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const uchar* data = snapshot.map(0, snapshot.size());
+    if (!data) {
+        return false;
+    }
+
+    Reader in { data, data + snapshot.size() };
+    quint32 generation;
+    if (!readHeader(in, SNAPSHOT_MAGIC, generation)) {
+        return false;
+    }
+    SessionState restored;
+    for (quint32& cell : restored.base) {
+        cell = in.read<quint32>();
+    }
+    quint32 count = in.read<quint32>();
+    quint32 position = in.read<quint32>();
+    // 每条操作至少占一个字节，count更大时文件一定损坏了
+    if (!in.ok || position > count || count > quint32(in.end - in.p)) {
+        return false;
+    }
+    restored.history.resize(int(count));
+    for (Transaction& transaction : restored.history) {
+        transaction.changes.resize(in.read<quint8>());
+        for (quint32& change : transaction.changes) {
+            change = in.read<quint32>();
+        }
+        if (!in.ok || transaction.changes.isEmpty() || !validChanges(transaction.changes)) {
+            return false;
+        }
+    }
+    restored.position = int(position);
+
+    m_state = restored;
+    m_generation = m_journalGeneration = generation;
+    m_validLength = 0;
+    m_records = 0;
+    m_ready = true;
+
+    // 只重放代号相同的日志，到第一条不完整或校验不通过的记录为止
+    QFile journal(m_journalPath);
+    const uchar* log = journal.open(QIODevice::ReadOnly) ? journal.map(0, journal.size()) : nullptr;
+    if (log) {
+        Reader tail { log, log + journal.size() };
+        quint32 journalGeneration;
+        if (readHeader(tail, JOURNAL_MAGIC, journalGeneration) && journalGeneration == generation) {
+            m_validLength = tail.p - log;
+            for (;;) {
+                const uchar* start = tail.p;
+                int type = tail.read<quint8>();
+                QVector<quint32> changes(tail.read<quint8>());
+                int position = int(tail.read<quint32>());
+                for (quint32& change : changes) {
+                    change = tail.read<quint32>();
+                }
+                quint16 checksum = tail.read<quint16>();
+                if (!tail.ok || checksum != qChecksum(reinterpret_cast<const char*>(start), uint(tail.p - start - 2))
+                    || !apply(type, position, changes)) {
+                    break;
+                }
+                m_validLength = tail.p - log;
+                ++m_records;
+            }
+        }
+    }
+
+    state = m_state;
+    return true;
+}
+
+void SessionJournal::start()
+{
+    if (m_thread) {
+        return;
+    }
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->start(QThread::LowPriority);
+}
+
+void SessionJournal::reset(const SessionState& state)
+{
+    m_state = state;
+    m_ready = true;
+    compact();
+}
+
+void SessionJournal::appendAction(int position, const Transaction& transaction)
+{
+    appendRecord(RECORD_ACTION, position, transaction.changes);
+}
+
+void SessionJournal::appendMove(int position)
+{
+    appendRecord(RECORD_MOVE, position, QVector<quint32>());
+}
+
+void SessionJournal::run()
+{
+    QFile journal(m_journalPath);
+    bool writable = journal.open(QIODevice::ReadWrite);
+    if (writable && m_validLength > 0) {
+        // 截掉崩溃时写了一半的记录
+        writable = journal.resize(m_validLength) && journal.seek(m_validLength);
+    } else if (writable) {
+        writable = resetJournal(journal, m_journalGeneration);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+        if (m_pending.isEmpty()) {
+            if (m_stopping) {
+                break;
+            }
+            m_wake.wait(&m_mutex);
+            continue;
+        }
+
+        QDeadlineTimer deadline(JOURNAL_BATCH_DELAY);
+        while (!m_stopping && m_wake.wait(&m_mutex, deadline)) {
+        }
+        QVector<Pending> batch;
+        batch.swap(m_pending);
+        locker.unlock();
+
+        for (const Pending& pending : batch) {
+            if (pending.snapshot) {
+                // 快照写入失败时继续使用原来的快照和日志
+                QSaveFile file(m_snapshotPath);
+                if (file.open(QIODevice::WriteOnly) && file.write(pending.data) == pending.data.size()
+                    && file.commit()) {
+                    m_journalGeneration = pending.generation;
+                    writable = resetJournal(journal, m_journalGeneration);
+                }
+            } else if (writable) {
+                // 写入失败后不再追加，否则日志中间会缺少记录
+                writable = journal.write(pending.data) == pending.data.size();
+            }
+        }
+        if (writable) {
+            syncFile(journal);
+        }
+
+        locker.relock();
+    }
+}
+
+bool SessionJournal::apply(int type, int position, const QVector<quint32>& changes)
+{
+    if (position < 0 || position > m_state.history.size()) {
+        return false;
+    }
+    if (type == RECORD_ACTION) {
+        if (changes.isEmpty() || changes.size() > 81 || !validChanges(changes)) {
+            return false;
+        }
+        m_state.history.resize(position);
+        m_state.history.append(Transaction { changes });
+        m_state.position = position + 1;
+        return true;
+    }
+    if (type == RECORD_MOVE && changes.isEmpty()) {
+        m_state.position = position;
+        return true;
+    }
+    return false;
+}
+
+void SessionJournal::appendRecord(int type, int position, const QVector<quint32>& changes)
+{
+    // 副本和调用者不一致时停止记录，下次启动恢复到不一致之前
+    if (!m_ready || !apply(type, position, changes)) {
+        m_ready = false;
+        return;
+    }
+
+    QByteArray data;
+    put(data, quint8(type));
+    put(data, quint8(changes.size()));
+    put(data, quint32(position));
+    for (quint32 change : changes) {
+        put(data, change);
+    }
+    put(data, qChecksum(data.constData(), uint(data.size())));
+    enqueue(data, false);
+
+    if (++m_records >= JOURNAL_COMPACT_RECORDS) {
+        compact();
+    }
+}
+
+void SessionJournal::compact()
+{
+    ++m_generation;
+    m_records = 0;
+    enqueue(snapshotData(), true);
+}
+
+void SessionJournal::enqueue(const QByteArray& data, bool snapshot)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pending.append(Pending { data, snapshot, m_generation });
+    m_wake.wakeAll();
+}
+
+QByteArray SessionJournal::snapshotData() const
+{
+    QByteArray data = header(SNAPSHOT_MAGIC, m_generation);
+    for (quint32 cell : m_state.base) {
+        put(data, cell);
+    }
+    put(data, quint32(m_state.history.size()));
+    put(data, quint32(m_state.position));
+    for (const Transaction& transaction : m_state.history) {
+        put(data, quint8(transaction.changes.size()));
+        for (quint32 change : transaction.changes) {
+            put(data, change);
+        }
+    }
+    return data;
+}
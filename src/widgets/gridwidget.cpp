@@ -7,7 +7,7 @@
 const int duration = 200;
 
 GridWidget::GridWidget(int row, int col, int size, QWidget *parent)
-    : QWidget(parent), m_multiValue(0), m_value(0), m_numConflict(0)
+    : QWidget(parent), m_multiValue(0), m_value(0), m_numConflict(0), m_mistake(false)
 {   
     this->setUpdatesEnabled(false);
 
@@ -195,34 +195,24 @@ int GridWidget::value() const
     return m_value;
 }
 
-void GridWidget::changeConflict(int num)
+void GridWidget::setConflict(int num)
 {
-    /*
-    if (m_numConflict == 0 && num > 0)
+    if (m_numConflict != num)
     {
-        m_borderRadius = m_style.border_radius[1];
-        m_singleGrid->setStyleSheet(m_buttonStyle.arg(m_borderRadius, m_borderColor, m_fontColor));
+        m_numConflict = num;
+        setButtonStyle(false);
     }
-    else if (m_numConflict > 0 && m_numConflict + num == 0)
-    {
-        m_borderRadius = m_style.border_radius[0];
-        m_singleGrid->setStyleSheet(m_buttonStyle.arg(m_borderRadius, m_borderColor, m_fontColor));
-    }
-    */
-    m_numConflict += num;
-    setButtonStyle(false);
-
 }
 
-void GridWidget::clearConflict()
+void GridWidget::setMistake(bool mistake)
 {
-    m_numConflict = 0;
-    setButtonStyle(false);
-    //m_borderRadius = m_style.border_radius[1];
-    //m_singleGrid->setStyleSheet(m_buttonStyle.arg(m_borderRadius, m_borderColor, m_fontColor));
+    if (m_mistake != mistake)
+    {
+        m_mistake = mistake;
+        setButtonStyle(false);
+    }
 }
 
-
 void GridWidget::buttonClicked()
 {
     emit clicked();
@@ -282,9 +272,11 @@ void GridWidget::setButtonStyle(int entered)
         m_multiGrids[4]->setStyleSheet(QString("color:%1;").arg(entered ? "#FBFBBF": m_style.font_color[1]));
     }
 
-    // 只有isEnabled()为true时entered才会为1
-    m_singleGrid->setStyleSheet(QString("border:%1px solid %2;color:%3;")
-                                .arg(m_style.border_radius[m_numConflict == 0],
+    // 只有isEnabled()为true时entered才会为1；冲突画实线圆环，只是和答案不符时画虚线圆环
+    bool ring = m_numConflict != 0 || m_mistake;
+    m_singleGrid->setStyleSheet(QString("border:%1px %2 %3;color:%4;")
+                                .arg(m_style.border_radius[!ring],
+                                     m_numConflict == 0 && m_mistake ? "dashed" : "solid",
                                      m_style.border_color[m_button->isEnabled()],
                                      m_style.font_color[m_button->isEnabled() + entered]));
 
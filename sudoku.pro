@@ -1,54 +1,47 @@
 #-------------------------------------------------
 #
-# Project created by QtCreator 2019-11-27T14:06:51
+# Top-level project: the Qt-free engine library, the GUI app
+# and the command-line tools
 #
 #-------------------------------------------------
 
-QT       += core gui
+TEMPLATE = subdirs
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+SUBDIRS += \
+    core \
+    app \
+    solve \
+    corpus \
+    serve \
+    ringd \
+    bench \
+    modelcheck
 
-TARGET = sudoku
-TEMPLATE = app
+core.subdir = core
 
-# The following define makes your compiler emit warnings if you use
-# any feature of Qt which has been marked as deprecated (the exact warnings
-# depend on your compiler). Please consult the documentation of the
-# deprecated API in order to know how to port your code away from it.
-DEFINES += QT_DEPRECATED_WARNINGS
+app.file = app.pro
+app.depends = core
 
-# You can also make your code fail to compile if you use deprecated APIs.
-# In order to do so, uncomment the following line.
-# You can also select to disable deprecated APIs only up to a certain version of Qt.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+solve.subdir = tools/solve
+solve.depends = core
 
+corpus.subdir = tools/corpus
+corpus.depends = core
 
-INCLUDEPATH += \
-    include \
-    include/widgets
+serve.subdir = tools/serve
+serve.depends = core
 
-SOURCES += \
-        main.cpp \
-    src/mainwindow.cpp \
-    src/widgets/basewidget.cpp \
-    src/widgets/selectpanel.cpp \
-    src/widgets/gridwidget.cpp \
-    src/widgets/gridmarker.cpp \
-    src/widgets/counter.cpp
+ringd.subdir = tools/ringd
+ringd.depends = core
 
-HEADERS += \
-    include/sudokusolver.h \
-    include/mainwindow.h \
-    include/widgets/basewidget.h \
-    include/widgets/selectpanel.h \
-    include/widgets/gridwidget.h   \
-    include/widgets/gridmarker.h \
-    include/widgets/counter.h
+bench.subdir = tools/bench
+bench.depends = core
 
-FORMS += \
-    ui/mainwindow.ui
+modelcheck.subdir = tools/modelcheck
+modelcheck.depends = core
 
-CONFIG += C++11
-
-RESOURCES += \
-    resources/resources.qrc
+# Shared library exporting only the C interface
+sudoku_shared {
+    SUBDIRS += capi
+    capi.subdir = core/capi
+}
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# sudoku-bench: solver benchmark over the datasets in
+#               resources/bench, with regression checks
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = sudoku-bench
+
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+include(../../core/core.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,593 @@
+﻿/**
+ * @file main.cpp
+ * @brief sudoku-bench: solver benchmark over fixed datasets with regression checks
+ *
+ * Usage: sudoku-bench [--data dir] [--dataset name] [--backend name] [--count n]
+ *                     [--repeat n] [--save file] [--compare file] [--threshold pct]
+ *
+ * The datasets live in resources/bench, one puzzle per line:
+ *
+ *     easy           generated, rated easy, 30 clues
+ *     hard           generated, rated expert or beyond the rater's techniques
+ *     17clue         puzzles with the minimum number of clues
+ *     pathological   well-known hard puzzles and the generated puzzles that took
+ *                    the solver the most nodes to prove unique
+ *
+ * Each dataset is expanded to --count puzzles by applying seeded symmetry
+ * transformations (digit relabelling, row/column permutations inside bands
+ * and stacks, band/stack permutations and transposition) to its puzzles in
+ * turn, so every run solves exactly the same puzzles while the cell order the
+ * solver sees still varies. Every backend runs each dataset --repeat times and
+ * the best value of each metric over the runs is reported: puzzles/s,
+ * ns/puzzle percentiles, nodes/puzzle and heap allocations/puzzle. --save writes the results; --compare reads
+ * saved results and exits with 1 when throughput, p50, p99, nodes or
+ * allocations got worse than the threshold.
+ */
+
+#include "puzzleparser.h"
+#include "solvemetrics.h"
+#include "sudoku_c.h"
+#include "sudokusolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<unsigned long long> allocations(0);
+
+}
+
+// 统计整个程序的堆分配次数
+void *operator new(std::size_t size)
+{
+    ++allocations;
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+const char *const DATASETS[] = { "easy", "hard", "17clue", "pathological" };
+
+const char RESULTS_MAGIC[] = "# sudoku-bench results 1";
+
+/**
+ * @brief 被测的求解方式，以后的求解后端也从这里接入
+ */
+class Backend
+{
+public:
+    virtual ~Backend()
+    {
+    }
+
+    virtual const char *name() const = 0;
+
+    /**
+     * @return 解的个数
+     */
+    virtual int solve(const uint8_t *puzzle, uint8_t *solution) = 0;
+
+    /**
+     * @brief 上一次求解的搜索节点数，不可知时返回-1
+     */
+    virtual long long nodes() const = 0;
+};
+
+/**
+ * @brief 复用同一个SudokuSolver，limit为2时即检验唯一解
+ */
+class SolverBackend : public Backend
+{
+public:
+    SolverBackend(const char *name, int limit)
+        : m_name(name)
+        , m_limit(limit)
+    {
+    }
+
+    const char *name() const override
+    {
+        return m_name;
+    }
+
+    int solve(const uint8_t *puzzle, uint8_t *solution) override
+    {
+        return m_solver.solve(puzzle, solution, m_limit);
+    }
+
+    long long nodes() const override
+    {
+        return (long long)m_solver.nodes();
+    }
+
+private:
+    const char *m_name;
+    int m_limit;
+    SudokuSolver m_solver;
+};
+
+/**
+ * @brief 稳定的C接口，每次调用构造一个求解器
+ */
+class CApiBackend : public Backend
+{
+public:
+    const char *name() const override
+    {
+        return "c-api";
+    }
+
+    int solve(const uint8_t *puzzle, uint8_t *solution) override
+    {
+        return sudoku_solve(puzzle, solution) == SUDOKU_SOLVED ? 1 : 0;
+    }
+
+    long long nodes() const override
+    {
+        return -1;
+    }
+};
+
+/**
+ * @brief 一个后端在一个数据集上的结果
+ */
+struct Result
+{
+    double puzzlesPerSecond;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+    double nodes;       // 每道题的平均节点数，不可知时为-1
+    double allocations; // 每道题的平均堆分配次数
+    size_t unsolved;
+};
+
+/**
+ * @brief 不依赖标准库实现的随机数，各平台上生成的数据集相同
+ */
+int randomBelow(std::mt19937 &rng, int n)
+{
+    return int(rng() % uint32_t(n));
+}
+
+void shuffle(std::mt19937 &rng, int *values, int count)
+{
+    for (int i = count - 1; i > 0; i--)
+    {
+        std::swap(values[i], values[randomBelow(rng, i + 1)]);
+    }
+}
+
+/**
+ * @brief 随机的等价变换：行列和数字的置换以及转置，不改变解的个数和线索数
+ */
+void transform(std::mt19937 &rng, const uint8_t *in, uint8_t *out)
+{
+    int digits[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    shuffle(rng, digits + 1, 9);
+
+    int rows[9];
+    int columns[9];
+    int bands[3] = { 0, 1, 2 };
+    int stacks[3] = { 0, 1, 2 };
+    shuffle(rng, bands, 3);
+    shuffle(rng, stacks, 3);
+    for (int b = 0; b < 3; b++)
+    {
+        int inner[3] = { 0, 1, 2 };
+        shuffle(rng, inner, 3);
+        for (int k = 0; k < 3; k++)
+        {
+            rows[b * 3 + k] = bands[b] * 3 + inner[k];
+        }
+        shuffle(rng, inner, 3);
+        for (int k = 0; k < 3; k++)
+        {
+            columns[b * 3 + k] = stacks[b] * 3 + inner[k];
+        }
+    }
+    bool transpose = randomBelow(rng, 2) == 1;
+
+    for (int r = 0; r < 9; r++)
+    {
+        for (int c = 0; c < 9; c++)
+        {
+            int source = transpose ? columns[c] * 9 + rows[r] : rows[r] * 9 + columns[c];
+            out[r * 9 + c] = uint8_t(digits[in[source]]);
+        }
+    }
+}
+
+/**
+ * @brief 读入数据集并用固定种子扩展到count道
+ */
+bool loadDataset(const std::string &path, size_t count, std::vector<uint8_t> &puzzles)
+{
+    PuzzleReader reader;
+    if (!reader.open(path))
+    {
+        std::fprintf(stderr, "%s\n", reader.errorString().c_str());
+        return false;
+    }
+    std::vector<uint8_t> seeds;
+    uint8_t puzzle[81];
+    while (reader.read(puzzle, 1) == 1)
+    {
+        seeds.insert(seeds.end(), puzzle, puzzle + 81);
+    }
+    size_t seedCount = seeds.size() / 81;
+    if (seedCount == 0)
+    {
+        std::fprintf(stderr, "%s has no puzzles\n", path.c_str());
+        return false;
+    }
+
+    // 原题先各出现一次，之后是它们的变换
+    std::mt19937 rng(20191127);
+    puzzles.resize(count * 81);
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t *seed = &seeds[(i % seedCount) * 81];
+        if (i < seedCount)
+        {
+            std::memcpy(&puzzles[i * 81], seed, 81);
+        }
+        else
+        {
+            transform(rng, seed, &puzzles[i * 81]);
+        }
+    }
+    return true;
+}
+
+Result run(Backend &backend, const std::vector<uint8_t> &puzzles, int repeat)
+{
+    size_t count = puzzles.size() / 81;
+    uint8_t solution[81];
+    LatencyHistogram histogram;
+    Result best;
+    best.puzzlesPerSecond = -1;
+
+    // 预热一遍，让代码和数据进入缓存
+    for (size_t i = 0; i < count && i < 256; i++)
+    {
+        backend.solve(&puzzles[i * 81], solution);
+    }
+
+    for (int r = 0; r < repeat; r++)
+    {
+        histogram.reset();
+        unsigned long long nodes = 0;
+        bool nodesKnown = true;
+        size_t unsolved = 0;
+        unsigned long long allocationsBefore = allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            int found = backend.solve(&puzzles[i * 81], solution);
+            auto end = std::chrono::steady_clock::now();
+            histogram.record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+            long long n = backend.nodes();
+            nodesKnown = nodesKnown && n >= 0;
+            nodes += n > 0 ? (unsigned long long)n : 0;
+            unsolved += found > 0 ? 0 : 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double throughput = seconds > 0 ? double(count) / seconds : 0.0;
+        // 每项指标分别取各次运行中最好的值，减少其他进程带来的噪声
+        bool first = r == 0;
+        best.puzzlesPerSecond = std::max(best.puzzlesPerSecond, throughput);
+        best.p50 = first ? histogram.percentile(0.50) : std::min(best.p50, histogram.percentile(0.50));
+        best.p90 = first ? histogram.percentile(0.90) : std::min(best.p90, histogram.percentile(0.90));
+        best.p99 = first ? histogram.percentile(0.99) : std::min(best.p99, histogram.percentile(0.99));
+        best.p999 = first ? histogram.percentile(0.999) : std::min(best.p999, histogram.percentile(0.999));
+        best.max = first ? histogram.max() : std::min(best.max, histogram.max());
+        best.nodes = nodesKnown ? double(nodes) / double(count) : -1.0;
+        best.allocations = double(allocations - allocationsBefore) / double(count);
+        best.unsolved = unsolved;
+    }
+    return best;
+}
+
+/**
+ * @brief 结果文件中的一行：数据集、后端、指标名和值
+ */
+std::string resultKey(const std::string &dataset, const std::string &backend, const char *metric)
+{
+    return dataset + " " + backend + " " + metric;
+}
+
+void addResults(std::map<std::string, double> &values, const std::string &dataset, const std::string &backend,
+                const Result &result)
+{
+    values[resultKey(dataset, backend, "puzzles_per_s")] = result.puzzlesPerSecond;
+    values[resultKey(dataset, backend, "p50_ns")] = double(result.p50);
+    values[resultKey(dataset, backend, "p90_ns")] = double(result.p90);
+    values[resultKey(dataset, backend, "p99_ns")] = double(result.p99);
+    values[resultKey(dataset, backend, "p999_ns")] = double(result.p999);
+    values[resultKey(dataset, backend, "max_ns")] = double(result.max);
+    if (result.nodes >= 0)
+    {
+        values[resultKey(dataset, backend, "nodes_per_puzzle")] = result.nodes;
+    }
+    values[resultKey(dataset, backend, "allocs_per_puzzle")] = result.allocations;
+}
+
+bool saveResults(const std::string &path, const std::map<std::string, double> &values)
+{
+    FILE *file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+    std::fprintf(file, "%s\n", RESULTS_MAGIC);
+    for (const auto &value : values)
+    {
+        std::fprintf(file, "%s %.6g\n", value.first.c_str(), value.second);
+    }
+    return std::fclose(file) == 0;
+}
+
+bool loadResults(const std::string &path, std::map<std::string, double> &values)
+{
+    FILE *file = std::fopen(path.c_str(), "r");
+    if (!file)
+    {
+        return false;
+    }
+    char line[256];
+    bool ok = std::fgets(line, sizeof(line), file) && std::strncmp(line, RESULTS_MAGIC, sizeof(RESULTS_MAGIC) - 1) == 0;
+    char dataset[64];
+    char backend[64];
+    char metric[64];
+    double value;
+    while (ok && std::fgets(line, sizeof(line), file))
+    {
+        if (std::sscanf(line, "%63s %63s %63s %lf", dataset, backend, metric, &value) == 4)
+        {
+            values[resultKey(dataset, backend, metric)] = value;
+        }
+    }
+    std::fclose(file);
+    return ok;
+}
+
+/**
+ * @brief 与基线比较，打印变化超过阈值的指标
+ * @return 是否有指标退步
+ */
+bool compareResults(const std::map<std::string, double> &baseline, const std::map<std::string, double> &current,
+                    double threshold)
+{
+    // 参与判定的指标，其余的噪声太大，只打印不判定
+    const struct
+    {
+        const char *metric;
+        bool higherIsBetter;
+    } gated[] = {
+        { "puzzles_per_s", true }, { "p50_ns", false }, { "p99_ns", false },
+        { "nodes_per_puzzle", false }, { "allocs_per_puzzle", false },
+    };
+
+    bool regressed = false;
+    std::printf("\n%-44s %12s %12s %8s\n", "compared to baseline", "baseline", "current", "change");
+    for (const auto &value : current)
+    {
+        auto base = baseline.find(value.first);
+        if (base == baseline.end())
+        {
+            continue;
+        }
+        std::string metric = value.first.substr(value.first.rfind(' ') + 1);
+        double before = base->second;
+        double after = value.second;
+        double change = before != 0 ? (after - before) / before : (after != 0 ? 1.0 : 0.0);
+
+        const char *verdict = "";
+        for (const auto &gate : gated)
+        {
+            if (metric == gate.metric)
+            {
+                double worse = gate.higherIsBetter ? -change : change;
+                if (worse > threshold)
+                {
+                    verdict = "  REGRESSION";
+                    regressed = true;
+                }
+                else if (worse < -threshold)
+                {
+                    verdict = "  improved";
+                }
+            }
+        }
+        std::printf("%-44s %12.6g %12.6g %+7.1f%%%s\n", value.first.c_str(), before, after, change * 100, verdict);
+    }
+    return regressed;
+}
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: sudoku-bench [--data dir] [--dataset name] [--backend name] [--count n]\n"
+                 "                    [--repeat n] [--save file] [--compare file] [--threshold pct]\n"
+                 "  Benchmarks the solver backends on the datasets in resources/bench.\n"
+                 "  --data dir       dataset directory (default resources/bench)\n"
+                 "  --dataset name   easy, hard, 17clue or pathological (default all)\n"
+                 "  --backend name   solve, unique or c-api (default all)\n"
+                 "  --count n        puzzles per dataset, expanded by symmetry (default 20000)\n"
+                 "  --repeat n       runs per dataset, the best of each metric is reported\n"
+                 "                   (default 3)\n"
+                 "  --save file      write the results for a later --compare\n"
+                 "  --compare file   compare with saved results; exit 1 on a regression\n"
+                 "  --threshold pct  allowed regression in percent (default 10)\n");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::string dataDir = "resources/bench";
+    std::string onlyDataset;
+    std::string onlyBackend;
+    size_t count = 20000;
+    int repeat = 3;
+    std::string savePath;
+    std::string comparePath;
+    double threshold = 10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc)
+        {
+            dataDir = argv[++i];
+        }
+        else if (arg == "--dataset" && i + 1 < argc)
+        {
+            onlyDataset = argv[++i];
+        }
+        else if (arg == "--backend" && i + 1 < argc)
+        {
+            onlyBackend = argv[++i];
+        }
+        else if (arg == "--count" && i + 1 < argc)
+        {
+            count = size_t(std::max(1L, std::atol(argv[++i])));
+        }
+        else if (arg == "--repeat" && i + 1 < argc)
+        {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--save" && i + 1 < argc)
+        {
+            savePath = argv[++i];
+        }
+        else if (arg == "--compare" && i + 1 < argc)
+        {
+            comparePath = argv[++i];
+        }
+        else if (arg == "--threshold" && i + 1 < argc)
+        {
+            threshold = std::atof(argv[++i]);
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!comparePath.empty() && !loadResults(comparePath, baseline))
+    {
+        std::fprintf(stderr, "cannot read results from %s\n", comparePath.c_str());
+        return 1;
+    }
+
+    SolverBackend solve("solve", 1);
+    SolverBackend unique("unique", 2);
+    CApiBackend capi;
+    Backend *const backends[] = { &solve, &unique, &capi };
+
+    std::map<std::string, double> values;
+    std::printf("%-13s %-7s %12s %9s %9s %9s %9s %10s %9s %8s\n", "dataset", "backend", "puzzles/s", "p50 ns",
+                "p90 ns", "p99 ns", "p99.9 ns", "max ns", "nodes", "allocs");
+    for (const char *dataset : DATASETS)
+    {
+        if (!onlyDataset.empty() && onlyDataset != dataset)
+        {
+            continue;
+        }
+        std::vector<uint8_t> puzzles;
+        if (!loadDataset(dataDir + "/" + dataset + ".txt", count, puzzles))
+        {
+            return 1;
+        }
+        for (Backend *backend : backends)
+        {
+            if (!onlyBackend.empty() && onlyBackend != backend->name())
+            {
+                continue;
+            }
+            Result result = run(*backend, puzzles, repeat);
+            char nodes[32] = "-";
+            if (result.nodes >= 0)
+            {
+                std::snprintf(nodes, sizeof(nodes), "%.1f", result.nodes);
+            }
+            std::printf("%-13s %-7s %12.0f %9llu %9llu %9llu %9llu %10llu %9s %8.2f\n", dataset, backend->name(),
+                        result.puzzlesPerSecond, (unsigned long long)result.p50, (unsigned long long)result.p90,
+                        (unsigned long long)result.p99, (unsigned long long)result.p999,
+                        (unsigned long long)result.max, nodes, result.allocations);
+            if (result.unsolved > 0)
+            {
+                std::fprintf(stderr, "%s/%s: %zu puzzles not solved\n", dataset, backend->name(), result.unsolved);
+            }
+            addResults(values, dataset, backend->name(), result);
+        }
+    }
+    if (values.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    if (!savePath.empty() && !saveResults(savePath, values))
+    {
+        std::fprintf(stderr, "cannot write %s\n", savePath.c_str());
+        return 1;
+    }
+    if (!comparePath.empty() && compareResults(baseline, values, threshold / 100))
+    {
+        std::printf("\nregression beyond %.1f%% against %s\n", threshold, comparePath.c_str());
+        return 1;
+    }
+    return 0;
+}
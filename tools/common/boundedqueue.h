@@ -0,0 +1,213 @@
+﻿/**
+ * @file boundedqueue.h
+ * @brief Bounded lock-free multi-producer multi-consumer queue
+ */
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The BoundedQueue class 有界的无锁多生产者多消费者队列
+ * @details 环形数组的每个槽位带一个序号，生产者和消费者各自用CAS推进位置，
+ * 槽位的序号表明它当前可写还是可读（Vyukov的有界MPMC队列）。
+ * 队列满时push等待，下游慢时上游自然被拖慢；所有生产者都调用done()之后，
+ * 队列读空时pop返回false
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    /**
+     * @param capacity 容量，向上取整为2的幂
+     * @param producers 生产者个数
+     */
+    BoundedQueue(size_t capacity, int producers)
+        : m_producers(producers)
+        , m_head(0)
+        , m_tail(0)
+        , m_pushWaits(0)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        m_mask = size - 1;
+        m_slots = std::vector<Slot>(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(T &item)
+    {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = m_slots[pos & m_mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == pos)
+            {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(item);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos)
+            {
+                return false; // 满
+            }
+            else
+            {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T &item)
+    {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = m_slots[pos & m_mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == pos + 1)
+            {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    item = std::move(slot.value);
+                    slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos + 1)
+            {
+                return false; // 空
+            }
+            else
+            {
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief 放入一项，队列满时等待
+     */
+    void push(T item)
+    {
+        for (int spins = 0; !tryPush(item); spins++)
+        {
+            if (spins == 0)
+            {
+                m_pushWaits.fetch_add(1, std::memory_order_relaxed);
+            }
+            backoff(spins);
+        }
+    }
+
+    /**
+     * @brief 取出一项，队列为空时等待
+     * @return 所有生产者都已结束且队列为空时返回false
+     */
+    bool pop(T &item)
+    {
+        for (int spins = 0;; spins++)
+        {
+            if (tryPop(item))
+            {
+                return true;
+            }
+            if (m_producers.load(std::memory_order_acquire) == 0)
+            {
+                // 最后一个生产者结束前放入的项已经可见
+                return tryPop(item);
+            }
+            backoff(spins);
+        }
+    }
+
+    /**
+     * @brief 一个生产者不再放入
+     */
+    void done()
+    {
+        m_producers.fetch_sub(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 当前的项数，只用于统计
+     */
+    size_t size() const
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+
+    /**
+     * @brief push因队列满而等待的次数，用于判断下游是否是瓶颈
+     */
+    size_t pushWaits() const
+    {
+        return m_pushWaits.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+
+        Slot()
+            : sequence(0)
+        {
+        }
+
+        Slot(const Slot &)
+            : sequence(0)
+        {
+        }
+    };
+
+    static void backoff(int spins)
+    {
+        if (spins < 64)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    std::vector<Slot> m_slots;
+
+    size_t m_mask;
+
+    std::atomic<int> m_producers;
+
+    // 生产者和消费者的位置分开放在不同的缓存行
+    alignas(64) std::atomic<size_t> m_head;
+
+    alignas(64) std::atomic<size_t> m_tail;
+
+    std::atomic<size_t> m_pushWaits;
+};
+
+#endif // BOUNDEDQUEUE_H
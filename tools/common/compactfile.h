@@ -0,0 +1,36 @@
+﻿/**
+ * @file compactfile.h
+ * @brief Writing compact puzzle files from the command-line tools
+ *
+ * A compact file is COMPACT_MAGIC, the one-byte COMPACT_VERSION and the
+ * concatenated CompactCodec records; PuzzleReader reads it back.
+ */
+
+#ifndef COMPACTFILE_H
+#define COMPACTFILE_H
+
+#include "compactcodec.h"
+
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * @brief 写出紧凑格式的文件头
+ */
+inline bool writeCompactHeader(FILE *output)
+{
+    return std::fwrite(COMPACT_MAGIC, 1, 8, output) == 8 && std::fwrite(&COMPACT_VERSION, 1, 1, output) == 1;
+}
+
+/**
+ * @brief 写出一道谜题，线索之间有冲突时跳过
+ * @return 是否写出
+ */
+inline bool writeCompact(FILE *output, const uint8_t *puzzle)
+{
+    uint8_t record[CompactCodec::MAX_SIZE];
+    size_t size = CompactCodec::encode(puzzle, record);
+    return size > 0 && std::fwrite(record, 1, size, output) == size;
+}
+
+#endif // COMPACTFILE_H
@@ -0,0 +1,102 @@
+﻿/**
+ * @file concurrentset.h
+ * @brief Concurrent set of puzzles keyed by their canonical form
+ */
+
+#ifndef CONCURRENTSET_H
+#define CONCURRENTSET_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+
+/**
+ * @brief The ConcurrentSet class 分片加锁的谜题集合
+ * @details 谜题按4位一格压缩为41字节作为键，哈希值只计算一次，
+ * 高位选择分片，每个分片一把锁，不同分片上的插入互不阻塞
+ */
+class ConcurrentSet
+{
+public:
+    ConcurrentSet()
+    {
+    }
+
+    /**
+     * @brief 插入一道谜题
+     * @param puzzle 按行排列的81个数字
+     * @return 集合中原来没有这道谜题时返回true
+     */
+    bool insert(const uint8_t *puzzle)
+    {
+        Key key;
+        key.bytes.fill(0);
+        for (int i = 0; i < 81; i++)
+        {
+            key.bytes[i / 2] |= uint8_t(puzzle[i] << (i % 2 * 4));
+        }
+
+        // FNV-1a，再混合一次使高位也足够随机
+        uint64_t hash = 1469598103934665603ull;
+        for (uint8_t byte : key.bytes)
+        {
+            hash = (hash ^ byte) * 1099511628211ull;
+        }
+        hash ^= hash >> 29;
+        hash *= 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 32;
+        key.hash = hash;
+
+        Shard &shard = m_shards[hash >> (64 - SHARD_BITS)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.keys.insert(key).second;
+    }
+
+    /**
+     * @brief 集合中的谜题数
+     */
+    size_t size()
+    {
+        size_t total = 0;
+        for (Shard &shard : m_shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.keys.size();
+        }
+        return total;
+    }
+
+private:
+    static const int SHARD_BITS = 6;
+
+    struct Key
+    {
+        uint64_t hash;
+        std::array<uint8_t, 41> bytes;
+
+        bool operator==(const Key &other) const
+        {
+            return hash == other.hash && bytes == other.bytes;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            return size_t(key.hash);
+        }
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_set<Key, KeyHash> keys;
+    };
+
+    Shard m_shards[1 << SHARD_BITS];
+};
+
+#endif // CONCURRENTSET_H
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# sudoku-corpus: parse -> canonicalize -> deduplicate
+#                -> solve -> rate -> write
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = sudoku-corpus
+
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+include(../../core/core.pri)
+
+INCLUDEPATH += ../common
+
+HEADERS += \
+    ../common/boundedqueue.h \
+    ../common/compactfile.h \
+    ../common/concurrentset.h
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,411 @@
+﻿/**
+ * @file main.cpp
+ * @brief sudoku-corpus: staged pipeline that builds a puzzle corpus
+ *
+ * Usage: sudoku-corpus [--threads n] [--output file] [--format text|packed|compact] [--quiet] [file ...]
+ *
+ * parse -> canonicalize -> deduplicate -> solve -> rate -> write
+ *
+ * Every stage runs on its own thread (or group of threads) and the stages are
+ * connected by bounded lock-free queues, so a slow stage throttles the ones
+ * before it. Puzzles that are equivalent under the sudoku symmetries are kept
+ * once; puzzles without a unique solution are dropped. The text output has one
+ * line per puzzle, "<puzzle> <solution> <score>"; the packed output is the
+ * binary format of packedcorpus.h that the game maps into memory; the compact
+ * output keeps only the puzzles, in the format of compactfile.h.
+ */
+
+#include "boundedqueue.h"
+#include "canonical.h"
+#include "compactfile.h"
+#include "concurrentset.h"
+#include "packedcorpus.h"
+#include "puzzleparser.h"
+#include "rater.h"
+#include "sudokusolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief 在各阶段之间传递的一道谜题
+ */
+struct Item
+{
+    uint8_t puzzle[81];
+    uint8_t canonical[81];
+    uint8_t solution[81];
+    float score;
+};
+
+typedef BoundedQueue<Item> ItemQueue;
+
+/**
+ * @brief 一个阶段的统计
+ */
+struct Stage
+{
+    const char *name;
+    int threads;
+    std::atomic<size_t> in;         // 处理的项数
+    std::atomic<size_t> out;        // 交给下一阶段的项数
+    std::atomic<long long> busyNs;  // 所有线程处理耗时之和，不含等待队列的时间
+    std::atomic<int> running;       // 仍在运行的线程数
+    Clock::time_point start;
+    Clock::time_point end;
+
+    Stage(const char *stageName, int stageThreads)
+        : name(stageName)
+        , threads(stageThreads)
+        , in(0)
+        , out(0)
+        , busyNs(0)
+        , running(stageThreads)
+        , start(Clock::now())
+        , end(start)
+    {
+    }
+
+    void finish()
+    {
+        if (running.fetch_sub(1) == 1)
+        {
+            end = Clock::now();
+        }
+    }
+};
+
+/**
+ * @brief 启动一个阶段的线程组
+ * @param process 处理一项，返回是否交给下一阶段
+ */
+template <typename F>
+void runStage(std::vector<std::thread> &threads, Stage &stage, ItemQueue &input, ItemQueue *output, F process)
+{
+    for (int i = 0; i < stage.threads; i++)
+    {
+        threads.push_back(std::thread([&stage, &input, output, process]() mutable {
+            Item item;
+            while (input.pop(item))
+            {
+                Clock::time_point begin = Clock::now();
+                bool pass = process(item);
+                stage.busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+                ++stage.in;
+                if (pass)
+                {
+                    ++stage.out;
+                    if (output)
+                    {
+                        output->push(item);
+                    }
+                }
+            }
+            if (output)
+            {
+                output->done();
+            }
+            stage.finish();
+        }));
+    }
+}
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: sudoku-corpus [--threads n] [--output file] [--format text|packed|compact] [--quiet]\n"
+                 "                     [file ...]\n"
+                 "  Builds a deduplicated, solved and rated corpus from the puzzles in the\n"
+                 "  files (stdin if none or \"-\").\n"
+                 "  --threads n    threads per parallel stage, 0 for all cores (default)\n"
+                 "  --output file  output file, - for stdout (default, text only)\n"
+                 "  --format text  one \"<puzzle> <solution> <score>\" line per puzzle (default)\n"
+                 "  --format packed  binary corpus with solutions, scores and clue counts,\n"
+                 "                 indexed by difficulty; the game loads corpus.sdc\n"
+                 "  --format compact  puzzles only, about 20 bytes each, for storage and\n"
+                 "                 transfer; sudoku-solve reads it directly\n"
+                 "  --quiet        no progress report, only the final summary\n");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0;
+    bool quiet = false;
+    bool packed = false;
+    bool compact = false;
+    std::string outputPath = "-";
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if ((arg == "--threads" || arg == "-j") && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if ((arg == "--output" || arg == "-o") && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            std::string format = argv[++i];
+            if (format != "text" && format != "packed" && format != "compact")
+            {
+                usage();
+                return 1;
+            }
+            packed = format == "packed";
+            compact = format == "compact";
+        }
+        else if (arg == "--quiet" || arg == "-q")
+        {
+            quiet = true;
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty())
+    {
+        inputs.push_back("-");
+    }
+    if (threads < 1)
+    {
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+
+    FILE *output = nullptr;
+    CorpusWriter writer;
+    if (packed)
+    {
+        if (outputPath == "-")
+        {
+            std::fprintf(stderr, "--format packed needs an --output file\n");
+            return 1;
+        }
+        if (!writer.open(outputPath, CORPUS_SOLUTION | CORPUS_SCORE | CORPUS_CLUES))
+        {
+            std::fprintf(stderr, "%s\n", writer.errorString().c_str());
+            return 1;
+        }
+    }
+    else
+    {
+        output = outputPath == "-" ? stdout : std::fopen(outputPath.c_str(), "wb");
+        if (!output)
+        {
+            std::fprintf(stderr, "cannot open %s\n", outputPath.c_str());
+            return 1;
+        }
+        if (compact && !writeCompactHeader(output))
+        {
+            std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+            return 1;
+        }
+    }
+
+    // 去重只是查表，两个线程足够；写出只能有一个线程
+    const int dedupThreads = std::min(threads, 2);
+    const size_t capacity = 4096;
+
+    Stage parse("parse", 1);
+    Stage canonicalize("canonicalize", threads);
+    Stage dedup("dedup", dedupThreads);
+    Stage solve("solve", threads);
+    Stage rate("rate", threads);
+    Stage write("write", 1);
+    Stage *stages[] = { &parse, &canonicalize, &dedup, &solve, &rate, &write };
+
+    ItemQueue parsed(capacity, parse.threads);
+    ItemQueue canonical(capacity, canonicalize.threads);
+    ItemQueue unique(capacity, dedup.threads);
+    ItemQueue solved(capacity, solve.threads);
+    ItemQueue rated(capacity, rate.threads);
+    ItemQueue *queues[] = { &parsed, &canonical, &unique, &solved, &rated };
+
+    ConcurrentSet seen;
+    bool readError = false;
+    size_t skipped = 0;
+    std::vector<std::thread> workers;
+
+    workers.push_back(std::thread([&]() {
+        PuzzleReader input;
+        Item item;
+        for (const std::string &path : inputs)
+        {
+            if (!input.open(path))
+            {
+                std::fprintf(stderr, "%s\n", input.errorString().c_str());
+                readError = true;
+                continue;
+            }
+            for (;;)
+            {
+                Clock::time_point begin = Clock::now();
+                size_t count = input.read(item.puzzle, 1);
+                parse.busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+                if (count == 0)
+                {
+                    break;
+                }
+                ++parse.in;
+                ++parse.out;
+                parsed.push(item);
+            }
+            skipped += input.skipped();
+        }
+        parsed.done();
+        parse.finish();
+    }));
+
+    runStage(workers, canonicalize, parsed, &canonical, [](Item &item) {
+        // 每个线程一个Canonicalizer，复用其内部的候选数组
+        static thread_local Canonicalizer canonicalizer;
+        canonicalizer.canonicalize(item.puzzle, item.canonical);
+        return true;
+    });
+
+    runStage(workers, dedup, canonical, &unique, [&seen](Item &item) {
+        return seen.insert(item.canonical);
+    });
+
+    runStage(workers, solve, unique, &solved, [](Item &item) {
+        static thread_local SudokuSolver solver;
+        return solver.solve(item.puzzle, item.solution, 2) == 1;
+    });
+
+    runStage(workers, rate, solved, &rated, [](Item &item) {
+        static thread_local Rater rater;
+        rater.load(item.puzzle);
+        item.score = float(rater.rate().score);
+        return true;
+    });
+
+    bool writeError = false;
+    runStage(workers, write, rated, nullptr, [output, compact, &writer, &writeError](Item &item) {
+        if (!output)
+        {
+            writeError = writeError || !writer.add(item.puzzle, item.solution, item.score);
+            return true;
+        }
+        if (compact)
+        {
+            // 有唯一解的谜题线索之间不会冲突，总能编码
+            writeError = writeError || !writeCompact(output, item.puzzle);
+            return true;
+        }
+
+        char line[81 + 1 + 81 + 16];
+        char *p = line;
+        for (int i = 0; i < 81; i++)
+        {
+            *p++ = item.puzzle[i] ? char('0' + item.puzzle[i]) : '.';
+        }
+        *p++ = ' ';
+        for (int i = 0; i < 81; i++)
+        {
+            *p++ = char('0' + item.solution[i]);
+        }
+        p += std::sprintf(p, " %.1f\n", double(item.score));
+        std::fwrite(line, 1, size_t(p - line), output);
+        return true;
+    });
+
+    // 每秒报告一次各阶段的吞吐量和队列占用，队列长期满说明其下游是瓶颈
+    std::atomic<bool> finished(false);
+    std::thread reporter([&]() {
+        std::vector<size_t> last(6, 0);
+        while (!finished)
+        {
+            for (int i = 0; i < 10 && !finished; i++)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            if (quiet || finished)
+            {
+                continue;
+            }
+            std::string text;
+            char part[96];
+            for (int s = 0; s < 6; s++)
+            {
+                size_t in = stages[s]->in;
+                std::snprintf(part, sizeof(part), "%s%s %zu/s", s ? " | " : "", stages[s]->name, in - last[s]);
+                text += part;
+                last[s] = in;
+                if (s < 5)
+                {
+                    std::snprintf(part, sizeof(part), " [%zu/%zu]", queues[s]->size(), queues[s]->capacity());
+                    text += part;
+                }
+            }
+            std::fprintf(stderr, "%s\n", text.c_str());
+        }
+    });
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    finished = true;
+    reporter.join();
+
+    if (output)
+    {
+        writeError = std::fflush(output) != 0 || writeError;
+        if (output != stdout)
+        {
+            writeError = std::fclose(output) != 0 || writeError;
+        }
+        if (writeError)
+        {
+            std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+            return 1;
+        }
+    }
+    else if (writeError || !writer.close())
+    {
+        std::fprintf(stderr, "%s\n", writer.errorString().c_str());
+        return 1;
+    }
+
+    // 汇总：每个阶段的处理量、吞吐量、忙碌比例，以及上游因它的输入队列满而等待的次数
+    std::fprintf(stderr, "%-13s %9s %9s %11s %6s %11s\n", "stage", "in", "out", "items/s", "busy", "waits");
+    for (int s = 0; s < 6; s++)
+    {
+        Stage &stage = *stages[s];
+        double wall = std::chrono::duration<double>(stage.end - stage.start).count();
+        double busy = wall > 0 ? stage.busyNs * 1e-9 / (wall * stage.threads) : 0;
+        size_t waits = s > 0 ? queues[s - 1]->pushWaits() : 0;
+        std::fprintf(stderr, "%-13s %9zu %9zu %11.0f %5.0f%% %11zu\n", stage.name, size_t(stage.in), size_t(stage.out),
+                     wall > 0 ? stage.in / wall : 0.0, busy * 100, waits);
+    }
+    std::fprintf(stderr, "%zu lines skipped, %zu duplicates, %zu without a unique solution\n",
+                 skipped, dedup.in - dedup.out, solve.in - solve.out);
+    return readError ? 1 : 0;
+}
@@ -0,0 +1,275 @@
+﻿/**
+ * @file main.cpp
+ * @brief sudoku-modelcheck: randomized check and benchmark of BoardModel
+ *
+ * Usage: sudoku-modelcheck [--edits n] [--seed n]
+ *
+ * Applies n random edits (default 1000000) to a BoardModel, reloading a new
+ * random puzzle now and then and sometimes clearing the entries. After every
+ * edit the model is compared with a reference recomputed from the digits
+ * alone, and so is the board a listener rebuilt from the model's signals.
+ * Then the same number of edits is timed without the comparison. Exits with
+ * 1 at the first mismatch.
+ */
+
+#include "boardmodel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+// 每隔这么多次修改换一道谜题
+const int RELOAD_INTERVAL = 2000;
+
+// 换谜题时的线索数，允许有冲突
+const int RELOAD_CLUES = 20;
+
+/**
+ * @brief 每个格子的20个相关格子，直接按行列宫的定义列出，不用BoardModel的表
+ */
+struct Peers
+{
+    int cells[81][20];
+
+    Peers()
+    {
+        for (int cell = 0; cell < 81; cell++)
+        {
+            int count = 0;
+            for (int other = 0; other < 81; other++)
+            {
+                if (other != cell
+                    && (other / 9 == cell / 9 || other % 9 == cell % 9
+                        || (other / 27 == cell / 27 && other % 9 / 3 == cell % 9 / 3)))
+                {
+                    cells[cell][count++] = other;
+                }
+            }
+        }
+    }
+};
+
+const Peers P;
+
+/**
+ * @brief 只从信号得到的盘面，和界面看到的一样
+ */
+struct Listener
+{
+    int values[81];
+    int conflicts[81];
+    int candidates[81];
+    int remaining[10];
+};
+
+/**
+ * @brief 从数字重新计算的参照结果
+ */
+struct Reference
+{
+    int conflicts[81];
+    int candidates[81];
+    int remaining[10];
+
+    explicit Reference(const uint8_t *values)
+    {
+        for (int digit = 1; digit <= 9; digit++)
+        {
+            remaining[digit] = 9;
+        }
+        for (int cell = 0; cell < 81; cell++)
+        {
+            int used = 0;
+            conflicts[cell] = 0;
+            for (int other : P.cells[cell])
+            {
+                if (values[other])
+                {
+                    used |= 1 << (values[other] - 1);
+                    conflicts[cell] += values[cell] && values[other] == values[cell];
+                }
+            }
+            candidates[cell] = values[cell] ? 0 : ~used & 0x1ff;
+            if (values[cell])
+            {
+                --remaining[values[cell]];
+            }
+        }
+    }
+};
+
+bool fail(long long edit, const char *what, int index, int got, int expected)
+{
+    std::fprintf(stderr, "edit %lld: %s[%d] is %d, expected %d\n", edit, what, index, got, expected);
+    return false;
+}
+
+bool compare(const BoardModel &model, const Listener &listener, const uint8_t *values, long long edit)
+{
+    Reference reference(values);
+    for (int cell = 0; cell < 81; cell++)
+    {
+        if (model.value(cell) != values[cell])
+        {
+            return fail(edit, "value", cell, model.value(cell), values[cell]);
+        }
+        if (listener.values[cell] != values[cell])
+        {
+            return fail(edit, "signalled value", cell, listener.values[cell], values[cell]);
+        }
+        if (model.conflicts(cell) != reference.conflicts[cell])
+        {
+            return fail(edit, "conflicts", cell, model.conflicts(cell), reference.conflicts[cell]);
+        }
+        if (listener.conflicts[cell] != reference.conflicts[cell])
+        {
+            return fail(edit, "signalled conflicts", cell, listener.conflicts[cell], reference.conflicts[cell]);
+        }
+        if (model.conflictCells().test(cell) != (reference.conflicts[cell] > 0))
+        {
+            return fail(edit, "conflict cells", cell, model.conflictCells().test(cell), reference.conflicts[cell] > 0);
+        }
+        if (model.candidates(cell) != reference.candidates[cell])
+        {
+            return fail(edit, "candidates", cell, model.candidates(cell), reference.candidates[cell]);
+        }
+        if (listener.candidates[cell] != reference.candidates[cell])
+        {
+            return fail(edit, "signalled candidates", cell, listener.candidates[cell], reference.candidates[cell]);
+        }
+    }
+    for (int digit = 1; digit <= 9; digit++)
+    {
+        if (model.remaining(digit) != reference.remaining[digit])
+        {
+            return fail(edit, "remaining", digit, model.remaining(digit), reference.remaining[digit]);
+        }
+        if (listener.remaining[digit] != reference.remaining[digit])
+        {
+            return fail(edit, "signalled remaining", digit, listener.remaining[digit], reference.remaining[digit]);
+        }
+    }
+    for (int unit = 0; unit < 27; unit++)
+    {
+        for (int digit = 1; digit <= 9; digit++)
+        {
+            int count = 0;
+            for (Bitboard cells = BoardModel::unit(unit); !cells.empty();)
+            {
+                count += values[cells.pop()] == digit;
+            }
+            if (model.unitCount(unit, digit) != count)
+            {
+                return fail(edit, "unit count", unit * 10 + digit, model.unitCount(unit, digit), count);
+            }
+        }
+    }
+    return true;
+}
+
+void randomPuzzle(std::mt19937 &random, uint8_t *puzzle)
+{
+    std::memset(puzzle, 0, 81);
+    for (int i = 0; i < RELOAD_CLUES; i++)
+    {
+        puzzle[random() % 81] = uint8_t(1 + random() % 9);
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    long long edits = 1000000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--edits" && i + 1 < argc)
+        {
+            edits = std::atoll(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            seed = unsigned(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: sudoku-modelcheck [--edits n] [--seed n]\n");
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    BoardModel model;
+    Listener listener;
+    QObject::connect(&model, &BoardModel::valueChanged, [&](int cell, int value) { listener.values[cell] = value; });
+    QObject::connect(&model, &BoardModel::conflictsChanged,
+                     [&](int cell, int conflicts) { listener.conflicts[cell] = conflicts; });
+    QObject::connect(&model, &BoardModel::candidatesChanged,
+                     [&](int cell, int candidates) { listener.candidates[cell] = candidates; });
+    QObject::connect(&model, &BoardModel::remainingChanged,
+                     [&](int digit, int remaining) { listener.remaining[digit] = remaining; });
+    QObject::connect(&model, &BoardModel::loaded, [&]() {
+        for (int cell = 0; cell < 81; cell++)
+        {
+            listener.values[cell] = model.value(cell);
+            listener.conflicts[cell] = model.conflicts(cell);
+            listener.candidates[cell] = model.candidates(cell);
+        }
+        for (int digit = 1; digit <= 9; digit++)
+        {
+            listener.remaining[digit] = model.remaining(digit);
+        }
+    });
+
+    // 参照盘面，谜面的格子不能修改
+    std::mt19937 random(seed);
+    uint8_t puzzle[81];
+    uint8_t values[81];
+    for (long long edit = 0; edit < edits; edit++)
+    {
+        if (edit % RELOAD_INTERVAL == 0)
+        {
+            randomPuzzle(random, puzzle);
+            std::memcpy(values, puzzle, 81);
+            model.load(puzzle);
+        }
+        else if (random() % 1000 == 0)
+        {
+            std::memcpy(values, puzzle, 81);
+            model.clearEntries();
+        }
+        else
+        {
+            int cell = int(random() % 81);
+            int value = int(random() % 10);
+            if (!puzzle[cell])
+            {
+                values[cell] = uint8_t(value);
+            }
+            model.setValue(cell, value);
+        }
+        if (!compare(model, listener, values, edit))
+        {
+            return 1;
+        }
+    }
+    std::printf("%lld random edits match the reference\n", edits);
+
+    // 计时时信号仍然连接着，和界面中的开销一致
+    randomPuzzle(random, puzzle);
+    model.load(puzzle);
+    auto start = std::chrono::steady_clock::now();
+    for (long long edit = 0; edit < edits; edit++)
+    {
+        model.setValue(int(random() % 81), int(random() % 10));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%lld edits in %.3f s, %.1f ns/edit\n", edits, seconds, edits > 0 ? seconds * 1e9 / edits : 0.0);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# sudoku-modelcheck: randomized check and benchmark
+#                    of the game's BoardModel, no widgets
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = sudoku-modelcheck
+
+QT = core
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../include
+include(../../core/core.pri)
+
+SOURCES += \
+    main.cpp \
+    ../../src/boardmodel.cpp
+
+HEADERS += \
+    ../../include/boardmodel.h
@@ -0,0 +1,282 @@
+﻿/**
+ * @file main.cpp
+ * @brief sudoku-ringd: solver daemon behind the shared-memory ring
+ *
+ * Usage: sudoku-ringd [--name /sudoku-ring] [--slots n] [--threads n]
+ *        sudoku-ringd --submit [--name /sudoku-ring] [file ...]
+ *
+ * The daemon creates the ring of solvering.h and solves every submitted slot
+ * in place until it gets SIGINT or SIGTERM, and once a second hands back the
+ * slots of producers that exited while holding them. With --submit it is a producer
+ * instead: it reads puzzles straight into ring slots, keeps the whole ring in
+ * flight and writes one line per puzzle in input order, like sudoku-solve.
+ */
+
+#include "puzzleparser.h"
+#include "solvering.h"
+#include "sudokusolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<bool> stopping(false);
+
+void stopDaemon(int)
+{
+    stopping = true;
+}
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: sudoku-ringd [--name /sudoku-ring] [--slots n] [--threads n]\n"
+                 "       sudoku-ringd --submit [--name /sudoku-ring] [file ...]\n"
+                 "  Serves a shared-memory ring of puzzle slots; co-located processes write\n"
+                 "  puzzles into the slots and read the solutions in place.\n"
+                 "  --name name    shared-memory object (default /sudoku-ring)\n"
+                 "  --slots n      ring size, a power of two (default 1024)\n"
+                 "  --threads n    solver threads, 0 for all cores (default)\n"
+                 "  --submit       act as a producer: solve the files (stdin if none) through\n"
+                 "                 a running daemon and print the solutions in input order\n");
+}
+
+int serve(const std::string &name, uint32_t slots, int threads)
+{
+    SolveRing ring;
+    if (!ring.create(name, slots))
+    {
+        std::fprintf(stderr, "%s\n", ring.errorString().c_str());
+        return 1;
+    }
+    std::signal(SIGINT, stopDaemon);
+    std::signal(SIGTERM, stopDaemon);
+    std::fprintf(stderr, "serving %s: %u slots, %d solver threads\n", name.c_str(), slots, threads);
+
+    std::atomic<unsigned long long> solved(0);
+    std::vector<std::thread> solvers;
+    for (int i = 0; i < threads; i++)
+    {
+        solvers.push_back(std::thread([&]() {
+            std::unique_ptr<SudokuSolver> solver(new SudokuSolver);
+            unsigned long long count = 0;
+            uint32_t ticket;
+            while (RingSlot *slot = ring.next(ticket, stopping))
+            {
+                // 直接在槽位中读谜题、写答案
+                slot->nodes = 0;
+                if (slot->limit <= 0)
+                {
+                    slot->result = 0;
+                }
+                else if (std::any_of(slot->puzzle, slot->puzzle + 81, [](uint8_t cell) { return cell > 9; }))
+                {
+                    slot->result = -1;
+                    std::memset(slot->solution, 0, 81);
+                }
+                else
+                {
+                    slot->result = solver->solve(slot->puzzle, slot->solution, slot->limit);
+                    slot->nodes = solver->nodes();
+                    if (slot->result == 0)
+                    {
+                        std::memset(slot->solution, 0, 81);
+                    }
+                    ++count;
+                }
+                ring.complete(slot, ticket);
+            }
+            solved += count;
+        }));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 1; !stopping; tick++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // 每秒收回一次已退出的生产者留下的槽位，否则环会停住
+        if (tick % 10 == 0)
+        {
+            if (uint32_t reclaimed = ring.reclaim())
+            {
+                std::fprintf(stderr, "reclaimed %u slots held by exited producers\n", reclaimed);
+            }
+        }
+    }
+    ring.wakeSolvers();
+    for (auto &solver : solvers)
+    {
+        solver.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%llu puzzles solved in %.1f s\n", (unsigned long long)solved, seconds);
+    return 0;
+}
+
+int submit(const std::string &name, const std::vector<std::string> &inputs)
+{
+    SolveRing ring;
+    if (!ring.attach(name))
+    {
+        std::fprintf(stderr, "%s\n", ring.errorString().c_str());
+        return 1;
+    }
+
+    struct InFlight
+    {
+        RingSlot *slot;
+        uint32_t ticket;
+    };
+    std::deque<InFlight> inFlight;
+    std::string text;
+    size_t total = 0;
+    size_t skipped = 0;
+    bool readError = false;
+    auto start = std::chrono::steady_clock::now();
+
+    // 写出并归还最早提交的槽位，保持输入顺序
+    auto finishOldest = [&]() {
+        InFlight oldest = inFlight.front();
+        inFlight.pop_front();
+        ring.wait(oldest.slot, oldest.ticket);
+        if (oldest.slot->limit > 0)
+        {
+            if (oldest.slot->result > 0)
+            {
+                for (int i = 0; i < 81; i++)
+                {
+                    text += char('0' + oldest.slot->solution[i]);
+                }
+                text += '\n';
+            }
+            else
+            {
+                text += "unsolvable\n";
+            }
+        }
+        ring.release(oldest.slot, oldest.ticket);
+        if (text.size() >= (1 << 16))
+        {
+            std::fwrite(text.data(), 1, text.size(), stdout);
+            text.clear();
+        }
+    };
+
+    PuzzleReader input;
+    for (const std::string &path : inputs)
+    {
+        if (!input.open(path))
+        {
+            std::fprintf(stderr, "%s\n", input.errorString().c_str());
+            readError = true;
+            continue;
+        }
+        for (;;)
+        {
+            // 环满时先归还自己的槽位，不持有槽位时才阻塞等待其他生产者
+            uint32_t ticket;
+            RingSlot *slot;
+            while (!(slot = ring.tryAcquire(ticket)))
+            {
+                if (inFlight.empty())
+                {
+                    slot = ring.acquire(ticket);
+                    break;
+                }
+                finishOldest();
+            }
+            // 解析器直接写入槽位；文件已读完时提交空槽位把票号交还给守护进程
+            slot->limit = input.read(slot->puzzle, 1) == 1 ? 1 : 0;
+            ring.submit(slot, ticket);
+            inFlight.push_back({ slot, ticket });
+            if (slot->limit == 0)
+            {
+                break;
+            }
+            ++total;
+        }
+        skipped += input.skipped();
+    }
+    while (!inFlight.empty())
+    {
+        finishOldest();
+    }
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fflush(stdout);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%zu puzzles, %zu skipped, %.2f s, %.0f puzzles/s\n", total, skipped, seconds,
+                 seconds > 0 ? total / seconds : 0.0);
+    return readError ? 1 : 0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::string name = "/sudoku-ring";
+    uint32_t slots = 1024;
+    int threads = 0;
+    bool producer = false;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc)
+        {
+            name = argv[++i];
+        }
+        else if (arg == "--slots" && i + 1 < argc)
+        {
+            slots = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if ((arg == "--threads" || arg == "-j") && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--submit")
+        {
+            producer = true;
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (producer)
+    {
+        if (inputs.empty())
+        {
+            inputs.push_back("-");
+        }
+        return submit(name, inputs);
+    }
+    if (threads < 1)
+    {
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+    return serve(name, slots, threads);
+}
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# sudoku-ringd: solver daemon behind the shared-memory
+#               ring, and a producer for testing it
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = sudoku-ringd
+
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+include(../../core/core.pri)
+
+SOURCES += \
+    main.cpp
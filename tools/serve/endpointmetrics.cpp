@@ -0,0 +1,91 @@
+﻿#include "endpointmetrics.h"
+
+#include <QtAlgorithms>
+
+void EndpointMetrics::record(const QString &endpoint, int status, qint64 micros)
+{
+    Endpoint &e = m_endpoints[endpoint];
+    ++e.requests;
+    if (status >= 400)
+    {
+        ++e.errors;
+    }
+    ++e.buckets[bucketOf(micros)];
+    e.maxMicros = qMax(e.maxMicros, micros);
+    e.totalMicros += double(micros);
+}
+
+void EndpointMetrics::shed(const QString &endpoint)
+{
+    ++m_endpoints[endpoint].shed;
+}
+
+QJsonObject EndpointMetrics::toJson() const
+{
+    QJsonObject result;
+    for (auto it = m_endpoints.constBegin(); it != m_endpoints.constEnd(); ++it)
+    {
+        const Endpoint &e = it.value();
+        QJsonObject latency;
+        latency["mean"] = e.requests ? e.totalMicros / double(e.requests) : 0.0;
+        latency["p50"] = double(percentile(e, 0.50));
+        latency["p90"] = double(percentile(e, 0.90));
+        latency["p99"] = double(percentile(e, 0.99));
+        latency["max"] = double(e.maxMicros);
+
+        QJsonObject object;
+        object["requests"] = double(e.requests);
+        object["errors"] = double(e.errors);
+        object["shed"] = double(e.shed);
+        object["latency_us"] = latency;
+        result[it.key()] = object;
+    }
+    return result;
+}
+
+int EndpointMetrics::bucketOf(qint64 micros)
+{
+    if (micros < 4)
+    {
+        return int(qMax<qint64>(micros, 0));
+    }
+    // 最高位决定区间，其后两位决定区间内的桶
+    int exponent = 63 - int(qCountLeadingZeroBits(quint64(micros)));
+    int bucket = exponent * 4 + int((micros >> (exponent - 2)) & 3);
+    return qMin(bucket, BUCKETS - 1);
+}
+
+qint64 EndpointMetrics::bucketLimit(int bucket)
+{
+    if (bucket < 4)
+    {
+        return bucket;
+    }
+    int exponent = bucket / 4;
+    return (qint64(4 + bucket % 4 + 1) << (exponent - 2)) - 1;
+}
+
+qint64 EndpointMetrics::percentile(const Endpoint &endpoint, double fraction)
+{
+    quint64 total = 0;
+    for (quint64 count : endpoint.buckets)
+    {
+        total += count;
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    quint64 rank = quint64(fraction * double(total - 1)) + 1;
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += endpoint.buckets[i];
+        if (seen >= rank)
+        {
+            return qMin(bucketLimit(i), endpoint.maxMicros);
+        }
+    }
+    return endpoint.maxMicros;
+}
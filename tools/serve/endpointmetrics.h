@@ -0,0 +1,57 @@
+﻿/**
+ * @file endpointmetrics.h
+ * @brief Per-endpoint request counters and latency histograms
+ */
+
+#ifndef ENDPOINTMETRICS_H
+#define ENDPOINTMETRICS_H
+
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+
+/**
+ * @brief The EndpointMetrics class 按端点统计请求数和延迟
+ * @details 延迟按微秒记录在对数分桶的直方图中，每个2的幂区间分4个桶，
+ * 百分位数的误差不超过19%。只在网络线程中使用，不加锁
+ */
+class EndpointMetrics
+{
+public:
+    /**
+     * @brief 记录一个已应答的请求
+     * @param status HTTP状态码
+     * @param micros 从收到请求到写出应答的时间
+     */
+    void record(const QString &endpoint, int status, qint64 micros);
+
+    /**
+     * @brief 记录一个因队列已满被拒绝的请求
+     */
+    void shed(const QString &endpoint);
+
+    QJsonObject toJson() const;
+
+private:
+    static const int BUCKETS = 4 * 40;
+
+    struct Endpoint
+    {
+        quint64 requests = 0;
+        quint64 errors = 0; // 4xx和5xx，不含被拒绝的请求
+        quint64 shed = 0;
+        quint64 buckets[BUCKETS] = {};
+        qint64 maxMicros = 0;
+        double totalMicros = 0;
+    };
+
+    static int bucketOf(qint64 micros);
+
+    static qint64 bucketLimit(int bucket);
+
+    static qint64 percentile(const Endpoint &endpoint, double fraction);
+
+    QMap<QString, Endpoint> m_endpoints;
+};
+
+#endif // ENDPOINTMETRICS_H
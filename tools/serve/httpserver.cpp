@@ -0,0 +1,364 @@
+﻿#include "httpserver.h"
+
+#include "puzzleparser.h"
+#include "solvedispatcher.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QTcpSocket>
+
+namespace {
+
+const int MAX_HEADER = 8 * 1024;
+const int MAX_BODY = 64 * 1024;
+const int MAX_CONNECTIONS = 1024;
+const int IDLE_TIMEOUT = 30 * 1000; // 空闲连接保持的毫秒数
+const int MAX_COUNT_LIMIT = 1000;
+
+const char *reasonPhrase(int status)
+{
+    switch (status)
+    {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 413:
+        return "Payload Too Large";
+    case 431:
+        return "Request Header Fields Too Large";
+    case 501:
+        return "Not Implemented";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "Error";
+    }
+}
+
+QByteArray errorBody(const QString &message)
+{
+    QJsonObject object;
+    object["error"] = message;
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+}
+
+HttpConnection::HttpConnection(QTcpSocket *socket, HttpServer *server)
+    : QObject(server)
+    , m_socket(socket)
+    , m_server(server)
+    , m_received(0)
+    , m_written(0)
+    , m_closing(false)
+{
+    m_socket->setParent(this);
+    connect(m_socket, &QTcpSocket::readyRead, this, &HttpConnection::onReadyRead);
+    connect(m_socket, &QTcpSocket::disconnected, this, &QObject::deleteLater);
+
+    m_idle.setSingleShot(true);
+    m_idle.setInterval(IDLE_TIMEOUT);
+    connect(&m_idle, &QTimer::timeout, m_socket, &QTcpSocket::disconnectFromHost);
+    m_idle.start();
+}
+
+void HttpConnection::respond(quint64 sequence, int status, const QByteArray &body, bool keepAlive,
+                             const QByteArray &contentType)
+{
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reasonPhrase(status) + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    if (status == 503)
+    {
+        response += "Retry-After: 1\r\n";
+    }
+    response += "\r\n";
+    response += body;
+
+    m_ready.insert(sequence, response);
+    flush();
+}
+
+void HttpConnection::onReadyRead()
+{
+    m_idle.start();
+    if (m_closing)
+    {
+        m_socket->readAll();
+        return;
+    }
+    m_buffer += m_socket->readAll();
+
+    HttpRequest request;
+    int result;
+    while (!m_closing && (result = takeRequest(request)) != 0)
+    {
+        quint64 sequence = m_received++;
+        if (result != 200)
+        {
+            // 无法继续解析后面的数据，应答后关闭连接
+            m_closing = true;
+            m_buffer.clear();
+            respond(sequence, result, errorBody("malformed request"), false);
+            return;
+        }
+        m_closing = !request.keepAlive;
+        m_server->handle(this, sequence, request);
+    }
+}
+
+int HttpConnection::takeRequest(HttpRequest &request)
+{
+    int headerEnd = m_buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+    {
+        return m_buffer.size() > MAX_HEADER ? 431 : 0;
+    }
+    if (headerEnd > MAX_HEADER)
+    {
+        return 431;
+    }
+
+    QList<QByteArray> lines = m_buffer.left(headerEnd).split('\n');
+    QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+    if (requestLine.size() != 3 || !requestLine[2].startsWith("HTTP/1."))
+    {
+        return 400;
+    }
+
+    // HTTP/1.1默认保持连接，HTTP/1.0默认关闭
+    bool keepAlive = requestLine[2] != "HTTP/1.0";
+    qint64 length = 0;
+    for (const QByteArray &line : lines)
+    {
+        int colon = line.indexOf(':');
+        if (colon <= 0)
+        {
+            return 400;
+        }
+        QByteArray name = line.left(colon).trimmed().toLower();
+        QByteArray value = line.mid(colon + 1).trimmed();
+        if (name == "content-length")
+        {
+            bool ok;
+            length = value.toLongLong(&ok);
+            if (!ok || length < 0)
+            {
+                return 400;
+            }
+        }
+        else if (name == "connection")
+        {
+            keepAlive = value.toLower() == "close" ? false : value.toLower() == "keep-alive" ? true : keepAlive;
+        }
+        else if (name == "transfer-encoding")
+        {
+            return 501;
+        }
+    }
+    if (length > MAX_BODY)
+    {
+        return 413;
+    }
+    if (m_buffer.size() < headerEnd + 4 + length)
+    {
+        return 0;
+    }
+
+    request.method = requestLine[0];
+    request.path = requestLine[1];
+    request.body = m_buffer.mid(headerEnd + 4, int(length));
+    request.keepAlive = keepAlive;
+    m_buffer.remove(0, headerEnd + 4 + int(length));
+    return 200;
+}
+
+void HttpConnection::flush()
+{
+    auto it = m_ready.begin();
+    while (it != m_ready.end() && it.key() == m_written)
+    {
+        m_socket->write(it.value());
+        it = m_ready.erase(it);
+        ++m_written;
+    }
+    if (m_closing && m_written == m_received)
+    {
+        m_socket->disconnectFromHost();
+    }
+}
+
+HttpServer::HttpServer(SolveDispatcher *dispatcher, QObject *parent)
+    : QObject(parent)
+    , m_dispatcher(dispatcher)
+    , m_connections(0)
+{
+    connect(&m_server, &QTcpServer::newConnection, this, &HttpServer::onNewConnection);
+    m_uptime.start();
+}
+
+bool HttpServer::listen(const QHostAddress &address, quint16 port)
+{
+    return m_server.listen(address, port);
+}
+
+QString HttpServer::errorString() const
+{
+    return m_server.errorString();
+}
+
+quint16 HttpServer::port() const
+{
+    return m_server.serverPort();
+}
+
+void HttpServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server.nextPendingConnection())
+    {
+        if (m_connections >= MAX_CONNECTIONS)
+        {
+            m_metrics.shed("connection");
+            socket->write("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n"
+                          "Retry-After: 1\r\n\r\n");
+            socket->disconnectFromHost();
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            continue;
+        }
+        ++m_connections;
+        HttpConnection *connection = new HttpConnection(socket, this);
+        connect(connection, &QObject::destroyed, this, [this]() { --m_connections; });
+    }
+}
+
+void HttpServer::handle(HttpConnection *connection, quint64 sequence, const HttpRequest &request)
+{
+    static const QByteArray endpoints[] = { "/solve", "/count", "/rate", "/generate", "/metrics",
+                                            "/metrics/prometheus", "/health" };
+    QString endpoint = "other";
+    for (const QByteArray &path : endpoints)
+    {
+        if (request.path == path)
+        {
+            endpoint = QString::fromLatin1(path);
+        }
+    }
+
+    // 延迟从解析出请求开始计算，包括排队的时间
+    QElapsedTimer timer;
+    timer.start();
+    QPointer<HttpConnection> target(connection);
+    bool keepAlive = request.keepAlive;
+    auto reply = [this, target, sequence, keepAlive, endpoint, timer](int status, const QByteArray &body) {
+        m_metrics.record(endpoint, status, timer.nsecsElapsed() / 1000);
+        if (target)
+        {
+            target->respond(sequence, status, body, keepAlive);
+        }
+    };
+
+    if (endpoint == "other")
+    {
+        reply(404, errorBody("unknown endpoint"));
+        return;
+    }
+    if (endpoint == "/health" || endpoint.startsWith("/metrics"))
+    {
+        if (request.method != "GET")
+        {
+            reply(405, errorBody("use GET"));
+            return;
+        }
+        if (endpoint == "/metrics/prometheus")
+        {
+            m_metrics.record(endpoint, 200, timer.nsecsElapsed() / 1000);
+            connection->respond(sequence, 200, QByteArray::fromStdString(m_dispatcher->operations().toPrometheus()),
+                                keepAlive, "text/plain; version=0.0.4");
+            return;
+        }
+        QJsonObject health;
+        health["status"] = "ok";
+        reply(200, endpoint == "/health" ? QJsonDocument(health).toJson(QJsonDocument::Compact) : metricsBody());
+        return;
+    }
+    if (request.method != "POST")
+    {
+        reply(405, errorBody("use POST"));
+        return;
+    }
+
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(request.body, &error);
+    if (error.error != QJsonParseError::NoError || !document.isObject())
+    {
+        reply(400, errorBody("body must be a JSON object"));
+        return;
+    }
+    QJsonObject object = document.object();
+
+    Job job;
+    job.param = 0;
+    if (endpoint == "/generate")
+    {
+        job.type = JOB_GENERATE;
+        QString name = object.value("difficulty").toString("medium");
+        job.param = -1;
+        for (int level = 0; level < DIFFICULTY_COUNT; level++)
+        {
+            if (name.compare(Rater::difficultyName(Difficulty(level)), Qt::CaseInsensitive) == 0)
+            {
+                job.param = level;
+            }
+        }
+        if (job.param < 0)
+        {
+            reply(400, errorBody("difficulty must be easy, medium, hard or expert"));
+            return;
+        }
+    }
+    else
+    {
+        job.type = endpoint == "/solve" ? JOB_SOLVE : endpoint == "/count" ? JOB_COUNT : JOB_RATE;
+        QByteArray puzzle = object.value("puzzle").toString().toLatin1();
+        PuzzleParser parser;
+        if (!parser.feedLine(puzzle.constData(), size_t(puzzle.size()), job.puzzle))
+        {
+            reply(400, errorBody("puzzle must have 81 cells, '.' or '0' for blanks"));
+            return;
+        }
+        if (job.type == JOB_COUNT)
+        {
+            job.param = qBound(1, object.value("limit").toInt(2), MAX_COUNT_LIMIT);
+        }
+    }
+
+    job.done = [reply](const QByteArray &body) { reply(200, body); };
+    if (!m_dispatcher->submit(std::move(job)))
+    {
+        // 队列已满，立即拒绝，不计入延迟
+        m_metrics.shed(endpoint);
+        if (target)
+        {
+            target->respond(sequence, 503, errorBody("overloaded"), keepAlive);
+        }
+    }
+}
+
+QByteArray HttpServer::metricsBody() const
+{
+    QJsonObject object;
+    object["uptime_s"] = double(m_uptime.elapsed()) / 1000;
+    object["connections"] = m_connections;
+    object["dispatcher"] = m_dispatcher->stats();
+    object["endpoints"] = m_metrics.toJson();
+    QByteArray operations = QByteArray::fromStdString(m_dispatcher->operations().toJson());
+    object["operations"] = QJsonDocument::fromJson(operations).object();
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
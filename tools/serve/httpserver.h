@@ -0,0 +1,133 @@
+﻿/**
+ * @file httpserver.h
+ * @brief Minimal HTTP/1.1 front end of sudoku-serve
+ *
+ * Endpoints (JSON request and response bodies):
+ *
+ *     POST /solve     {"puzzle": "..."}               status, solution, nodes
+ *     POST /count     {"puzzle": "...", "limit": 2}   count, limit
+ *     POST /rate      {"puzzle": "..."}               score, difficulty, hardest
+ *     POST /generate  {"difficulty": "hard"}          puzzle, solution, score
+ *     GET  /metrics   request counts and latency percentiles per endpoint,
+ *                     solver-side latency percentiles per operation and phase
+ *     GET  /metrics/prometheus   the solver-side histograms as Prometheus text
+ *     GET  /health    {"status": "ok"}
+ *
+ * A puzzle is 81 cells with '.' or '0' for blanks. Connections are kept alive
+ * unless the client asks otherwise, and pipelined requests are answered in
+ * order. When the solver queue is full the server answers 503 at once.
+ */
+
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include "endpointmetrics.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QMap>
+#include <QObject>
+#include <QTcpServer>
+#include <QTimer>
+
+class QTcpSocket;
+class SolveDispatcher;
+class HttpServer;
+
+/**
+ * @brief 解析出的一个请求
+ */
+struct HttpRequest
+{
+    QByteArray method;
+    QByteArray path;
+    QByteArray body;
+    bool keepAlive;
+};
+
+/**
+ * @brief The HttpConnection class 一个客户端连接
+ * @details 按到达顺序给请求编号，应答可能乱序完成，但按编号顺序写出
+ */
+class HttpConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    HttpConnection(QTcpSocket *socket, HttpServer *server);
+
+    /**
+     * @brief 完成编号为sequence的请求
+     */
+    void respond(quint64 sequence, int status, const QByteArray &body, bool keepAlive,
+                 const QByteArray &contentType = "application/json");
+
+private:
+    void onReadyRead();
+
+    /**
+     * @brief 从缓冲区中取出一个完整的请求
+     * @return 请求不完整时返回0，格式错误时返回HTTP错误码，成功时返回200
+     */
+    int takeRequest(HttpRequest &request);
+
+    void flush();
+
+    QTcpSocket *m_socket;
+
+    HttpServer *m_server;
+
+    QByteArray m_buffer;
+
+    quint64 m_received; // 已收到的请求数，也是下一个请求的编号
+
+    quint64 m_written; // 已写出应答的请求数
+
+    QMap<quint64, QByteArray> m_ready; // 已完成但还不能写出的应答
+
+    bool m_closing;
+
+    QTimer m_idle;
+};
+
+/**
+ * @brief The HttpServer class 监听本地端口，把请求分派给SolveDispatcher
+ */
+class HttpServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    HttpServer(SolveDispatcher *dispatcher, QObject *parent = nullptr);
+
+    bool listen(const QHostAddress &address, quint16 port);
+
+    QString errorString() const;
+
+    quint16 port() const;
+
+private:
+    friend class HttpConnection;
+
+    void onNewConnection();
+
+    /**
+     * @brief 处理一个请求，应答通过connection->respond写出
+     */
+    void handle(HttpConnection *connection, quint64 sequence, const HttpRequest &request);
+
+    QByteArray metricsBody() const;
+
+    QTcpServer m_server;
+
+    SolveDispatcher *m_dispatcher;
+
+    EndpointMetrics m_metrics;
+
+    QElapsedTimer m_uptime;
+
+    int m_connections;
+};
+
+#endif // HTTPSERVER_H
@@ -0,0 +1,72 @@
+﻿/**
+ * @file main.cpp
+ * @brief sudoku-serve: long-lived local HTTP/JSON solve service
+ *
+ * Usage: sudoku-serve [--port n] [--threads n] [--queue n] [--batch n] [--cache n] [--pool file]
+ *
+ * Serves solve, count, rate and generate requests on localhost (see
+ * httpserver.h). Requests are queued for a pool of solver threads that take
+ * them in micro-batches; generate is answered from a background-refilled
+ * puzzle pool, and repeated solve/count/rate requests from an LRU cache.
+ */
+
+#include "httpserver.h"
+#include "puzzlepool.h"
+#include "solvedispatcher.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include <csignal>
+#include <thread>
+
+// Ctrl+C和SIGTERM时退出事件循环，析构时保存谜题池
+static void quitServer(int)
+{
+    QCoreApplication::quit();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sudoku-serve");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Local HTTP/JSON sudoku service: POST /solve, /count, /rate, /generate; "
+                                     "GET /metrics, /metrics/prometheus, /health.");
+    parser.addHelpOption();
+    parser.addOption({ "port", "TCP port on 127.0.0.1 (default 8080).", "n", "8080" });
+    parser.addOption({ "threads", "Solver threads, 0 for all cores (default).", "n", "0" });
+    parser.addOption({ "queue", "Queued requests before new ones get 503 (default 4096).", "n", "4096" });
+    parser.addOption({ "batch", "Most requests a solver thread takes at once (default 64).", "n", "64" });
+    parser.addOption({ "cache", "Cached solve/count/rate results (default 65536).", "n", "65536" });
+    parser.addOption({ "pool", "File that keeps the generate pool across restarts.", "file" });
+    parser.process(app);
+
+    int threads = parser.value("threads").toInt();
+    if (threads < 1)
+    {
+        threads = qMax(1, int(std::thread::hardware_concurrency()));
+    }
+
+    PuzzlePool pool(parser.value("pool"), 256, 128);
+    pool.start();
+
+    SolveDispatcher dispatcher(threads, qMax(1, parser.value("queue").toInt()), qMax(1, parser.value("batch").toInt()),
+                               qMax(0, parser.value("cache").toInt()), &pool);
+    HttpServer server(&dispatcher);
+
+    QTextStream err(stderr);
+    if (!server.listen(QHostAddress::LocalHost, quint16(parser.value("port").toUInt())))
+    {
+        err << "cannot listen: " << server.errorString() << "\n";
+        return 1;
+    }
+    err << "listening on 127.0.0.1:" << server.port() << " with " << threads << " solver threads\n";
+    err.flush();
+
+    std::signal(SIGINT, quitServer);
+    std::signal(SIGTERM, quitServer);
+    return app.exec();
+}
@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# sudoku-serve: local HTTP/JSON solve service
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = sudoku-serve
+
+QT = core network
+
+CONFIG += console c++11 thread
+CONFIG -= app_bundle
+
+include(../../core/core.pri)
+
+# The generate pool is shared with the GUI app
+INCLUDEPATH += ../../include
+
+HEADERS += \
+    httpserver.h \
+    solvedispatcher.h \
+    endpointmetrics.h \
+    ../../include/puzzlepool.h
+
+SOURCES += \
+    main.cpp \
+    httpserver.cpp \
+    solvedispatcher.cpp \
+    endpointmetrics.cpp \
+    ../../src/puzzlepool.cpp
@@ -0,0 +1,264 @@
+﻿#include "solvedispatcher.h"
+
+#include "generator.h"
+#include "puzzlepool.h"
+#include "sudokusolver.h"
+
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+
+#include <chrono>
+#include <memory>
+
+namespace {
+
+// 生成与请求难度不符的谜题时最多重试的次数
+const int MAX_GENERATE_ATTEMPTS = 32;
+
+QString cellsToString(const uint8_t *cells)
+{
+    QString text(81, '.');
+    for (int i = 0; i < 81; i++)
+    {
+        if (cells[i])
+        {
+            text[i] = QChar('0' + cells[i]);
+        }
+    }
+    return text;
+}
+
+QByteArray toBody(const QJsonObject &object)
+{
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+QByteArray generatedBody(const uint8_t *puzzle, const uint8_t *solution, double score)
+{
+    QJsonObject object;
+    object["puzzle"] = cellsToString(puzzle);
+    object["solution"] = cellsToString(solution);
+    object["score"] = score;
+    object["difficulty"] = Rater::difficultyName(Rater::difficultyOf(score));
+    return toBody(object);
+}
+
+}
+
+SolveDispatcher::SolveDispatcher(int threads, int queueCapacity, int batchSize, int cacheEntries,
+                                 PuzzlePool *pool, QObject *parent)
+    : QObject(parent)
+    , m_pool(pool)
+    , m_capacity(queueCapacity)
+    , m_batchSize(batchSize)
+    , m_stopping(false)
+    , m_cache(cacheEntries)
+    , m_batches(0)
+    , m_jobs(0)
+    , m_cacheHits(0)
+    , m_poolHits(0)
+{
+    for (int i = 0; i < threads; i++)
+    {
+        m_threads.push_back(std::thread([this]() { run(); }));
+    }
+}
+
+SolveDispatcher::~SolveDispatcher()
+{
+    m_mutex.lock();
+    m_stopping = true;
+    m_wake.wakeAll();
+    m_mutex.unlock();
+    for (std::thread &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+bool SolveDispatcher::submit(Job job)
+{
+    if (job.type == JOB_GENERATE)
+    {
+        PoolEntry entry;
+        if (m_pool && m_pool->take(Difficulty(job.param), entry))
+        {
+            ++m_poolHits;
+            job.done(generatedBody(entry.puzzle, entry.solution, entry.score));
+            return true;
+        }
+    }
+    else if (const QByteArray *body = m_cache.object(cacheKey(job)))
+    {
+        ++m_cacheHits;
+        job.done(*body);
+        return true;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (int(m_queue.size()) >= m_capacity)
+    {
+        return false;
+    }
+    m_queue.push_back(std::move(job));
+    m_wake.wakeOne();
+    return true;
+}
+
+QJsonObject SolveDispatcher::stats() const
+{
+    QJsonObject object;
+    {
+        QMutexLocker locker(&m_mutex);
+        object["queued"] = int(m_queue.size());
+    }
+    quint64 batches = m_batches;
+    quint64 jobs = m_jobs;
+    object["capacity"] = m_capacity;
+    object["threads"] = int(m_threads.size());
+    object["batches"] = double(batches);
+    object["jobs"] = double(jobs);
+    object["mean_batch"] = batches ? double(jobs) / double(batches) : 0.0;
+    object["cache_hits"] = double(m_cacheHits);
+    object["cache_entries"] = m_cache.count();
+    object["pool_hits"] = double(m_poolHits);
+    return object;
+}
+
+const SolveMetrics &SolveDispatcher::operations() const
+{
+    return m_operations;
+}
+
+void SolveDispatcher::run()
+{
+    for (;;)
+    {
+        QVector<Job> jobs;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.empty() && !m_stopping)
+            {
+                m_wake.wait(&m_mutex);
+            }
+            if (m_stopping)
+            {
+                return;
+            }
+            // 取走已排队的请求，至多一批
+            int count = qMin(int(m_queue.size()), m_batchSize);
+            jobs.reserve(count);
+            for (int i = 0; i < count; i++)
+            {
+                jobs.append(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+
+        QVector<QByteArray> bodies;
+        bodies.reserve(jobs.size());
+        for (const Job &job : jobs)
+        {
+            bodies.append(process(job));
+        }
+        ++m_batches;
+        m_jobs += quint64(jobs.size());
+
+        QMetaObject::invokeMethod(this, [this, jobs, bodies]() { deliver(jobs, bodies); }, Qt::QueuedConnection);
+    }
+}
+
+QByteArray SolveDispatcher::process(const Job &job)
+{
+    // 每个线程一套求解器、评分器和生成器，处理请求时不再分配
+    static thread_local std::unique_ptr<SudokuSolver> solver(new SudokuSolver);
+    static thread_local std::unique_ptr<Rater> rater(new Rater);
+    static thread_local std::unique_ptr<Generator> generator(new Generator(QRandomGenerator::global()->generate()));
+
+    solver->setPhaseTiming(true);
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [start]() {
+        return uint64_t(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    };
+
+    QJsonObject object;
+    switch (job.type)
+    {
+    case JOB_SOLVE:
+    {
+        uint8_t solution[81];
+        int count = solver->solve(job.puzzle, solution, 2);
+        m_operations.recordSolve(METRIC_SOLVE, elapsed(), *solver);
+        object["status"] = count == 0 ? "unsolvable" : count == 1 ? "solved" : "multiple";
+        if (count > 0)
+        {
+            object["solution"] = cellsToString(solution);
+        }
+        object["nodes"] = double(solver->nodes());
+        break;
+    }
+    case JOB_COUNT:
+        object["count"] = solver->solve(job.puzzle, nullptr, job.param);
+        m_operations.recordSolve(METRIC_UNIQUENESS, elapsed(), *solver);
+        object["limit"] = job.param;
+        break;
+    case JOB_RATE:
+    {
+        rater->load(job.puzzle);
+        Rating rating = rater->rate();
+        m_operations.record(METRIC_RATE, elapsed());
+        object["valid"] = rating.valid;
+        if (rating.valid)
+        {
+            object["score"] = rating.score;
+            object["difficulty"] = Rater::difficultyName(Rater::difficultyOf(rating.score));
+            object["hardest"] = Rater::techniqueName(rating.hardest);
+            object["solved"] = rating.solved;
+            object["steps"] = rating.steps;
+        }
+        break;
+    }
+    case JOB_GENERATE:
+    {
+        // 谜题池已空，同步生成；多次生成不出指定难度时返回最后一道
+        uint8_t puzzle[81];
+        uint8_t solution[81];
+        double score = 0;
+        for (int attempt = 0; attempt < MAX_GENERATE_ATTEMPTS; attempt++)
+        {
+            generator->generate(puzzle, solution, PuzzlePool::minClues(Difficulty(job.param)));
+            rater->load(puzzle);
+            score = rater->rate().score;
+            if (Rater::difficultyOf(score) == job.param)
+            {
+                break;
+            }
+        }
+        m_operations.record(METRIC_GENERATE, elapsed());
+        return generatedBody(puzzle, solution, score);
+    }
+    }
+    return toBody(object);
+}
+
+QByteArray SolveDispatcher::cacheKey(const Job &job) const
+{
+    QByteArray key(reinterpret_cast<const char *>(job.puzzle), 81);
+    key.append(char(job.type));
+    key.append(reinterpret_cast<const char *>(&job.param), sizeof(job.param));
+    return key;
+}
+
+void SolveDispatcher::deliver(const QVector<Job> &jobs, const QVector<QByteArray> &bodies)
+{
+    for (int i = 0; i < jobs.size(); i++)
+    {
+        if (jobs[i].type != JOB_GENERATE)
+        {
+            m_cache.insert(cacheKey(jobs[i]), new QByteArray(bodies[i]));
+        }
+        jobs[i].done(bodies[i]);
+    }
+}
@@ -0,0 +1,124 @@
+﻿/**
+ * @file solvedispatcher.h
+ * @brief Bounded job queue served by a pool of solver threads in micro-batches
+ */
+
+#ifndef SOLVEDISPATCHER_H
+#define SOLVEDISPATCHER_H
+
+#include "rater.h"
+#include "solvemetrics.h"
+
+#include <QByteArray>
+#include <QCache>
+#include <QJsonObject>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+class PuzzlePool;
+
+/**
+ * @brief 请求的种类
+ */
+enum JobType
+{
+    JOB_SOLVE,
+    JOB_COUNT,
+    JOB_RATE,
+    JOB_GENERATE
+};
+
+/**
+ * @brief 交给求解线程的一个请求
+ */
+struct Job
+{
+    JobType type;
+    uint8_t puzzle[81];
+    int param; // JOB_COUNT的上限，JOB_GENERATE的难度
+    std::function<void(const QByteArray &)> done; // 在网络线程中以JSON应答体回调
+};
+
+/**
+ * @brief The SolveDispatcher class 把请求分批交给求解线程
+ * @details 队列有固定的容量，满了以后submit直接失败，由调用者拒绝请求。
+ * 求解线程每次取出队列中至多batchSize个请求一起处理，整批结果只跨线程投递一次；
+ * 负载低时一批只有一个请求，不为凑批而等待。相同的solve、count和rate请求的结果缓存在LRU中，
+ * generate优先从谜题池中取。求解线程各自记录每个请求的计算时间，不含排队和缓存命中
+ */
+class SolveDispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    SolveDispatcher(int threads, int queueCapacity, int batchSize, int cacheEntries, PuzzlePool *pool,
+                    QObject *parent = nullptr);
+
+    /**
+     * @brief 停止求解线程，未处理的请求不再回调
+     */
+    ~SolveDispatcher();
+
+    /**
+     * @brief 提交一个请求，命中缓存时立即回调
+     * @return 队列已满时返回false
+     */
+    bool submit(Job job);
+
+    /**
+     * @brief 队列、批次和缓存的统计
+     */
+    QJsonObject stats() const;
+
+    /**
+     * @brief 各种操作在求解线程中的耗时，求解还分为传播和搜索两个阶段
+     */
+    const SolveMetrics &operations() const;
+
+private:
+    void run();
+
+    QByteArray process(const Job &job);
+
+    QByteArray cacheKey(const Job &job) const;
+
+    void deliver(const QVector<Job> &jobs, const QVector<QByteArray> &bodies);
+
+    PuzzlePool *m_pool;
+
+    int m_capacity;
+
+    int m_batchSize;
+
+    std::deque<Job> m_queue;
+
+    bool m_stopping;
+
+    mutable QMutex m_mutex;
+
+    QWaitCondition m_wake;
+
+    QCache<QByteArray, QByteArray> m_cache; // 只在网络线程中访问
+
+    std::vector<std::thread> m_threads;
+
+    SolveMetrics m_operations;
+
+    std::atomic<quint64> m_batches;
+
+    std::atomic<quint64> m_jobs;
+
+    quint64 m_cacheHits;
+
+    quint64 m_poolHits;
+};
+
+#endif // SOLVEDISPATCHER_H
@@ -0,0 +1,495 @@
+﻿#include "coordinator.h"
+
+#include "puzzleparser.h"
+#include "sudoku_c.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifndef _WIN32
+
+namespace {
+
+const int MAX_ATTEMPTS = 3;
+const char MANIFEST_MAGIC[] = "sudoku-solve shards 1";
+
+/**
+ * @brief 分片的划分，写在工作目录的manifest中
+ */
+struct Manifest
+{
+    size_t shards = 0;
+    size_t puzzles = 0;
+    size_t skipped = 0;
+    std::string inputs; // 输入文件列表，续跑时用来确认是同一次任务
+};
+
+std::string shardName(size_t index)
+{
+    char name[24];
+    std::snprintf(name, sizeof(name), "%08zu", index);
+    return name;
+}
+
+bool makeDir(const std::string &path)
+{
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+std::vector<std::string> listDir(const std::string &path)
+{
+    std::vector<std::string> names;
+    if (DIR *dir = opendir(path.c_str()))
+    {
+        while (struct dirent *entry = readdir(dir))
+        {
+            if (entry->d_name[0] != '.')
+            {
+                names.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+/**
+ * @brief 写临时文件、落盘后改名，读者只会看到完整的文件
+ */
+bool writeFileAtomic(const std::string &path, const void *data, size_t size)
+{
+    std::string temp = path + ".tmp";
+    FILE *file = std::fopen(temp.c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool ok = std::fwrite(data, 1, size, file) == size && std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    return ok && std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+bool readFile(const std::string &path, std::string &data)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    data.clear();
+    char buffer[1 << 16];
+    size_t got;
+    while ((got = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        data.append(buffer, got);
+    }
+    std::fclose(file);
+    return true;
+}
+
+bool readManifest(const std::string &workDir, Manifest &manifest)
+{
+    std::string text;
+    if (!readFile(workDir + "/manifest", text))
+    {
+        return false;
+    }
+    char magic[64];
+    size_t inputsAt = text.find("\ninputs ");
+    if (inputsAt == std::string::npos
+        || std::sscanf(text.c_str(), "%63[^\n]\nshards %zu\npuzzles %zu\nskipped %zu", magic, &manifest.shards,
+                       &manifest.puzzles, &manifest.skipped) != 4
+        || std::strcmp(magic, MANIFEST_MAGIC) != 0)
+    {
+        return false;
+    }
+    manifest.inputs = text.substr(inputsAt + 8);
+    return true;
+}
+
+bool writeManifest(const std::string &workDir, const Manifest &manifest)
+{
+    char header[160];
+    std::snprintf(header, sizeof(header), "%s\nshards %zu\npuzzles %zu\nskipped %zu\ninputs ", MANIFEST_MAGIC,
+                  manifest.shards, manifest.puzzles, manifest.skipped);
+    std::string text = header + manifest.inputs;
+    return writeFileAtomic(workDir + "/manifest", text.data(), text.size());
+}
+
+std::string joinInputs(const std::vector<std::string> &inputs)
+{
+    std::string text;
+    for (const std::string &input : inputs)
+    {
+        text += input + '\n';
+    }
+    return text;
+}
+
+/**
+ * @brief 读入所有谜题，每shardSize道写成一个分片，每道81字节
+ */
+bool createShards(const CoordinatorOptions &options, Manifest &manifest)
+{
+    const std::string &dir = options.workDir;
+    if (!makeDir(dir) || !makeDir(dir + "/shards") || !makeDir(dir + "/queue") || !makeDir(dir + "/running")
+        || !makeDir(dir + "/done") || !makeDir(dir + "/failed"))
+    {
+        std::fprintf(stderr, "cannot create %s\n", dir.c_str());
+        return false;
+    }
+    // 上次分片没有完成，清掉残留
+    for (const char *sub : { "/shards/", "/queue/", "/running/", "/done/", "/failed/" })
+    {
+        for (const std::string &name : listDir(dir + sub))
+        {
+            std::remove((dir + sub + name).c_str());
+        }
+    }
+
+    manifest = Manifest();
+    manifest.inputs = joinInputs(options.inputs);
+    std::vector<uint8_t> shard(options.shardSize * 81);
+    size_t filled = 0;
+    auto flush = [&]() {
+        std::string name = shardName(manifest.shards);
+        if (!writeFileAtomic(dir + "/shards/" + name, shard.data(), filled * 81)
+            || !writeFileAtomic(dir + "/queue/" + name + ".0", "", 0))
+        {
+            return false;
+        }
+        ++manifest.shards;
+        filled = 0;
+        return true;
+    };
+
+    PuzzleReader input;
+    for (const std::string &path : options.inputs)
+    {
+        if (!input.open(path))
+        {
+            std::fprintf(stderr, "%s\n", input.errorString().c_str());
+            return false;
+        }
+        size_t count;
+        while ((count = input.read(&shard[filled * 81], options.shardSize - filled)) > 0)
+        {
+            filled += count;
+            manifest.puzzles += count;
+            if (filled == options.shardSize && !flush())
+            {
+                std::fprintf(stderr, "cannot write shards in %s\n", dir.c_str());
+                return false;
+            }
+        }
+        manifest.skipped += input.skipped();
+    }
+    if (filled > 0 && !flush())
+    {
+        std::fprintf(stderr, "cannot write shards in %s\n", dir.c_str());
+        return false;
+    }
+    // manifest最后写，有manifest说明分片已经完整
+    return writeManifest(dir, manifest);
+}
+
+/**
+ * @brief 续跑前把上次运行中和失败的分片放回队列
+ */
+void requeueAll(const std::string &dir)
+{
+    for (const std::string &name : listDir(dir + "/running"))
+    {
+        std::string marker = name.substr(0, name.rfind('.'));
+        std::rename((dir + "/running/" + name).c_str(), (dir + "/queue/" + marker).c_str());
+    }
+    for (const std::string &name : listDir(dir + "/failed"))
+    {
+        std::rename((dir + "/failed/" + name).c_str(), (dir + "/queue/" + name + ".0").c_str());
+    }
+}
+
+/**
+ * @brief 工作进程异常退出后，把它领取的分片放回队列，重试次数用完的移到failed
+ * @return 放回队列的分片数
+ */
+int requeueWorker(const std::string &dir, pid_t pid)
+{
+    std::string suffix = "." + std::to_string(pid);
+    int requeued = 0;
+    for (const std::string &name : listDir(dir + "/running"))
+    {
+        if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+        {
+            continue;
+        }
+        // 名字是"分片.重试次数.进程号"
+        std::string marker = name.substr(0, name.size() - suffix.size());
+        size_t dot = marker.find('.');
+        std::string shard = marker.substr(0, dot);
+        int attempts = std::atoi(marker.c_str() + dot + 1) + 1;
+        std::string from = dir + "/running/" + name;
+        if (attempts < MAX_ATTEMPTS)
+        {
+            std::rename(from.c_str(), (dir + "/queue/" + shard + "." + std::to_string(attempts)).c_str());
+            ++requeued;
+        }
+        else
+        {
+            std::fprintf(stderr, "shard %s failed %d times, giving up\n", shard.c_str(), attempts);
+            std::rename(from.c_str(), (dir + "/failed/" + shard).c_str());
+        }
+    }
+    return requeued;
+}
+
+pid_t spawnWorker(const std::string &self, const std::string &workDir, int firstCpu, int cpuCount)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        std::string cpus = std::to_string(firstCpu) + ":" + std::to_string(cpuCount);
+        // Linux上用/proc/self/exe，不依赖argv[0]和当前目录
+#ifdef __linux__
+        const char *path = "/proc/self/exe";
+#else
+        const char *path = self.c_str();
+#endif
+        execl(path, self.c_str(), "--worker", workDir.c_str(), "--cpus", cpus.c_str(), (char *)nullptr);
+        _exit(127);
+    }
+    return pid;
+}
+
+}
+
+int runCoordinator(const CoordinatorOptions &options, const std::string &self)
+{
+    const std::string &dir = options.workDir;
+    auto start = std::chrono::steady_clock::now();
+
+    Manifest manifest;
+    if (readManifest(dir, manifest))
+    {
+        if (manifest.inputs != joinInputs(options.inputs))
+        {
+            std::fprintf(stderr, "%s belongs to a run with other inputs\n", dir.c_str());
+            return 1;
+        }
+        requeueAll(dir);
+        std::fprintf(stderr, "resuming %s: %zu of %zu shards already done\n", dir.c_str(),
+                     listDir(dir + "/done").size(), manifest.shards);
+    }
+    else if (!createShards(options, manifest))
+    {
+        return 1;
+    }
+
+    FILE *output = options.outputPath == "-" ? stdout : std::fopen(options.outputPath.c_str(), "wb");
+    if (!output)
+    {
+        std::fprintf(stderr, "cannot open %s\n", options.outputPath.c_str());
+        return 1;
+    }
+
+    // 每个工作进程分到连续的一组核，核数不足时轮流共用
+    int cpus = std::max(1, int(std::thread::hardware_concurrency()));
+    int perWorker = std::max(1, cpus / options.workers);
+    std::map<pid_t, int> workers; // 进程号 -> 第几个工作进程
+    auto spawn = [&](int slot) {
+        pid_t pid = spawnWorker(self, dir, slot * perWorker % cpus, perWorker);
+        if (pid > 0)
+        {
+            workers[pid] = slot;
+        }
+    };
+    for (int i = 0; i < options.workers && i < int(manifest.shards); i++)
+    {
+        spawn(i);
+    }
+
+    // 按顺序合并已完成的分片，同时回收工作进程
+    size_t merged = 0;
+    int crashes = 0;
+    std::string text;
+    auto lastReport = start;
+    for (;;)
+    {
+        while (merged < manifest.shards && readFile(dir + "/done/" + shardName(merged), text))
+        {
+            std::fwrite(text.data(), 1, text.size(), output);
+            ++merged;
+        }
+        if (workers.empty())
+        {
+            break;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid > 0 && workers.count(pid))
+        {
+            int slot = workers[pid];
+            workers.erase(pid);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                ++crashes;
+                std::fprintf(stderr, "worker %d exited abnormally, retrying its shards\n", int(pid));
+                if (requeueWorker(dir, pid) > 0 || !listDir(dir + "/queue").empty())
+                {
+                    spawn(slot);
+                }
+            }
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(1))
+        {
+            std::fprintf(stderr, "%zu/%zu shards merged, %zu running\n", merged, manifest.shards, workers.size());
+            lastReport = now;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    std::fflush(output);
+    if (output != stdout)
+    {
+        std::fclose(output);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (merged < manifest.shards)
+    {
+        std::fprintf(stderr, "%zu of %zu shards failed; rerun the same command to retry them (work dir %s)\n",
+                     manifest.shards - merged, manifest.shards, dir.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "%zu puzzles, %zu skipped, %zu shards, %d worker crashes, %.2f s, %.0f puzzles/s\n",
+                 manifest.puzzles, manifest.skipped, manifest.shards, crashes, seconds,
+                 seconds > 0 ? manifest.puzzles / seconds : 0.0);
+
+    if (!options.keep)
+    {
+        for (const char *sub : { "/shards", "/queue", "/running", "/done", "/failed" })
+        {
+            for (const std::string &name : listDir(dir + sub))
+            {
+                std::remove((dir + sub + "/" + name).c_str());
+            }
+            rmdir((dir + sub).c_str());
+        }
+        std::remove((dir + "/manifest").c_str());
+        rmdir(dir.c_str());
+    }
+    return 0;
+}
+
+int runWorker(const std::string &workDir, int firstCpu, int cpuCount)
+{
+#ifdef __linux__
+    if (firstCpu >= 0)
+    {
+        // 之后创建的求解线程继承这个亲和性
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int i = 0; i < cpuCount; i++)
+        {
+            CPU_SET(firstCpu + i, &set);
+        }
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+#endif
+
+    const std::string suffix = "." + std::to_string(getpid());
+    std::string data;
+    std::vector<uint8_t> solutions;
+    std::vector<int> status;
+    std::string text;
+
+    for (;;)
+    {
+        // 按编号从小到大领取，改名成功的进程得到分片
+        std::string claimed;
+        for (const std::string &name : listDir(workDir + "/queue"))
+        {
+            if (std::rename((workDir + "/queue/" + name).c_str(), (workDir + "/running/" + name + suffix).c_str()) == 0)
+            {
+                claimed = name;
+                break;
+            }
+        }
+        if (claimed.empty())
+        {
+            return 0;
+        }
+
+        std::string shard = claimed.substr(0, claimed.find('.'));
+        if (!readFile(workDir + "/shards/" + shard, data))
+        {
+            std::fprintf(stderr, "cannot read shard %s\n", shard.c_str());
+            return 1;
+        }
+        size_t count = data.size() / 81;
+        solutions.resize(count * 81);
+        status.resize(count);
+        sudoku_solve_batch(reinterpret_cast<const uint8_t *>(data.data()), count, solutions.data(), status.data(),
+                           cpuCount);
+
+        text.clear();
+        text.reserve(count * 82);
+        for (size_t k = 0; k < count; k++)
+        {
+            if (status[k] != SUDOKU_SOLVED)
+            {
+                text += "unsolvable\n";
+                continue;
+            }
+            for (int i = 0; i < 81; i++)
+            {
+                text += char('0' + solutions[k * 81 + i]);
+            }
+            text += '\n';
+        }
+        if (!writeFileAtomic(workDir + "/done/" + shard, text.data(), text.size()))
+        {
+            std::fprintf(stderr, "cannot write result of shard %s\n", shard.c_str());
+            return 1;
+        }
+        std::remove((workDir + "/running/" + claimed + suffix).c_str());
+    }
+}
+
+#else
+
+int runCoordinator(const CoordinatorOptions &, const std::string &)
+{
+    std::fprintf(stderr, "--workers needs a POSIX system\n");
+    return 1;
+}
+
+int runWorker(const std::string &, int, int)
+{
+    return 1;
+}
+
+#endif
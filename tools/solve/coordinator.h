@@ -0,0 +1,50 @@
+﻿/**
+ * @file coordinator.h
+ * @brief Multi-process sharded solving for sudoku-solve
+ *
+ * The coordinator splits the input into shards inside a work directory and
+ * starts worker processes, each pinned to its own cores. Workers pull shards
+ * from a file-based queue: claiming a shard is an atomic rename of its marker
+ * from queue/ to running/, and a finished shard is written to done/ with an
+ * atomic rename. The coordinator appends finished shards to the output in
+ * shard order. When a worker dies its shards go back to the queue, up to
+ * three attempts each, and a replacement is started. Running the same command
+ * again resumes an interrupted run from the shards already done.
+ *
+ * POSIX only; elsewhere the coordinator reports that it is unsupported.
+ */
+
+#ifndef COORDINATOR_H
+#define COORDINATOR_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief 协调进程的参数
+ */
+struct CoordinatorOptions
+{
+    std::vector<std::string> inputs;
+    std::string outputPath; // "-"表示标准输出
+    std::string workDir;    // 分片和中间结果所在的目录
+    int workers;            // 工作进程数
+    size_t shardSize;       // 每个分片的谜题数
+    bool keep;              // 完成后保留工作目录
+};
+
+/**
+ * @brief 分片、启动工作进程并按顺序合并结果
+ * @param self 本程序的路径，用于启动工作进程
+ * @return 进程的退出码
+ */
+int runCoordinator(const CoordinatorOptions &options, const std::string &self);
+
+/**
+ * @brief 工作进程：绑定到指定的核，反复领取分片并求解，队列为空时退出
+ * @param firstCpu 第一个核的编号，负数表示不绑定
+ * @param cpuCount 使用的核数，也是求解线程数
+ */
+int runWorker(const std::string &workDir, int firstCpu, int cpuCount);
+
+#endif // COORDINATOR_H
@@ -0,0 +1,446 @@
+﻿/**
+ * @file main.cpp
+ * @brief sudoku-solve: headless multi-threaded batch solver
+ *
+ * Usage: sudoku-solve [--threads n] [--output file] [--metrics file] [file ...]
+ *        sudoku-solve --workers n [--work-dir dir] [--shard-size n] [--keep] ...
+ *
+ * Reads puzzles from the given files (or stdin) and writes one line per puzzle
+ * in input order: the 81-digit solution, or "unsolvable". Every format that
+ * PuzzleReader detects is accepted, including compact files. With --workers
+ * the input is sharded across worker processes, see coordinator.h.
+ */
+
+#include "coordinator.h"
+#include "puzzleparser.h"
+#include "solvemetrics.h"
+#include "sudokusolver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t BATCH_SIZE = 4096; // 每批谜题数
+
+/**
+ * @brief 一批谜题，按读入顺序编号
+ */
+struct Batch
+{
+    size_t sequence;
+    std::vector<uint8_t> puzzles;   // 每个81字节
+    std::vector<uint8_t> solutions; // 每个81字节，无解时全为0
+    size_t solved;
+};
+
+/**
+ * @brief 有界的阻塞队列
+ */
+class BatchQueue
+{
+public:
+    explicit BatchQueue(size_t capacity)
+        : m_capacity(capacity)
+        , m_closed(false)
+    {
+    }
+
+    void push(std::unique_ptr<Batch> batch)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this]() { return m_items.size() < m_capacity; });
+        m_items.push_back(std::move(batch));
+        m_notEmpty.notify_one();
+    }
+
+    /**
+     * @brief 取出一批，队列关闭且为空时返回nullptr
+     */
+    std::unique_ptr<Batch> pop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this]() { return !m_items.empty() || m_closed; });
+        if (m_items.empty())
+        {
+            return nullptr;
+        }
+        std::unique_ptr<Batch> batch = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return batch;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+    }
+
+private:
+    size_t m_capacity;
+    bool m_closed;
+    std::deque<std::unique_ptr<Batch>> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+};
+
+/**
+ * @brief 重排缓冲区：按任意顺序接收求解完的批次，按编号顺序交给写线程
+ * @details 同时限制已读入但尚未写出的批次数，读线程在达到上限时等待，
+ * 所以内存占用与输入大小无关
+ */
+class ReorderBuffer
+{
+public:
+    explicit ReorderBuffer(size_t window)
+        : m_window(window)
+        , m_next(0)
+        , m_issued(0)
+        , m_finished(false)
+    {
+    }
+
+    /**
+     * @brief 读线程领取下一个编号，在途批次达到上限时等待
+     */
+    size_t acquire()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_space.wait(lock, [this]() { return m_issued - m_next < m_window; });
+        return m_issued++;
+    }
+
+    void put(std::unique_ptr<Batch> batch)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t sequence = batch->sequence;
+        m_pending[sequence] = std::move(batch);
+        if (sequence == m_next)
+        {
+            m_ready.notify_one();
+        }
+    }
+
+    /**
+     * @brief 写线程按顺序取出下一批，全部写完时返回nullptr
+     */
+    std::unique_ptr<Batch> next()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_ready.wait(lock, [this]() {
+            return m_pending.count(m_next) || (m_finished && m_next == m_issued);
+        });
+        auto it = m_pending.find(m_next);
+        if (it == m_pending.end())
+        {
+            return nullptr;
+        }
+        std::unique_ptr<Batch> batch = std::move(it->second);
+        m_pending.erase(it);
+        ++m_next;
+        m_space.notify_one();
+        return batch;
+    }
+
+    /**
+     * @brief 读线程不再领取编号
+     */
+    void finish()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished = true;
+        m_ready.notify_one();
+    }
+
+private:
+    size_t m_window;
+    size_t m_next;   // 下一个要写出的编号
+    size_t m_issued; // 已领取的编号数
+    bool m_finished;
+    std::map<size_t, std::unique_ptr<Batch>> m_pending;
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::condition_variable m_space;
+};
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: sudoku-solve [--threads n] [--output file] [--metrics file] [file ...]\n"
+                 "  Solves every puzzle in the files (stdin if none or \"-\") and writes\n"
+                 "  one line per puzzle in input order: the solution or \"unsolvable\".\n"
+                 "  Accepts 81-character lines, spaced 9x9 grids, SDK and SS files and\n"
+                 "  compact files written by sudoku-corpus --format compact.\n"
+                 "  --threads n    solver threads, 0 for all cores (default)\n"
+                 "  --output file  output file, - for stdout (default)\n"
+                 "  --metrics file write per-puzzle latency percentiles, split into propagation\n"
+                 "                 and search time, as Prometheus text (JSON for *.json)\n"
+                 "  --workers n    solve in n worker processes, each pinned to its share of\n"
+                 "                 the cores; crashed shards are retried, and rerunning an\n"
+                 "                 interrupted command resumes it\n"
+                 "  --work-dir dir shards and partial results (default sudoku-solve.work)\n"
+                 "  --shard-size n puzzles per shard (default 65536)\n"
+                 "  --keep         keep the work directory after a successful run\n");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0;
+    std::string outputPath = "-";
+    std::string metricsPath;
+    std::vector<std::string> inputs;
+    CoordinatorOptions sharding;
+    sharding.workers = 0;
+    sharding.workDir = "sudoku-solve.work";
+    sharding.shardSize = 65536;
+    sharding.keep = false;
+    std::string workerDir;
+    int firstCpu = -1;
+    int cpuCount = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if ((arg == "--threads" || arg == "-j") && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if ((arg == "--output" || arg == "-o") && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else if (arg == "--metrics" && i + 1 < argc)
+        {
+            metricsPath = argv[++i];
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            sharding.workers = std::atoi(argv[++i]);
+        }
+        else if (arg == "--work-dir" && i + 1 < argc)
+        {
+            sharding.workDir = argv[++i];
+        }
+        else if (arg == "--shard-size" && i + 1 < argc)
+        {
+            sharding.shardSize = size_t(std::max(1L, std::atol(argv[++i])));
+        }
+        else if (arg == "--keep")
+        {
+            sharding.keep = true;
+        }
+        else if (arg == "--worker" && i + 1 < argc)
+        {
+            // 协调进程启动工作进程时使用，不在帮助中列出
+            workerDir = argv[++i];
+        }
+        else if (arg == "--cpus" && i + 1 < argc)
+        {
+            std::sscanf(argv[++i], "%d:%d", &firstCpu, &cpuCount);
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+    if (!workerDir.empty())
+    {
+        return runWorker(workerDir, firstCpu, std::max(1, cpuCount));
+    }
+    if (inputs.empty())
+    {
+        inputs.push_back("-");
+    }
+    if (sharding.workers > 0)
+    {
+        sharding.inputs = inputs;
+        sharding.outputPath = outputPath;
+        return runCoordinator(sharding, argv[0]);
+    }
+    if (threads < 1)
+    {
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+
+    FILE *output = outputPath == "-" ? stdout : std::fopen(outputPath.c_str(), "wb");
+    if (!output)
+    {
+        std::fprintf(stderr, "cannot open %s\n", outputPath.c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // 读线程 -> 求解线程组 -> 重排缓冲区 -> 写线程，各阶段同时进行
+    BatchQueue queue(size_t(threads) * 2);
+    ReorderBuffer reorder(size_t(threads) * 4);
+    bool readError = false;
+    size_t skipped = 0;
+    SolveMetrics metrics;
+    bool timed = !metricsPath.empty();
+
+    std::thread reader([&]() {
+        PuzzleReader input;
+        std::unique_ptr<Batch> batch;
+
+        for (const std::string &path : inputs)
+        {
+            if (!input.open(path))
+            {
+                std::fprintf(stderr, "%s\n", input.errorString().c_str());
+                readError = true;
+                continue;
+            }
+            for (;;)
+            {
+                if (!batch)
+                {
+                    batch.reset(new Batch);
+                    batch->sequence = reorder.acquire();
+                    batch->solved = 0;
+                    batch->puzzles.reserve(BATCH_SIZE * 81);
+                }
+
+                // 直接解析到批次的缓冲区里
+                size_t offset = batch->puzzles.size();
+                batch->puzzles.resize(BATCH_SIZE * 81);
+                size_t count = input.read(&batch->puzzles[offset], BATCH_SIZE - offset / 81);
+                batch->puzzles.resize(offset + count * 81);
+                if (batch->puzzles.size() == BATCH_SIZE * 81)
+                {
+                    queue.push(std::move(batch));
+                }
+                else if (count == 0)
+                {
+                    break;
+                }
+            }
+            skipped += input.skipped();
+        }
+
+        if (batch && !batch->puzzles.empty())
+        {
+            queue.push(std::move(batch));
+        }
+        else if (batch)
+        {
+            // 已领取编号的空批次也要交给写线程，保证编号连续
+            reorder.put(std::move(batch));
+        }
+        reorder.finish();
+        queue.close();
+    });
+
+    std::vector<std::thread> solvers;
+    for (int i = 0; i < threads; i++)
+    {
+        solvers.push_back(std::thread([&]() {
+            std::unique_ptr<SudokuSolver> solver(new SudokuSolver);
+            solver->setPhaseTiming(timed);
+            while (std::unique_ptr<Batch> batch = queue.pop())
+            {
+                size_t count = batch->puzzles.size() / 81;
+                batch->solutions.assign(count * 81, 0);
+                batch->solved = 0;
+                for (size_t k = 0; k < count; k++)
+                {
+                    auto begin = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+                    int found = solver->solve(&batch->puzzles[k * 81], &batch->solutions[k * 81]);
+                    if (timed)
+                    {
+                        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - begin);
+                        metrics.recordSolve(METRIC_SOLVE, uint64_t(nanos.count()), *solver);
+                    }
+                    if (found > 0)
+                    {
+                        ++batch->solved;
+                    }
+                    else
+                    {
+                        std::memset(&batch->solutions[k * 81], 0, 81);
+                    }
+                }
+                reorder.put(std::move(batch));
+            }
+        }));
+    }
+
+    size_t total = 0;
+    size_t solved = 0;
+    std::thread writer([&]() {
+        std::string text;
+        while (std::unique_ptr<Batch> batch = reorder.next())
+        {
+            size_t count = batch->puzzles.size() / 81;
+            text.clear();
+            text.reserve(count * 82);
+            for (size_t k = 0; k < count; k++)
+            {
+                const uint8_t *solution = &batch->solutions[k * 81];
+                if (solution[0] == 0)
+                {
+                    text += "unsolvable\n";
+                    continue;
+                }
+                for (int i = 0; i < 81; i++)
+                {
+                    text += char('0' + solution[i]);
+                }
+                text += '\n';
+            }
+            std::fwrite(text.data(), 1, text.size(), output);
+            total += count;
+            solved += batch->solved;
+        }
+        std::fflush(output);
+    });
+
+    reader.join();
+    for (auto &solver : solvers)
+    {
+        solver.join();
+    }
+    writer.join();
+
+    if (output != stdout)
+    {
+        std::fclose(output);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%zu puzzles, %zu solved, %zu skipped, %.2f s, %.0f puzzles/s\n",
+                 total, solved, skipped, seconds, seconds > 0 ? total / seconds : 0.0);
+    if (timed && !metrics.writeFile(metricsPath))
+    {
+        std::fprintf(stderr, "cannot write %s\n", metricsPath.c_str());
+        return 1;
+    }
+    return readError ? 1 : 0;
+}
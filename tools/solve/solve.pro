@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# sudoku-solve: headless multi-threaded batch solver
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = sudoku-solve
+
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+include(../../core/core.pri)
+
+HEADERS += \
+    coordinator.h
+
+SOURCES += \
+    coordinator.cpp \
+    main.cpp